@@ -0,0 +1,523 @@
+#include "Benchmark.hpp"
+
+#include "Bvh.hpp"
+#include "Frustum.hpp"
+#include "OcclusionCuller.hpp"
+#include "WorkerPool.hpp"
+#include "ShaderPermutations.hpp"
+#include "ClusteredLights.hpp"
+#include "RenderQueue.hpp"
+#include "MaterialLibrary.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace gps {
+
+    typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+    static double elapsedMilliseconds(BenchmarkClock::time_point start) {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    //objects scattered over a square world the size of a village, most of them small props
+    static std::vector<BoundingBox> randomBoxes(size_t count, std::mt19937& generator) {
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> height(0.0f, 20.0f);
+        std::exponential_distribution<float> size(1.0f);
+
+        std::vector<BoundingBox> boxes(count);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 center = glm::vec3(position(generator), height(generator), position(generator));
+            glm::vec3 extent = glm::vec3(0.1f + size(generator), 0.1f + size(generator), 0.1f + size(generator));
+            boxes[i].min = center - extent;
+            boxes[i].max = center + extent;
+        }
+        return boxes;
+    }
+
+    void RunBvhBenchmark(size_t objectCount) {
+        const int QUERY_COUNT = 200;
+        std::mt19937 generator(1234);
+        std::vector<BoundingBox> boxes = randomBoxes(objectCount, generator);
+
+        std::cout << "BVH benchmark, " << objectCount << " objects" << std::endl;
+
+        Bvh bvh;
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        bvh.Build(boxes);
+        std::cout << "  build      : " << elapsedMilliseconds(start) << " ms, " << bvh.getNodeCount()
+            << " nodes, SAH cost " << bvh.computeCost() << std::endl;
+
+        //cameras at eye height looking in random directions
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        std::vector<Frustum> frustums(QUERY_COUNT);
+        std::vector<Ray> rays(QUERY_COUNT);
+        std::vector<BoundingSphere> spheres(QUERY_COUNT);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            glm::vec3 eye = glm::vec3(position(generator), 2.0f, position(generator));
+            float a = angle(generator);
+            glm::vec3 direction = glm::vec3(cos(a), -0.05f, sin(a));
+            frustums[i].Extract(projection * glm::lookAt(eye, eye + direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+            rays[i].origin = eye;
+            rays[i].direction = glm::normalize(direction);
+            rays[i].tMax = 1000.0f;
+
+            spheres[i].center = eye;
+            spheres[i].radius = 25.0f;
+        }
+
+        std::vector<uint32_t> result;
+        size_t visibleTotal = 0, nodesTotal = 0, testsTotal = 0;
+        start = BenchmarkClock::now();
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            result.clear();
+            bvh.QueryFrustum(frustums[i], result);
+            visibleTotal += result.size();
+            nodesTotal += bvh.getLastQueryStats().nodesVisited;
+            testsTotal += bvh.getLastQueryStats().primitivesTested;
+        }
+        double bvhFrustumTime = elapsedMilliseconds(start) / QUERY_COUNT;
+        std::cout << "  frustum    : " << bvhFrustumTime << " ms/query, " << visibleTotal / QUERY_COUNT << " visible, "
+            << nodesTotal / QUERY_COUNT << " nodes, " << testsTotal / QUERY_COUNT << " box tests" << std::endl;
+
+        //every box through the SIMD culler, the cost the bvh replaces
+        BoxListSoA soa;
+        std::vector<uint8_t> visible;
+        size_t bruteVisibleTotal = 0;
+        start = BenchmarkClock::now();
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            soa.clear();
+            for (size_t b = 0; b < boxes.size(); b++) {
+                soa.push(boxes[b]);
+            }
+            frustums[i].CullBoxes(soa, visible);
+            for (size_t b = 0; b < boxes.size(); b++) {
+                bruteVisibleTotal += visible[b];
+            }
+        }
+        std::cout << "  brute force: " << elapsedMilliseconds(start) / QUERY_COUNT << " ms/query, "
+            << bruteVisibleTotal / QUERY_COUNT << " visible" << std::endl;
+
+        size_t hits = 0;
+        nodesTotal = 0;
+        start = BenchmarkClock::now();
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            float distance;
+            uint32_t primitive;
+            hits += bvh.Raycast(rays[i], distance, primitive) ? 1 : 0;
+            nodesTotal += bvh.getLastQueryStats().nodesVisited;
+        }
+        std::cout << "  ray        : " << elapsedMilliseconds(start) * 1000.0 / QUERY_COUNT << " us/query, "
+            << hits << "/" << QUERY_COUNT << " hits, " << nodesTotal / QUERY_COUNT << " nodes" << std::endl;
+
+        size_t found = 0;
+        nodesTotal = 0;
+        start = BenchmarkClock::now();
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            result.clear();
+            bvh.QuerySphere(spheres[i], result);
+            found += result.size();
+            nodesTotal += bvh.getLastQueryStats().nodesVisited;
+        }
+        std::cout << "  sphere     : " << elapsedMilliseconds(start) * 1000.0 / QUERY_COUNT << " us/query, "
+            << found / QUERY_COUNT << " found, " << nodesTotal / QUERY_COUNT << " nodes" << std::endl;
+    }
+
+    void RunBvhRefitBenchmark(size_t objectCount, size_t movingCount) {
+        const int FRAME_COUNT = 300;
+        const float FRAME_TIME = 1.0f / 60.0f;
+        //full rebuilds are timed on every tenth frame only, they dominate the run time
+        const int REBUILD_INTERVAL = 10;
+        std::mt19937 generator(1234);
+        std::vector<BoundingBox> boxes = randomBoxes(objectCount, generator);
+
+        std::cout << "BVH refit benchmark, " << movingCount << " of " << objectCount << " objects moving" << std::endl;
+
+        //vehicles driving in straight lines at up to 10 m/s
+        std::uniform_real_distribution<float> speed(-10.0f, 10.0f);
+        std::vector<glm::vec3> velocities(movingCount);
+        for (size_t i = 0; i < movingCount; i++) {
+            velocities[i] = glm::vec3(speed(generator), 0.0f, speed(generator));
+        }
+
+        Bvh bvh;
+        bvh.Build(boxes);
+        float builtCost = bvh.computeCost();
+
+        Bvh rebuilt;
+        double refitTime = 0.0, rebuildTime = 0.0;
+        unsigned int nodesRefit = 0, partialRebuilds = 0, fullRebuilds = 0;
+        for (int frame = 0; frame < FRAME_COUNT; frame++) {
+            for (size_t i = 0; i < movingCount; i++) {
+                glm::vec3 offset = velocities[i] * FRAME_TIME;
+                boxes[i].min += offset;
+                boxes[i].max += offset;
+            }
+
+            BenchmarkClock::time_point start = BenchmarkClock::now();
+            for (size_t i = 0; i < movingCount; i++) {
+                bvh.UpdatePrimitive((uint32_t)i, boxes[i]);
+            }
+            BvhRefitStats stats = bvh.Refit();
+            refitTime += elapsedMilliseconds(start);
+            nodesRefit += stats.nodesRefit;
+            partialRebuilds += stats.partialRebuilds;
+            fullRebuilds += stats.fullRebuilds;
+
+            if (frame % REBUILD_INTERVAL == REBUILD_INTERVAL - 1) {
+                start = BenchmarkClock::now();
+                rebuilt.Build(boxes);
+                rebuildTime += elapsedMilliseconds(start);
+            }
+        }
+
+        std::cout << "  refit      : " << refitTime / FRAME_COUNT << " ms/frame, " << nodesRefit / FRAME_COUNT
+            << " nodes/frame, " << partialRebuilds << " subtree and " << fullRebuilds << " full rebuilds" << std::endl;
+        std::cout << "  rebuild    : " << rebuildTime * REBUILD_INTERVAL / FRAME_COUNT << " ms/frame" << std::endl;
+        std::cout << "  SAH cost   : " << builtCost << " built, " << bvh.computeCost() << " after "
+            << FRAME_COUNT << " frames of refits, " << rebuilt.computeCost() << " rebuilt" << std::endl;
+    }
+
+    //closed box mesh, counter clockwise seen from outside
+    static void appendBoxOccluder(const BoundingBox& box, Occluder& occluder) {
+        uint32_t first = (uint32_t)occluder.positions.size();
+        for (int corner = 0; corner < 8; corner++) {
+            occluder.positions.push_back(glm::vec3(
+                (corner & 1) ? box.max.x : box.min.x,
+                (corner & 2) ? box.max.y : box.min.y,
+                (corner & 4) ? box.max.z : box.min.z));
+        }
+        //corner bits are x = 1, y = 2, z = 4
+        const uint32_t faces[6][4] = {
+            { 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+            { 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+            { 0, 2, 3, 1 }, { 4, 5, 7, 6 } };
+        for (int f = 0; f < 6; f++) {
+            const uint32_t quad[6] = { faces[f][0], faces[f][1], faces[f][2], faces[f][0], faces[f][2], faces[f][3] };
+            for (int i = 0; i < 6; i++) {
+                occluder.indices.push_back(first + quad[i]);
+            }
+        }
+    }
+
+    void RunOcclusionBenchmark(size_t occludeeCount) {
+        const int FRAME_COUNT = 100;
+        const int BUFFER_WIDTH = 256, BUFFER_HEIGHT = 128;
+        std::mt19937 generator(1234);
+
+        //blocks of 8 x 8 buildings with 4 m wide streets between them
+        Occluder city;
+        BoundingBox ground;
+        ground.min = glm::vec3(-200.0f, -0.1f, -200.0f);
+        ground.max = glm::vec3(200.0f, 0.0f, 200.0f);
+        appendBoxOccluder(ground, city);
+        std::uniform_real_distribution<float> buildingHeight(4.0f, 15.0f);
+        for (int x = -16; x < 16; x++) {
+            for (int z = -16; z < 16; z++) {
+                BoundingBox building;
+                building.min = glm::vec3(x * 12.0f + 2.0f, 0.0f, z * 12.0f + 2.0f);
+                building.max = glm::vec3(x * 12.0f + 10.0f, buildingHeight(generator), z * 12.0f + 10.0f);
+                appendBoxOccluder(building, city);
+            }
+        }
+
+        //props lying around the streets
+        std::uniform_real_distribution<float> position(-190.0f, 190.0f);
+        std::uniform_real_distribution<float> size(0.2f, 1.0f);
+        std::vector<BoundingBox> props(occludeeCount);
+        for (size_t i = 0; i < occludeeCount; i++) {
+            glm::vec3 center = glm::vec3(position(generator), 0.0f, position(generator));
+            glm::vec3 extent = glm::vec3(size(generator));
+            props[i].min = glm::vec3(center.x - extent.x, 0.0f, center.z - extent.z);
+            props[i].max = glm::vec3(center.x + extent.x, 2.0f * extent.y, center.z + extent.z);
+        }
+
+        //cameras walking down the streets
+        std::uniform_int_distribution<int> street(-16, 15);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 200.0f);
+        std::vector<glm::mat4> viewProjections(FRAME_COUNT);
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            glm::vec3 eye = glm::vec3(street(generator) * 12.0f, 1.7f, position(generator));
+            float a = angle(generator);
+            viewProjections[i] = projection * glm::lookAt(eye, eye + glm::vec3(cos(a), 0.0f, sin(a)), glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+
+        std::cout << "Occlusion benchmark, " << city.indices.size() / 3 << " occluder triangles, "
+            << occludeeCount << " occludees, " << BUFFER_WIDTH << "x" << BUFFER_HEIGHT << " depth buffer" << std::endl;
+
+        WorkerPool pool;
+        for (int threaded = 0; threaded < 2; threaded++) {
+            if (threaded) {
+                pool.Start(0);
+            }
+            OcclusionCuller culler;
+            culler.Init(BUFFER_WIDTH, BUFFER_HEIGHT, threaded ? &pool : NULL);
+
+            std::vector<uint8_t> visible;
+            double rasterizeTime = 0.0, testTime = 0.0;
+            size_t rasterized = 0, occluded = 0;
+            for (int i = 0; i < FRAME_COUNT; i++) {
+                culler.BeginFrame(viewProjections[i]);
+                culler.AddOccluder(city, glm::mat4(1.0f));
+                culler.Rasterize();
+                culler.TestBoxes(props, visible);
+
+                OcclusionStats stats = culler.getStats();
+                rasterizeTime += stats.rasterizeMilliseconds;
+                testTime += stats.testMilliseconds;
+                rasterized += stats.rasterizedTriangles;
+                occluded += stats.occluded;
+            }
+            std::cout << "  " << (threaded ? pool.getThreadCount() : 1) << " thread(s): rasterize "
+                << rasterizeTime / FRAME_COUNT << " ms/frame (" << rasterized / FRAME_COUNT << " triangles), test "
+                << testTime / FRAME_COUNT << " ms/frame, " << occluded / FRAME_COUNT << " occluded" << std::endl;
+        }
+    }
+
+    //screen filling grid at eye space depth 0.5 facing the camera, as position, normal and texture coordinates
+    static GLuint createBenchmarkGrid(int columns, int rows, GLuint buffers[2], GLsizei& indexCount) {
+        std::vector<GLfloat> vertices;
+        for (int y = 0; y <= rows; y++) {
+            for (int x = 0; x <= columns; x++) {
+                float u = (float)x / columns, v = (float)y / rows;
+                const GLfloat vertex[8] = { u * 2.0f - 1.0f, v * 2.0f - 1.0f, -0.5f, 0.0f, 0.0f, 1.0f, u * 4.0f, v * 4.0f };
+                vertices.insert(vertices.end(), vertex, vertex + 8);
+            }
+        }
+        std::vector<GLuint> indices;
+        for (int y = 0; y < rows; y++) {
+            for (int x = 0; x < columns; x++) {
+                GLuint corner = y * (columns + 1) + x;
+                const GLuint quad[6] = { corner, corner + 1, corner + columns + 2, corner, corner + columns + 2, corner + columns + 1 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+        indexCount = (GLsizei)indices.size();
+
+        GLuint vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glGenBuffers(2, buffers);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        //same attribute locations as gps::Mesh
+        for (GLuint attribute = 0; attribute < 3; attribute++) {
+            const GLint sizes[3] = { 3, 3, 2 };
+            const size_t offsets[3] = { 0, 3, 6 };
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribPointer(attribute, sizes[attribute], GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
+                (GLvoid*)(offsets[attribute] * sizeof(GLfloat)));
+        }
+        glBindVertexArray(0);
+        return vao;
+    }
+
+    //noise texture, so the fetches are not all served by one cache line
+    static GLuint createBenchmarkTexture(int size, std::mt19937& generator) {
+        std::uniform_int_distribution<int> channel(0, 255);
+        std::vector<GLubyte> texels(size * size * 4);
+        for (size_t i = 0; i < texels.size(); i++) {
+            texels[i] = (GLubyte)channel(generator);
+        }
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        return texture;
+    }
+
+    //the uniforms of both the reference and the eye space scene shaders, a program ignores the ones it does not have
+    static void uploadBenchmarkUniforms(gps::Shader shader) {
+        GLuint program = shader.shaderProgram;
+        glm::mat4 identity = glm::mat4(1.0f);
+        glm::mat3 normalMatrix = glm::mat3(1.0f);
+        glm::vec3 lightDir = glm::normalize(glm::vec3(0.3f, 0.5f, 1.0f));
+        glm::vec3 lightColor = glm::vec3(1.0f);
+        glm::vec3 fogDensity = glm::vec3(0.2f, 0.0f, 0.0f);
+        glm::vec3 lightPosition = glm::vec3(0.5f, 0.5f, 0.5f);
+
+        shader.useShaderProgram();
+        //the eye space shader reads its model and normal matrix from the draw data RunShaderBenchmark binds
+        RenderQueue::BindDrawUniforms(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(identity));
+        glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(identity));
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(identity));
+        glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(identity));
+        glUniformMatrix3fv(glGetUniformLocation(program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        glUniform3fv(glGetUniformLocation(program, "lightDir"), 1, glm::value_ptr(lightDir));
+        glUniform3fv(glGetUniformLocation(program, "lightDirEye"), 1, glm::value_ptr(lightDir));
+        glUniform3fv(glGetUniformLocation(program, "lightColor"), 1, glm::value_ptr(lightColor));
+        glUniform3fv(glGetUniformLocation(program, "fogDensity"), 1, glm::value_ptr(fogDensity));
+        glUniform3fv(glGetUniformLocation(program, "lightPosition"), 1, glm::value_ptr(lightPosition));
+        glUniform1i(glGetUniformLocation(program, "diffuseTexture"), 0);
+        glUniform1i(glGetUniformLocation(program, "specularTexture"), 1);
+        glUniform1i(glGetUniformLocation(program, "shadowMap"), 3);
+
+        //every fragment lands inside the first cascade
+        glm::mat4 cascadeMatrices[4] = { identity, identity, identity, identity };
+        const GLfloat farPlanes[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+        const GLfloat biases[4] = { 0.001f, 0.001f, 0.001f, 0.001f };
+        glUniformMatrix4fv(glGetUniformLocation(program, "lightSpaceTrMatrices"), 4, GL_FALSE, glm::value_ptr(cascadeMatrices[0]));
+        glUniform1fv(glGetUniformLocation(program, "cascadeFarPlanes"), 4, farPlanes);
+        glUniform1fv(glGetUniformLocation(program, "cascadeBiases"), 4, biases);
+        glUniform1i(glGetUniformLocation(program, "cascadeCount"), 4);
+    }
+
+    //size of the linked program in the driver's own format, the closest portable measure of its instruction count
+    static GLint programBinaryLength(gps::Shader shader) {
+        GLint length = 0;
+        glGetProgramiv(shader.shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+        return length;
+    }
+
+    //gpu milliseconds of frameCount frames, each drawing the grid overdraw times
+    static double timeShaderFrames(gps::Shader shader, GLuint vao, GLsizei indexCount, int frameCount, int overdraw) {
+        uploadBenchmarkUniforms(shader);
+        glBindVertexArray(vao);
+        //warm up, the first draws with a program may include its final compile
+        for (int i = 0; i < overdraw; i++) {
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        }
+        glFinish();
+
+        GLuint query;
+        glGenQueries(1, &query);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (int frame = 0; frame < frameCount; frame++) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            for (int i = 0; i < overdraw; i++) {
+                glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+            }
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        //the benchmark is the only work, waiting for the result is fine here
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        glDeleteQueries(1, &query);
+        glBindVertexArray(0);
+        return nanoseconds / 1.0e6;
+    }
+
+    void RunShaderBenchmark(int width, int height) {
+        const int FRAME_COUNT = 50;
+        const int OVERDRAW = 8;
+        std::mt19937 generator(1234);
+
+        //offscreen target, the window of a headless run may not have a usable framebuffer
+        GLuint framebuffer, renderbuffers[2];
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        glViewport(0, 0, width, height);
+        //every layer of the overdraw is shaded, so the time is the fill rate of the shader
+        glDisable(GL_DEPTH_TEST);
+
+        GLuint gridBuffers[2];
+        GLsizei indexCount = 0;
+        GLuint grid = createBenchmarkGrid(64, 36, gridBuffers, indexCount);
+
+        GLuint textures[2] = { createBenchmarkTexture(512, generator), createBenchmarkTexture(512, generator) };
+
+        DrawData drawData = DrawData();
+        drawData.model = glm::mat4(1.0f);
+        drawData.normalMatrix = glm::mat4(1.0f);
+        GLuint drawDataBuffer;
+        glGenBuffers(1, &drawDataBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, drawDataBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(DrawData), &drawData, GL_STATIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, drawDataBuffer);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+
+        GLuint shadowMap;
+        glGenTextures(1, &shadowMap);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, 1024, 1024, 4, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glActiveTexture(GL_TEXTURE0);
+
+        std::cout << "Shader benchmark, " << width << "x" << height << ", " << OVERDRAW << " full screen layers per frame, "
+            << FRAME_COUNT << " frames" << std::endl;
+
+        {
+            gps::ShaderPermutations reference;
+            reference.Init("shaders/basic_reference.vert", "shaders/basic_reference.frag");
+            gps::ShaderPermutations eyeSpace;
+            eyeSpace.Init("shaders/basic.vert", "shaders/basic.frag");
+
+            //the eye space shader reads its point lights from the froxel lists, here the reference shader's
+            //one light with a radius that reaches every froxel
+            gps::ClusteredLights clusteredLights;
+            clusteredLights.Init(NULL);
+            gps::PointLight light;
+            light.position = glm::vec3(0.5f, 0.5f, 0.5f);
+            light.radius = 100.0f;
+            light.color = glm::vec3(1.0f, 0.0f, 0.0f);
+            clusteredLights.setLights(std::vector<gps::PointLight>(1, light));
+
+            //the eye space shader samples the two textures as the layers of material 0
+            gps::MaterialLibrary materials;
+            materials.AddMaterial(textures[0], textures[1]);
+            materials.Build();
+            clusteredLights.Update(glm::mat4(1.0f), glm::radians(90.0f), width, height, 0.1f, 20.0f);
+
+            const char* names[4] = { "no features", "shadows", "all features", "all features, 3x3 pcf" };
+            const uint32_t features[4] = { 0, gps::SHADER_SHADOWS, gps::SHADER_ALL_FEATURES, gps::SHADER_ALL_FEATURES };
+            const int qualities[4] = { 0, 0, 0, 2 };
+            double fragments = (double)width * height * OVERDRAW * FRAME_COUNT;
+            for (int i = 0; i < 4; i++) {
+                gps::Shader shaders[2] = { reference.getShader(features[i], qualities[i]), eyeSpace.getShader(features[i], qualities[i]) };
+                double milliseconds[2];
+                std::cout << "  " << names[i] << std::endl;
+                clusteredLights.Bind(shaders[1], 4);
+                materials.BindTextures(shaders[1], 8);
+                for (int s = 0; s < 2; s++) {
+                    milliseconds[s] = timeShaderFrames(shaders[s], grid, indexCount, FRAME_COUNT, OVERDRAW);
+                    std::cout << "    " << (s == 0 ? "reference" : "eye space") << ": " << milliseconds[s] / FRAME_COUNT
+                        << " ms/frame, " << fragments / (milliseconds[s] * 1.0e6) << " Gfragments/s, program binary "
+                        << programBinaryLength(shaders[s]) << " bytes" << std::endl;
+                }
+                std::cout << "    speedup " << milliseconds[0] / milliseconds[1] << "x" << std::endl;
+            }
+        }
+
+        glDeleteTextures(1, &shadowMap);
+        glDeleteTextures(2, textures);
+        glBindBufferBase(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, 0);
+        glDeleteBuffers(1, &drawDataBuffer);
+        glDeleteVertexArrays(1, &grid);
+        glDeleteBuffers(2, gridBuffers);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <cstddef>
+
+namespace gps {
+
+    //headless benchmarks, run with --benchmark instead of opening the window
+
+    //builds a bvh over objectCount random boxes and times frustum, ray and sphere queries
+    //against testing every box
+    void RunBvhBenchmark(size_t objectCount);
+    //moves movingCount of objectCount boxes every frame and times refitting the bvh
+    //against rebuilding it, along with the quality of the refitted tree
+    void RunBvhRefitBenchmark(size_t objectCount, size_t movingCount);
+    //rasterizes a grid of buildings into the software depth buffer and tests occludeeCount props
+    //behind them, on one thread and on every hardware thread
+    void RunOcclusionBenchmark(size_t occludeeCount);
+    //draws full screen layers with the reference and the eye space scene shader variants into an offscreen
+    //target and compares their gpu time, fill rate and program size, needs a current context
+    void RunShaderBenchmark(int width, int height);
+}
+
+#endif /* Benchmark_hpp */
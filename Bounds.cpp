@@ -0,0 +1,79 @@
+#include "Bounds.hpp"
+
+#include <cfloat>
+#include <cmath>
+
+namespace gps {
+
+    BoundingBox EmptyBox() {
+        BoundingBox box;
+        box.min = glm::vec3(FLT_MAX);
+        box.max = glm::vec3(-FLT_MAX);
+        return box;
+    }
+
+    BoundingBox MergeBoxes(const BoundingBox& a, const BoundingBox& b) {
+        BoundingBox box;
+        box.min = glm::min(a.min, b.min);
+        box.max = glm::max(a.max, b.max);
+        return box;
+    }
+
+    glm::vec3 BoxCenter(const BoundingBox& box) {
+        return (box.min + box.max) * 0.5f;
+    }
+
+    glm::vec3 BoxExtent(const BoundingBox& box) {
+        return (box.max - box.min) * 0.5f;
+    }
+
+    float BoxSurfaceArea(const BoundingBox& box) {
+        glm::vec3 size = box.max - box.min;
+        if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f) {
+            return 0.0f;
+        }
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    BoundingBox TransformBox(const BoundingBox& box, const glm::mat4& transform) {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(BoxCenter(box), 1.0f));
+        glm::vec3 extent = BoxExtent(box);
+
+        glm::vec3 worldExtent;
+        for (int row = 0; row < 3; row++) {
+            worldExtent[row] = std::fabs(transform[0][row]) * extent.x +
+                std::fabs(transform[1][row]) * extent.y +
+                std::fabs(transform[2][row]) * extent.z;
+        }
+
+        BoundingBox result;
+        result.min = center - worldExtent;
+        result.max = center + worldExtent;
+        return result;
+    }
+
+    void BoxListSoA::clear() {
+        centerX.clear(); centerY.clear(); centerZ.clear();
+        extentX.clear(); extentY.clear(); extentZ.clear();
+    }
+
+    void BoxListSoA::push(const BoundingBox& box) {
+        glm::vec3 center = BoxCenter(box);
+        glm::vec3 extent = BoxExtent(box);
+        centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+        extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+    }
+
+    size_t BoxListSoA::size() const {
+        return centerX.size();
+    }
+
+    void BoxListSoA::pad(size_t width) {
+        BoundingBox empty;
+        empty.min = glm::vec3(0.0f);
+        empty.max = glm::vec3(0.0f);
+        while (size() % width != 0) {
+            push(empty);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef Bounds_hpp
+#define Bounds_hpp
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    struct BoundingBox
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    struct BoundingSphere
+    {
+        glm::vec3 center;
+        float radius;
+    };
+
+    //box that is empty until a point is added to it
+    BoundingBox EmptyBox();
+    BoundingBox MergeBoxes(const BoundingBox& a, const BoundingBox& b);
+    glm::vec3 BoxCenter(const BoundingBox& box);
+    glm::vec3 BoxExtent(const BoundingBox& box);
+    float BoxSurfaceArea(const BoundingBox& box);
+    //world space box of a transformed box, using the absolute matrix to project the extent
+    BoundingBox TransformBox(const BoundingBox& box, const glm::mat4& transform);
+
+    //boxes stored as separate center/extent component arrays, so they can be tested several at a time
+    struct BoxListSoA
+    {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        void clear();
+        void push(const BoundingBox& box);
+        size_t size() const;
+        //pads the arrays with empty boxes up to a multiple of the given width
+        void pad(size_t width);
+    };
+}
+
+#endif /* Bounds_hpp */
@@ -0,0 +1,589 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace gps {
+
+    const int SAH_BINS = 16;
+    //traversal pushes two children per popped node, so the stack never holds more than depth + 1 entries
+    const int MAX_STACK_DEPTH = 64;
+    const int MAX_TREE_DEPTH = MAX_STACK_DEPTH - 2;
+    const uint32_t NO_PARENT = 0xffffffffu;
+
+    Bvh::Bvh() {
+        nodesUsed = 0;
+        lastQueryStats = BvhQueryStats();
+        lastRefitStats = BvhRefitStats();
+        garbageNodes = 0;
+        rebuildThreshold = 2.0f;
+    }
+
+    BoundingBox Bvh::nodeBox(const BvhNode& node) {
+        BoundingBox box;
+        box.min = node.aabbMin;
+        box.max = node.aabbMax;
+        return box;
+    }
+
+    void Bvh::Build(const std::vector<BoundingBox>& boxes) {
+        primitiveBounds = boxes;
+        size_t count = boxes.size();
+
+        centroids.resize(count);
+        primitiveIndices.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            centroids[i] = BoxCenter(boxes[i]);
+            primitiveIndices[i] = (uint32_t)i;
+        }
+
+        //a binary tree over n primitives never needs more than 2n - 1 nodes,
+        //node 1 stays unused so that sibling pairs share a cache line
+        nodes.clear();
+        resizeNodes(std::max<size_t>(2 * count, 2));
+        nodesUsed = 2;
+        primitiveLeaves.assign(count, 0);
+        dirtyLeaves.clear();
+        garbageNodes = 0;
+
+        BvhNode& root = nodes[0];
+        root.leftFirst = 0;
+        root.count = (uint32_t)count;
+        if (count == 0) {
+            root.aabbMin = root.aabbMax = glm::vec3(0.0f);
+            nodesUsed = 1;
+            return;
+        }
+        updateNodeBounds(0);
+        subdivide(0, 0);
+        linkSubtree(0, NO_PARENT);
+    }
+
+    void Bvh::resizeNodes(size_t count) {
+        nodes.resize(count, BvhNode());
+        parents.resize(count, NO_PARENT);
+        buildAreas.resize(count, 0.0f);
+        dirtyFlags.resize(count, 0);
+    }
+
+    //records parents, leaf of every primitive and the build time area of each node of the subtree
+    void Bvh::linkSubtree(uint32_t nodeIndex, uint32_t parent) {
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        parents[nodeIndex] = parent;
+        stack[stackSize++] = nodeIndex;
+        while (stackSize > 0) {
+            uint32_t current = stack[--stackSize];
+            const BvhNode& node = nodes[current];
+            buildAreas[current] = BoxSurfaceArea(nodeBox(node));
+            dirtyFlags[current] = 0;
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; i++) {
+                    primitiveLeaves[primitiveIndices[node.leftFirst + i]] = current;
+                }
+            }
+            else {
+                parents[node.leftFirst] = current;
+                parents[node.leftFirst + 1] = current;
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            }
+        }
+    }
+
+    int Bvh::nodeDepth(uint32_t nodeIndex) {
+        int depth = 0;
+        while (parents[nodeIndex] != NO_PARENT) {
+            nodeIndex = parents[nodeIndex];
+            depth++;
+        }
+        return depth;
+    }
+
+    void Bvh::setRebuildThreshold(float areaGrowth) {
+        rebuildThreshold = areaGrowth;
+    }
+
+    void Bvh::UpdatePrimitive(uint32_t primitive, const BoundingBox& box) {
+        primitiveBounds[primitive] = box;
+        centroids[primitive] = BoxCenter(box);
+
+        uint32_t leaf = primitiveLeaves[primitive];
+        if (!dirtyFlags[leaf]) {
+            dirtyFlags[leaf] = 1;
+            dirtyLeaves.push_back(leaf);
+        }
+    }
+
+    BvhRefitStats Bvh::Refit() {
+        lastRefitStats = BvhRefitStats();
+
+        //the highest node that outgrew its build area, its subtree gets rebuilt
+        uint32_t rebuildNode = NO_PARENT;
+        int rebuildDepth = MAX_TREE_DEPTH + 1;
+
+        for (size_t d = 0; d < dirtyLeaves.size(); d++) {
+            uint32_t current = dirtyLeaves[d];
+            dirtyFlags[current] = 0;
+            updateNodeBounds(current);
+            lastRefitStats.leavesRefit++;
+            lastRefitStats.nodesRefit++;
+
+            while (true) {
+                if (BoxSurfaceArea(nodeBox(nodes[current])) > rebuildThreshold * buildAreas[current]) {
+                    int depth = nodeDepth(current);
+                    if (depth < rebuildDepth) {
+                        rebuildDepth = depth;
+                        rebuildNode = current;
+                    }
+                }
+
+                uint32_t parent = parents[current];
+                if (parent == NO_PARENT) {
+                    break;
+                }
+
+                //stop as soon as a parent box does not change, the ones above it cannot change either
+                BvhNode& parentNode = nodes[parent];
+                BoundingBox merged = MergeBoxes(nodeBox(nodes[parentNode.leftFirst]), nodeBox(nodes[parentNode.leftFirst + 1]));
+                if (merged.min == parentNode.aabbMin && merged.max == parentNode.aabbMax) {
+                    break;
+                }
+                parentNode.aabbMin = merged.min;
+                parentNode.aabbMax = merged.max;
+                lastRefitStats.nodesRefit++;
+                current = parent;
+            }
+        }
+        dirtyLeaves.clear();
+
+        if (rebuildNode == 0 || garbageNodes > nodesUsed / 2) {
+            //rebuilding from the root also compacts the nodes orphaned by subtree rebuilds
+            std::vector<BoundingBox> boxes = primitiveBounds;
+            Build(boxes);
+            lastRefitStats.fullRebuilds++;
+            lastRefitStats.rebuiltPrimitives = (unsigned int)boxes.size();
+        }
+        else if (rebuildNode != NO_PARENT) {
+            rebuildSubtree(rebuildNode);
+        }
+        return lastRefitStats;
+    }
+
+    //the primitives of a subtree are a contiguous range of primitiveIndices, so the subtree root
+    //becomes a leaf over that range and is subdivided again into nodes appended to the array
+    void Bvh::rebuildSubtree(uint32_t nodeIndex) {
+        uint32_t first = 0xffffffffu;
+        uint32_t count = 0;
+        uint32_t subtreeNodes = 0;
+
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = nodeIndex;
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            subtreeNodes++;
+            if (node.count > 0) {
+                first = std::min(first, node.leftFirst);
+                count += node.count;
+            }
+            else {
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            }
+        }
+
+        garbageNodes += subtreeNodes - 1;
+        resizeNodes(std::max<size_t>(nodes.size(), nodesUsed + 2 * (size_t)count));
+
+        BvhNode& root = nodes[nodeIndex];
+        root.leftFirst = first;
+        root.count = count;
+        updateNodeBounds(nodeIndex);
+        subdivide(nodeIndex, nodeDepth(nodeIndex));
+        linkSubtree(nodeIndex, parents[nodeIndex]);
+
+        lastRefitStats.partialRebuilds++;
+        lastRefitStats.rebuiltPrimitives += count;
+    }
+
+    void Bvh::updateNodeBounds(uint32_t nodeIndex) {
+        BvhNode& node = nodes[nodeIndex];
+        BoundingBox box = EmptyBox();
+        for (uint32_t i = 0; i < node.count; i++) {
+            box = MergeBoxes(box, primitiveBounds[primitiveIndices[node.leftFirst + i]]);
+        }
+        node.aabbMin = box.min;
+        node.aabbMax = box.max;
+    }
+
+    float Bvh::findBestSplit(const BvhNode& node, int& axis, float& splitPosition) {
+        float bestCost = FLT_MAX;
+        for (int a = 0; a < 3; a++) {
+            //bins are spread over the centroid bounds, not the node bounds
+            float boundsMin = FLT_MAX, boundsMax = -FLT_MAX;
+            for (uint32_t i = 0; i < node.count; i++) {
+                float c = centroids[primitiveIndices[node.leftFirst + i]][a];
+                boundsMin = std::min(boundsMin, c);
+                boundsMax = std::max(boundsMax, c);
+            }
+            if (boundsMin == boundsMax) {
+                continue;
+            }
+
+            BoundingBox binBounds[SAH_BINS];
+            int binCounts[SAH_BINS] = { 0 };
+            for (int b = 0; b < SAH_BINS; b++) {
+                binBounds[b] = EmptyBox();
+            }
+
+            float scale = SAH_BINS / (boundsMax - boundsMin);
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t primitive = primitiveIndices[node.leftFirst + i];
+                int bin = std::min(SAH_BINS - 1, (int)((centroids[primitive][a] - boundsMin) * scale));
+                binCounts[bin]++;
+                binBounds[bin] = MergeBoxes(binBounds[bin], primitiveBounds[primitive]);
+            }
+
+            //sweep from both sides to get the cost of every plane between two bins
+            float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+            int leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+            BoundingBox leftBox = EmptyBox(), rightBox = EmptyBox();
+            int leftSum = 0, rightSum = 0;
+            for (int i = 0; i < SAH_BINS - 1; i++) {
+                leftSum += binCounts[i];
+                leftCount[i] = leftSum;
+                leftBox = MergeBoxes(leftBox, binBounds[i]);
+                leftArea[i] = BoxSurfaceArea(leftBox);
+
+                rightSum += binCounts[SAH_BINS - 1 - i];
+                rightCount[SAH_BINS - 2 - i] = rightSum;
+                rightBox = MergeBoxes(rightBox, binBounds[SAH_BINS - 1 - i]);
+                rightArea[SAH_BINS - 2 - i] = BoxSurfaceArea(rightBox);
+            }
+
+            float binWidth = (boundsMax - boundsMin) / SAH_BINS;
+            for (int i = 0; i < SAH_BINS - 1; i++) {
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost) {
+                    bestCost = cost;
+                    axis = a;
+                    splitPosition = boundsMin + binWidth * (i + 1);
+                }
+            }
+        }
+        return bestCost;
+    }
+
+    void Bvh::subdivide(uint32_t nodeIndex, int depth) {
+        BvhNode& node = nodes[nodeIndex];
+        if (node.count <= 1 || depth >= MAX_TREE_DEPTH) {
+            return;
+        }
+
+        int axis = 0;
+        float splitPosition = 0.0f;
+        float splitCost = findBestSplit(node, axis, splitPosition);
+        float leafCost = node.count * BoxSurfaceArea(nodeBox(node));
+        if (splitCost >= leafCost) {
+            return;
+        }
+
+        //partition the primitive range around the split plane
+        uint32_t i = node.leftFirst;
+        uint32_t j = i + node.count - 1;
+        while (i <= j) {
+            if (centroids[primitiveIndices[i]][axis] < splitPosition) {
+                i++;
+            }
+            else {
+                std::swap(primitiveIndices[i], primitiveIndices[j]);
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+
+        uint32_t leftCount = i - node.leftFirst;
+        if (leftCount == 0 || leftCount == node.count) {
+            return;
+        }
+
+        uint32_t leftChild = nodesUsed++;
+        uint32_t rightChild = nodesUsed++;
+        nodes[leftChild].leftFirst = node.leftFirst;
+        nodes[leftChild].count = leftCount;
+        nodes[rightChild].leftFirst = i;
+        nodes[rightChild].count = node.count - leftCount;
+        node.leftFirst = leftChild;
+        node.count = 0;
+
+        updateNodeBounds(leftChild);
+        updateNodeBounds(rightChild);
+        subdivide(leftChild, depth + 1);
+        subdivide(rightChild, depth + 1);
+    }
+
+    void Bvh::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result) {
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = nodeIndex;
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            lastQueryStats.nodesVisited++;
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; i++) {
+                    result.push_back(primitiveIndices[node.leftFirst + i]);
+                }
+            }
+            else {
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            }
+        }
+    }
+
+    void Bvh::QueryFrustum(const gps::Frustum& frustum, std::vector<uint32_t>& result) {
+        lastQueryStats = BvhQueryStats();
+        if (primitiveIndices.empty()) {
+            return;
+        }
+
+        const uint32_t allPlanes = (1u << PLANE_COUNT) - 1;
+        candidateBoxes.clear();
+        candidatePrimitives.clear();
+        uint32_t stack[MAX_STACK_DEPTH];
+        uint32_t masks[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        stack[stackSize] = 0;
+        masks[stackSize++] = allPlanes;
+
+        while (stackSize > 0) {
+            stackSize--;
+            const BvhNode& node = nodes[stack[stackSize]];
+            uint32_t mask = masks[stackSize];
+            lastQueryStats.nodesVisited++;
+
+            //only planes the parent straddled need testing, the rest already contain the node
+            glm::vec3 center = (node.aabbMin + node.aabbMax) * 0.5f;
+            glm::vec3 extent = (node.aabbMax - node.aabbMin) * 0.5f;
+            bool outside = false;
+            for (int p = 0; p < PLANE_COUNT && !outside; p++) {
+                if (!(mask & (1u << p))) {
+                    continue;
+                }
+                glm::vec3 normal = glm::vec3(frustum.planes[p]);
+                float distance = glm::dot(normal, center) + frustum.planes[p].w;
+                float radius = glm::dot(glm::abs(normal), extent);
+                if (distance < -radius) {
+                    outside = true;
+                }
+                else if (distance >= radius) {
+                    mask &= ~(1u << p);
+                }
+            }
+            if (outside) {
+                continue;
+            }
+
+            if (mask == 0) {
+                lastQueryStats.nodesVisited--;
+                appendSubtree(stack[stackSize], result);
+            }
+            else if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; i++) {
+                    uint32_t primitive = primitiveIndices[node.leftFirst + i];
+                    candidateBoxes.push(primitiveBounds[primitive]);
+                    candidatePrimitives.push_back(primitive);
+                }
+            }
+            else {
+                stack[stackSize] = node.leftFirst;
+                masks[stackSize++] = mask;
+                stack[stackSize] = node.leftFirst + 1;
+                masks[stackSize++] = mask;
+            }
+        }
+
+        //leaves hold few primitives, so they are tested all at once, several boxes per instruction
+        if (candidatePrimitives.empty()) {
+            return;
+        }
+        frustum.CullBoxes(candidateBoxes, candidateResults);
+        lastQueryStats.primitivesTested += (unsigned int)candidatePrimitives.size();
+        for (size_t i = 0; i < candidatePrimitives.size(); i++) {
+            if (candidateResults[i]) {
+                result.push_back(candidatePrimitives[i]);
+            }
+        }
+    }
+
+    //slab test, returns the entry distance or FLT_MAX when the box is missed
+    static float intersectBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const Ray& ray, const glm::vec3& inverseDirection) {
+        glm::vec3 t1 = (boxMin - ray.origin) * inverseDirection;
+        glm::vec3 t2 = (boxMax - ray.origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+        float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, ray.tMax));
+        return tEnter <= tExit ? tEnter : FLT_MAX;
+    }
+
+    bool Bvh::Raycast(const Ray& ray, float& hitDistance, uint32_t& hitPrimitive) {
+        lastQueryStats = BvhQueryStats();
+        if (primitiveIndices.empty()) {
+            return false;
+        }
+
+        glm::vec3 inverseDirection = glm::vec3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+        Ray clipped = ray;
+        bool hit = false;
+
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        if (intersectBox(nodes[0].aabbMin, nodes[0].aabbMax, ray, inverseDirection) == FLT_MAX) {
+            return false;
+        }
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            lastQueryStats.nodesVisited++;
+
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; i++) {
+                    uint32_t primitive = primitiveIndices[node.leftFirst + i];
+                    lastQueryStats.primitivesTested++;
+                    float t = intersectBox(primitiveBounds[primitive].min, primitiveBounds[primitive].max, clipped, inverseDirection);
+                    if (t != FLT_MAX) {
+                        clipped.tMax = t;
+                        hitPrimitive = primitive;
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            //visit the nearer child first, so farther subtrees get pruned by the shortened ray
+            uint32_t nearChild = node.leftFirst;
+            uint32_t farChild = node.leftFirst + 1;
+            float tNear = intersectBox(nodes[nearChild].aabbMin, nodes[nearChild].aabbMax, clipped, inverseDirection);
+            float tFar = intersectBox(nodes[farChild].aabbMin, nodes[farChild].aabbMax, clipped, inverseDirection);
+            if (tFar < tNear) {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+            if (tFar != FLT_MAX) {
+                stack[stackSize++] = farChild;
+            }
+            if (tNear != FLT_MAX) {
+                stack[stackSize++] = nearChild;
+            }
+        }
+
+        if (hit) {
+            hitDistance = clipped.tMax;
+        }
+        return hit;
+    }
+
+    //squared distance from the sphere centre to the box
+    static float distanceSquared(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& point) {
+        glm::vec3 closest = glm::min(glm::max(point, boxMin), boxMax);
+        glm::vec3 delta = point - closest;
+        return glm::dot(delta, delta);
+    }
+
+    void Bvh::QuerySphere(const BoundingSphere& sphere, std::vector<uint32_t>& result) {
+        lastQueryStats = BvhQueryStats();
+        if (primitiveIndices.empty()) {
+            return;
+        }
+
+        float radiusSquared = sphere.radius * sphere.radius;
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            lastQueryStats.nodesVisited++;
+            if (distanceSquared(node.aabbMin, node.aabbMax, sphere.center) > radiusSquared) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; i++) {
+                    uint32_t primitive = primitiveIndices[node.leftFirst + i];
+                    lastQueryStats.primitivesTested++;
+                    if (distanceSquared(primitiveBounds[primitive].min, primitiveBounds[primitive].max, sphere.center) <= radiusSquared) {
+                        result.push_back(primitive);
+                    }
+                }
+            }
+            else {
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            }
+        }
+    }
+
+    size_t Bvh::getNodeCount() {
+        //node 1 is the unused padding slot
+        return (nodesUsed > 1 ? nodesUsed - 1 : nodesUsed) - garbageNodes;
+    }
+
+    size_t Bvh::getPrimitiveCount() {
+        return primitiveIndices.size();
+    }
+
+    const BoundingBox& Bvh::getPrimitiveBounds(uint32_t primitive) {
+        return primitiveBounds[primitive];
+    }
+
+    BoundingBox Bvh::getBounds() {
+        return nodeBox(nodes[0]);
+    }
+
+    float Bvh::computeCost() {
+        if (primitiveIndices.empty()) {
+            return 0.0f;
+        }
+
+        //inner nodes cost one traversal step, leaves one test per primitive,
+        //each weighted by the chance of a random ray or box hitting them
+        const float traversalCost = 1.0f;
+        float rootArea = BoxSurfaceArea(nodeBox(nodes[0]));
+        if (rootArea <= 0.0f) {
+            return (float)primitiveIndices.size();
+        }
+
+        float cost = 0.0f;
+        uint32_t stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            float area = BoxSurfaceArea(nodeBox(node)) / rootArea;
+            if (node.count > 0) {
+                cost += area * node.count;
+            }
+            else {
+                cost += area * traversalCost;
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            }
+        }
+        return cost;
+    }
+
+    BvhQueryStats Bvh::getLastQueryStats() {
+        return lastQueryStats;
+    }
+
+    BvhRefitStats Bvh::getLastRefitStats() {
+        return lastRefitStats;
+    }
+}
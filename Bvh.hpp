@@ -0,0 +1,118 @@
+#ifndef Bvh_hpp
+#define Bvh_hpp
+
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    //32 byte node, two per cache line
+    //leaves have count > 0 and leftFirst indexes primitiveIndices,
+    //inner nodes have count == 0 and their children at leftFirst and leftFirst + 1
+    struct BvhNode
+    {
+        glm::vec3 aabbMin;
+        uint32_t leftFirst;
+        glm::vec3 aabbMax;
+        uint32_t count;
+    };
+
+    struct Ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        float tMax;
+    };
+
+    //work done by the last query
+    struct BvhQueryStats
+    {
+        unsigned int nodesVisited;
+        unsigned int primitivesTested;
+    };
+
+    //work done by the last refit
+    struct BvhRefitStats
+    {
+        unsigned int leavesRefit;
+        unsigned int nodesRefit;
+        unsigned int partialRebuilds;
+        unsigned int fullRebuilds;
+        unsigned int rebuiltPrimitives;
+    };
+
+    //bounding volume hierarchy over a set of boxes, built with the binned surface area heuristic
+    //and stored as a flat node array
+    //primitives may move: UpdatePrimitive marks their leaf and Refit grows the boxes bottom-up,
+    //rebuilding the subtrees whose boxes grew too much compared to when they were built
+    class Bvh
+    {
+    public:
+        Bvh();
+        //builds the tree over the boxes, primitive i of the queries is box i
+        void Build(const std::vector<BoundingBox>& boxes);
+        //appends the primitives that intersect the frustum, subtrees fully inside are taken without tests
+        //the primitives of the leaves that straddle a plane are gathered and tested together with Frustum::CullBoxes
+        void QueryFrustum(const gps::Frustum& frustum, std::vector<uint32_t>& result);
+        //nearest primitive box hit by the ray, false when nothing is hit before ray.tMax
+        bool Raycast(const Ray& ray, float& hitDistance, uint32_t& hitPrimitive);
+        //appends the primitives whose boxes intersect the sphere
+        void QuerySphere(const BoundingSphere& sphere, std::vector<uint32_t>& result);
+        //changes the box of a primitive, the tree is updated by the next Refit
+        void UpdatePrimitive(uint32_t primitive, const BoundingBox& box);
+        //refits the nodes above the updated leaves, cost grows with the number of moved primitives
+        BvhRefitStats Refit();
+        //surface area growth of a node, relative to its build, that triggers a rebuild of its subtree
+        void setRebuildThreshold(float areaGrowth);
+
+        size_t getNodeCount();
+        size_t getPrimitiveCount();
+        //current box of a primitive, as last given to Build or UpdatePrimitive
+        const BoundingBox& getPrimitiveBounds(uint32_t primitive);
+        BoundingBox getBounds();
+        //surface area heuristic cost of the tree, relative to testing every primitive of the root
+        float computeCost();
+        BvhQueryStats getLastQueryStats();
+        BvhRefitStats getLastRefitStats();
+
+    protected:
+        std::vector<BvhNode> nodes;
+        std::vector<uint32_t> primitiveIndices;
+        std::vector<BoundingBox> primitiveBounds;
+        std::vector<glm::vec3> centroids;
+        uint32_t nodesUsed;
+        BvhQueryStats lastQueryStats;
+        //primitives of the straddling leaves of the last frustum query, in the SoA layout of the SIMD test
+        BoxListSoA candidateBoxes;
+        std::vector<uint32_t> candidatePrimitives;
+        std::vector<uint8_t> candidateResults;
+
+        //refit bookkeeping, indexed by node or by primitive
+        std::vector<uint32_t> parents;
+        std::vector<float> buildAreas;
+        std::vector<uint8_t> dirtyFlags;
+        std::vector<uint32_t> primitiveLeaves;
+        std::vector<uint32_t> dirtyLeaves;
+        //nodes left unreachable by subtree rebuilds
+        uint32_t garbageNodes;
+        float rebuildThreshold;
+        BvhRefitStats lastRefitStats;
+
+        void updateNodeBounds(uint32_t nodeIndex);
+        void subdivide(uint32_t nodeIndex, int depth);
+        float findBestSplit(const BvhNode& node, int& axis, float& splitPosition);
+        void appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result);
+        void linkSubtree(uint32_t nodeIndex, uint32_t parent);
+        void rebuildSubtree(uint32_t nodeIndex);
+        int nodeDepth(uint32_t nodeIndex);
+        void resizeNodes(size_t count);
+        static BoundingBox nodeBox(const BvhNode& node);
+    };
+}
+
+#endif /* Bvh_hpp */
@@ -19,6 +19,10 @@ namespace gps {
         return glm::lookAt(cameraPosition, cameraPosition+cameraFrontDirection, cameraUpDirection);
     }
 
+    glm::vec3 Camera::getPosition() {
+        return cameraPosition;
+    }
+
     //update the camera internal parameters following a camera move event
     void Camera::move(MOVE_DIRECTION direction, float speed) {
         //TODO
@@ -0,0 +1,255 @@
+#include "CascadedShadowMap.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cfloat>
+
+namespace gps {
+
+    //cascade count and resolution of each quality tier
+    const int TIER_CASCADES[SHADOW_QUALITY_COUNT] = { 2, 3, 4 };
+    const GLsizei TIER_RESOLUTIONS[SHADOW_QUALITY_COUNT] = { 1024, 2048, 2048 };
+    //weight of the logarithmic split against the uniform one, a pure logarithmic split
+    //gives the first cascade only the few centimeters in front of the near plane
+    const float SPLIT_LOG_WEIGHT = 0.8f;
+    //radii are rounded up to this step, so float noise in the slice corners never changes a projection
+    const float RADIUS_STEP = 1.0f / 16.0f;
+    const float BIAS_TEXELS = 2.0f;
+
+    CascadedShadowMap::CascadedShadowMap() {
+        quality = SHADOW_QUALITY_MEDIUM;
+        cascadeCount = 0;
+        resolution = 0;
+        shadowMapFBO = 0;
+        shadowMapTexture = 0;
+        lightView = glm::mat4(1.0f);
+        for (int i = 0; i < MAX_CASCADES; i++) {
+            cascades[i] = Cascade();
+            cascades[i].rendered = false;
+        }
+    }
+
+    CascadedShadowMap::~CascadedShadowMap() {
+        if (shadowMapFBO != 0) {
+            glDeleteFramebuffers(1, &shadowMapFBO);
+            glDeleteTextures(1, &shadowMapTexture);
+        }
+    }
+
+    void CascadedShadowMap::Init(ShadowQuality shadowQuality) {
+        if (shadowMapFBO != 0) {
+            glDeleteFramebuffers(1, &shadowMapFBO);
+            glDeleteTextures(1, &shadowMapTexture);
+        }
+        quality = shadowQuality;
+        cascadeCount = TIER_CASCADES[quality];
+        resolution = TIER_RESOLUTIONS[quality];
+        for (int i = 0; i < MAX_CASCADES; i++) {
+            cascades[i].rendered = false;
+        }
+
+        glGenTextures(1, &shadowMapTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMapTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascadeCount, 0,
+            GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &shadowMapFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMapTexture, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void CascadedShadowMap::Update(const glm::mat4& cameraViewProjection, float nearPlane, float farPlane,
+        const glm::mat4& view, const BoundingBox& sceneBounds) {
+        lightView = view;
+        BoundingBox lightSceneBounds = TransformBox(sceneBounds, lightView);
+
+        //world space corners of the near and far planes, a point at view distance d along a corner ray
+        //is the linear interpolation between them at (d - near) / (far - near)
+        glm::mat4 inverseViewProjection = glm::inverse(cameraViewProjection);
+        glm::vec3 nearCorners[4];
+        glm::vec3 farCorners[4];
+        for (int i = 0; i < 4; i++) {
+            float x = (i & 1) ? 1.0f : -1.0f;
+            float y = (i & 2) ? 1.0f : -1.0f;
+            glm::vec4 nearCorner = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+            glm::vec4 farCorner = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+            nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+            farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+        }
+
+        float splitNear = nearPlane;
+        for (int c = 0; c < cascadeCount; c++) {
+            float ratio = (float)(c + 1) / (float)cascadeCount;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, ratio);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * ratio;
+            float splitFar = SPLIT_LOG_WEIGHT * logSplit + (1.0f - SPLIT_LOG_WEIGHT) * uniformSplit;
+
+            glm::vec3 corners[8];
+            float tNear = (splitNear - nearPlane) / (farPlane - nearPlane);
+            float tFar = (splitFar - nearPlane) / (farPlane - nearPlane);
+            for (int i = 0; i < 4; i++) {
+                corners[i] = glm::mix(nearCorners[i], farCorners[i], tNear);
+                corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], tFar);
+            }
+
+            cascades[c].splitNear = splitNear;
+            cascades[c].splitFar = splitFar;
+            fitCascade(cascades[c], corners, lightSceneBounds);
+            splitNear = splitFar;
+        }
+    }
+
+    void CascadedShadowMap::fitCascade(Cascade& cascade, const glm::vec3 corners[8], const BoundingBox& lightSceneBounds) {
+        //the bounding sphere of the slice has the same size however the camera is turned
+        glm::vec3 center = glm::vec3(0.0f);
+        for (int i = 0; i < 8; i++) {
+            center += corners[i];
+        }
+        center /= 8.0f;
+        float radius = 0.0f;
+        for (int i = 0; i < 8; i++) {
+            radius = glm::max(radius, glm::length(corners[i] - center));
+        }
+        radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+        //one texel of margin on each side, so snapping the center never cuts the slice
+        float texelSize = 2.0f * radius / (float)(resolution - 2);
+        float halfSize = radius + texelSize;
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+
+        //light space rectangle of the slice, only the part inside the scene has anything to shadow
+        glm::vec2 sliceMin = glm::vec2(FLT_MAX);
+        glm::vec2 sliceMax = glm::vec2(-FLT_MAX);
+        for (int i = 0; i < 8; i++) {
+            glm::vec4 corner = lightView * glm::vec4(corners[i], 1.0f);
+            sliceMin = glm::min(sliceMin, glm::vec2(corner.x, corner.y));
+            sliceMax = glm::max(sliceMax, glm::vec2(corner.x, corner.y));
+        }
+
+        //an axis the scene fits in takes the scene extent, which never moves; otherwise the square
+        //is kept inside the scene and its center moves in whole texels
+        float lo[2];
+        float hi[2];
+        float largestExtent = 0.0f;
+        for (int axis = 0; axis < 2; axis++) {
+            float sceneMin = lightSceneBounds.min[axis];
+            float sceneMax = lightSceneBounds.max[axis];
+            if (sceneMax - sceneMin <= 2.0f * halfSize) {
+                lo[axis] = sceneMin;
+                hi[axis] = sceneMax;
+            }
+            else {
+                float axisCenter = glm::clamp(lightCenter[axis], sceneMin + halfSize, sceneMax - halfSize);
+                axisCenter = std::floor(axisCenter / texelSize) * texelSize;
+                lo[axis] = axisCenter - halfSize;
+                hi[axis] = axisCenter + halfSize;
+            }
+            largestExtent = glm::max(largestExtent, hi[axis] - lo[axis]);
+            sliceMin[axis] = glm::clamp(sliceMin[axis], sceneMin, sceneMax);
+            sliceMax[axis] = glm::clamp(sliceMax[axis], sceneMin, sceneMax);
+        }
+
+        //light space looks down -z, every caster and receiver of the scene is inside its depth range
+        float depthPadding = glm::max(0.01f * (lightSceneBounds.max.z - lightSceneBounds.min.z), 0.01f);
+        float zNear = -lightSceneBounds.max.z - depthPadding;
+        float zFar = -lightSceneBounds.min.z + depthPadding;
+
+        cascade.boundsMin = glm::vec2(lo[0], lo[1]);
+        cascade.boundsMax = glm::vec2(hi[0], hi[1]);
+        cascade.sliceMin = sliceMin;
+        cascade.sliceMax = sliceMax;
+        cascade.texelSize = largestExtent / (float)resolution;
+        cascade.lightProjection = glm::ortho(lo[0], hi[0], lo[1], hi[1], zNear, zFar);
+        cascade.lightSpaceTrMatrix = cascade.lightProjection * lightView;
+        cascade.depthBias = BIAS_TEXELS * cascade.texelSize / (zFar - zNear);
+    }
+
+    void CascadedShadowMap::MarkRendered(int cascade) {
+        cascades[cascade].renderedLightSpaceTrMatrix = cascades[cascade].lightSpaceTrMatrix;
+        cascades[cascade].renderedBoundsMin = cascades[cascade].boundsMin;
+        cascades[cascade].renderedBoundsMax = cascades[cascade].boundsMax;
+        cascades[cascade].renderedDepthBias = cascades[cascade].depthBias;
+        cascades[cascade].rendered = true;
+    }
+
+    bool CascadedShadowMap::isCovered(int cascade) {
+        const Cascade& c = cascades[cascade];
+        return c.rendered &&
+            c.sliceMin.x >= c.renderedBoundsMin.x && c.sliceMin.y >= c.renderedBoundsMin.y &&
+            c.sliceMax.x <= c.renderedBoundsMax.x && c.sliceMax.y <= c.renderedBoundsMax.y;
+    }
+
+    void CascadedShadowMap::BindCascade(int cascade) {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMapTexture, 0, cascade);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    void CascadedShadowMap::BindLayered() {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMapTexture, 0);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    void CascadedShadowMap::UploadUniforms(gps::Shader shader) {
+        glm::mat4 matrices[MAX_CASCADES];
+        float farPlanes[MAX_CASCADES];
+        float biases[MAX_CASCADES];
+        for (int i = 0; i < cascadeCount; i++) {
+            matrices[i] = cascades[i].renderedLightSpaceTrMatrix;
+            farPlanes[i] = cascades[i].splitFar;
+            biases[i] = cascades[i].renderedDepthBias;
+        }
+
+        shader.useShaderProgram();
+        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrices"), cascadeCount, GL_FALSE,
+            glm::value_ptr(matrices[0]));
+        glUniform1fv(glGetUniformLocation(shader.shaderProgram, "cascadeFarPlanes"), cascadeCount, farPlanes);
+        glUniform1fv(glGetUniformLocation(shader.shaderProgram, "cascadeBiases"), cascadeCount, biases);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "cascadeCount"), cascadeCount);
+    }
+
+    ShadowQuality CascadedShadowMap::getQuality() {
+        return quality;
+    }
+
+    int CascadedShadowMap::getCascadeCount() {
+        return cascadeCount;
+    }
+
+    GLsizei CascadedShadowMap::getResolution() {
+        return resolution;
+    }
+
+    const Cascade& CascadedShadowMap::getCascade(int cascade) {
+        return cascades[cascade];
+    }
+
+    const glm::mat4& CascadedShadowMap::getLightView() {
+        return lightView;
+    }
+
+    GLuint CascadedShadowMap::getTexture() {
+        return shadowMapTexture;
+    }
+
+    GLuint CascadedShadowMap::getFramebuffer() {
+        return shadowMapFBO;
+    }
+
+    size_t CascadedShadowMap::getMemorySize() {
+        //GL_DEPTH_COMPONENT24 is stored in 4 bytes
+        return (size_t)resolution * resolution * cascadeCount * 4;
+    }
+}
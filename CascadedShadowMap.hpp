@@ -0,0 +1,91 @@
+#ifndef CascadedShadowMap_hpp
+#define CascadedShadowMap_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "Shader.hpp"
+
+namespace gps {
+
+    enum ShadowQuality {SHADOW_QUALITY_LOW, SHADOW_QUALITY_MEDIUM, SHADOW_QUALITY_HIGH, SHADOW_QUALITY_COUNT};
+
+    //must match MAX_CASCADES of basic.frag
+    const int MAX_CASCADES = 4;
+
+    struct Cascade
+    {
+        glm::mat4 lightProjection;
+        glm::mat4 lightSpaceTrMatrix;
+        //view distances of the slice of the camera frustum the cascade covers
+        float splitNear;
+        float splitFar;
+        //world size of a shadow map texel
+        float texelSize;
+        //depth bias of the cascade, about two texels in depth units
+        float depthBias;
+        //light space xy rectangle of the projection, and of the slice clamped to the scene
+        glm::vec2 boundsMin;
+        glm::vec2 boundsMax;
+        glm::vec2 sliceMin;
+        glm::vec2 sliceMax;
+        //projection, rectangle and bias the layer was last rendered with, the ones the receivers sample with
+        //they lag behind the fitted ones while the layer is not updated
+        glm::mat4 renderedLightSpaceTrMatrix;
+        glm::vec2 renderedBoundsMin;
+        glm::vec2 renderedBoundsMax;
+        float renderedDepthBias;
+        bool rendered;
+    };
+
+    //shadow map of a directional light split into cascades, the layers of one GL_TEXTURE_2D_ARRAY
+    //the camera frustum is split logarithmically and each slice gets its own orthographic projection,
+    //sized from the bounding sphere of the slice so it does not change as the camera turns,
+    //snapped to whole texels so it does not shimmer as the camera moves,
+    //and clamped to the scene bounds, which also give the depth range
+    class CascadedShadowMap
+    {
+    public:
+        CascadedShadowMap();
+        ~CascadedShadowMap();
+        //creates, or recreates, the texture array with the cascade count and resolution of the tier
+        void Init(ShadowQuality quality);
+        //fits the cascades to the camera frustum between nearPlane and farPlane
+        void Update(const glm::mat4& cameraViewProjection, float nearPlane, float farPlane,
+            const glm::mat4& lightView, const BoundingBox& sceneBounds);
+        //the layer is about to be rendered with the fitted projection of the cascade
+        void MarkRendered(int cascade);
+        //true when the rectangle the layer was rendered with still contains the slice
+        bool isCovered(int cascade);
+        //binds the framebuffer with the layer of the cascade as its depth attachment
+        void BindCascade(int cascade);
+        //binds the framebuffer with the whole array attached, gl_Layer picks the cascade of each primitive
+        void BindLayered();
+        //sends the rendered lightSpaceTrMatrices and cascadeBiases, cascadeFarPlanes and cascadeCount
+        void UploadUniforms(gps::Shader shader);
+
+        ShadowQuality getQuality();
+        int getCascadeCount();
+        GLsizei getResolution();
+        const Cascade& getCascade(int cascade);
+        const glm::mat4& getLightView();
+        GLuint getTexture();
+        GLuint getFramebuffer();
+        //bytes of the texture array
+        size_t getMemorySize();
+
+    private:
+        ShadowQuality quality;
+        int cascadeCount;
+        GLsizei resolution;
+        GLuint shadowMapFBO;
+        GLuint shadowMapTexture;
+        glm::mat4 lightView;
+        Cascade cascades[MAX_CASCADES];
+
+        void fitCascade(Cascade& cascade, const glm::vec3 corners[8], const BoundingBox& lightSceneBounds);
+    };
+}
+
+#endif /* CascadedShadowMap_hpp */
@@ -0,0 +1,298 @@
+#include "ClusteredLights.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CLUSTER_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTER_SIMD_WIDTH 4
+#else
+#define CLUSTER_SIMD_WIDTH 1
+#endif
+
+namespace gps {
+
+    //a lamp given by its position only
+    const float DEFAULT_LAMP_RADIUS = 6.0f;
+    const glm::vec3 DEFAULT_LAMP_COLOR = glm::vec3(1.0f, 0.75f, 0.45f);
+
+    typedef std::chrono::high_resolution_clock ClusterClock;
+
+    static double elapsedMilliseconds(ClusterClock::time_point start) {
+        return std::chrono::duration<double, std::milli>(ClusterClock::now() - start).count();
+    }
+
+    bool LoadPointLights(std::string fileName, std::vector<PointLight>& lights) {
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open()) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream values(line);
+            PointLight light;
+            if (line.empty() || line[0] == '#' || !(values >> light.position.x >> light.position.y >> light.position.z)) {
+                continue;
+            }
+            if (!(values >> light.radius >> light.color.x >> light.color.y >> light.color.z)) {
+                light.radius = DEFAULT_LAMP_RADIUS;
+                light.color = DEFAULT_LAMP_COLOR;
+            }
+            lights.push_back(light);
+        }
+        return true;
+    }
+
+    ClusteredLights::ClusteredLights() {
+        pool = NULL;
+        gridFovY = 0.0f;
+        gridWidth = 0;
+        gridHeight = 0;
+        gridNear = 0.0f;
+        gridFar = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            buffers[i] = 0;
+            textures[i] = 0;
+        }
+        stats = ClusterStats();
+    }
+
+    ClusteredLights::~ClusteredLights() {
+        if (buffers[0] != 0) {
+            glDeleteTextures(3, textures);
+            glDeleteBuffers(3, buffers);
+        }
+    }
+
+    void ClusteredLights::Init(gps::WorkerPool* workerPool) {
+        pool = workerPool;
+        clusterSlots.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+        clusterCounts.resize(CLUSTER_COUNT);
+        clusterLists.resize(CLUSTER_COUNT * 2);
+
+        //the texture keeps pointing at the buffer object when its storage is reallocated
+        const GLenum formats[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    bool ClusteredLights::isInitialized() {
+        return buffers[0] != 0;
+    }
+
+    void ClusteredLights::setLights(const std::vector<PointLight>& pointLights) {
+        lights = pointLights;
+    }
+
+    const std::vector<PointLight>& ClusteredLights::getLights() {
+        return lights;
+    }
+
+    //the box of a froxel holds the corners of its tile at the near and far depth of its slice
+    void ClusteredLights::buildGrid(float fovY, int width, int height, float nearPlane, float farPlane) {
+        gridFovY = fovY;
+        gridWidth = width;
+        gridHeight = height;
+        gridNear = nearPlane;
+        gridFar = farPlane;
+
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * (float)width / (float)height;
+        boxMinX.resize(CLUSTER_COUNT);
+        boxMinY.resize(CLUSTER_COUNT);
+        boxMinZ.resize(CLUSTER_COUNT);
+        boxMaxX.resize(CLUSTER_COUNT);
+        boxMaxY.resize(CLUSTER_COUNT);
+        boxMaxZ.resize(CLUSTER_COUNT);
+        for (int z = 0; z < CLUSTER_SLICES; z++) {
+            float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)z / CLUSTER_SLICES);
+            float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / CLUSTER_SLICES);
+            for (int y = 0; y < CLUSTER_TILES_Y; y++) {
+                float ndcY0 = -1.0f + 2.0f * y / CLUSTER_TILES_Y;
+                float ndcY1 = -1.0f + 2.0f * (y + 1) / CLUSTER_TILES_Y;
+                for (int x = 0; x < CLUSTER_TILES_X; x++) {
+                    float ndcX0 = -1.0f + 2.0f * x / CLUSTER_TILES_X;
+                    float ndcX1 = -1.0f + 2.0f * (x + 1) / CLUSTER_TILES_X;
+                    int cluster = (z * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+                    boxMinX[cluster] = std::min(ndcX0 * sliceNear, ndcX0 * sliceFar) * tanX;
+                    boxMaxX[cluster] = std::max(ndcX1 * sliceNear, ndcX1 * sliceFar) * tanX;
+                    boxMinY[cluster] = std::min(ndcY0 * sliceNear, ndcY0 * sliceFar) * tanY;
+                    boxMaxY[cluster] = std::max(ndcY1 * sliceNear, ndcY1 * sliceFar) * tanY;
+                    boxMinZ[cluster] = -sliceFar;
+                    boxMaxZ[cluster] = -sliceNear;
+                }
+            }
+        }
+    }
+
+    int ClusteredLights::sliceOf(float depth) {
+        float slice = std::log(depth / gridNear) / std::log(gridFar / gridNear) * CLUSTER_SLICES;
+        return glm::clamp((int)std::floor(slice), 0, CLUSTER_SLICES - 1);
+    }
+
+    //only the lists of the slice are written, so the slices can be filled in parallel
+    void ClusteredLights::assignSlice(int slice) {
+        int first = slice * CLUSTERS_PER_SLICE;
+        std::fill(clusterCounts.begin() + first, clusterCounts.begin() + first + CLUSTERS_PER_SLICE, 0);
+
+        const float* minX = boxMinX.data() + first;
+        const float* minY = boxMinY.data() + first;
+        const float* minZ = boxMinZ.data() + first;
+        const float* maxX = boxMaxX.data() + first;
+        const float* maxY = boxMaxY.data() + first;
+        const float* maxZ = boxMaxZ.data() + first;
+
+        for (size_t l = 0; l < visibleLights.size(); l++) {
+            const VisibleLight& light = visibleLights[l];
+            if (slice < light.firstSlice || slice > light.lastSlice) {
+                continue;
+            }
+            float radiusSquared = light.radius * light.radius;
+
+            //the sphere touches the box when its center is within radius of the nearest point of the box
+            for (int i = 0; i < CLUSTERS_PER_SLICE; i += CLUSTER_SIMD_WIDTH) {
+#if CLUSTER_SIMD_WIDTH == 8
+                __m256 cx = _mm256_set1_ps(light.center.x), cy = _mm256_set1_ps(light.center.y), cz = _mm256_set1_ps(light.center.z);
+                __m256 zero = _mm256_setzero_ps();
+                __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(minX + i), cx), _mm256_sub_ps(cx, _mm256_loadu_ps(maxX + i))), zero);
+                __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(minY + i), cy), _mm256_sub_ps(cy, _mm256_loadu_ps(maxY + i))), zero);
+                __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(minZ + i), cz), _mm256_sub_ps(cz, _mm256_loadu_ps(maxZ + i))), zero);
+                __m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+                int hitMask = _mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, _mm256_set1_ps(radiusSquared), _CMP_LE_OQ));
+#elif CLUSTER_SIMD_WIDTH == 4
+                __m128 cx = _mm_set1_ps(light.center.x), cy = _mm_set1_ps(light.center.y), cz = _mm_set1_ps(light.center.z);
+                __m128 zero = _mm_setzero_ps();
+                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + i), cx), _mm_sub_ps(cx, _mm_loadu_ps(maxX + i))), zero);
+                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY + i), cy), _mm_sub_ps(cy, _mm_loadu_ps(maxY + i))), zero);
+                __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ + i), cz), _mm_sub_ps(cz, _mm_loadu_ps(maxZ + i))), zero);
+                __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int hitMask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_set1_ps(radiusSquared)));
+#else
+                float dx = std::max(std::max(minX[i] - light.center.x, light.center.x - maxX[i]), 0.0f);
+                float dy = std::max(std::max(minY[i] - light.center.y, light.center.y - maxY[i]), 0.0f);
+                float dz = std::max(std::max(minZ[i] - light.center.z, light.center.z - maxZ[i]), 0.0f);
+                int hitMask = dx * dx + dy * dy + dz * dz <= radiusSquared ? 1 : 0;
+#endif
+                for (; hitMask != 0; hitMask &= hitMask - 1) {
+                    int lane = 0;
+                    while (!(hitMask & (1 << lane))) {
+                        lane++;
+                    }
+                    int cluster = first + i + lane;
+                    if (clusterCounts[cluster] < (uint32_t)MAX_LIGHTS_PER_CLUSTER) {
+                        clusterSlots[cluster * MAX_LIGHTS_PER_CLUSTER + clusterCounts[cluster]] = light.index;
+                    }
+                    //counted past the capacity too, the packing reports what was dropped
+                    clusterCounts[cluster]++;
+                }
+            }
+        }
+    }
+
+    void ClusteredLights::Update(const glm::mat4& view, float fovY, int width, int height, float nearPlane, float farPlane) {
+        ClusterClock::time_point start = ClusterClock::now();
+        if (fovY != gridFovY || width != gridWidth || height != gridHeight || nearPlane != gridNear || farPlane != gridFar) {
+            buildGrid(fovY, width, height, nearPlane, farPlane);
+        }
+
+        //two texels per light, the view space position with the radius and the color
+        visibleLights.clear();
+        lightData.resize(std::max<size_t>(lights.size(), 1) * 2, glm::vec4(0.0f));
+        for (size_t i = 0; i < lights.size(); i++) {
+            glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+            lightData[i * 2] = glm::vec4(center, lights[i].radius);
+            lightData[i * 2 + 1] = glm::vec4(lights[i].color, 0.0f);
+
+            float nearDepth = -center.z - lights[i].radius;
+            float farDepth = -center.z + lights[i].radius;
+            if (farDepth < nearPlane || nearDepth > farPlane) {
+                continue;
+            }
+            VisibleLight light;
+            light.center = center;
+            light.radius = lights[i].radius;
+            light.firstSlice = sliceOf(std::max(nearDepth, nearPlane));
+            light.lastSlice = sliceOf(std::min(farDepth, farPlane));
+            light.index = (uint32_t)i;
+            visibleLights.push_back(light);
+        }
+
+        if (pool != NULL) {
+            pool->Run(CLUSTER_SLICES, [this](unsigned int slice) { assignSlice((int)slice); });
+        }
+        else {
+            for (int slice = 0; slice < CLUSTER_SLICES; slice++) {
+                assignSlice(slice);
+            }
+        }
+
+        //packs the lists one after the other, each froxel keeps the offset and count of its own
+        stats = ClusterStats();
+        lightIndices.clear();
+        for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+            uint32_t count = std::min(clusterCounts[cluster], (uint32_t)MAX_LIGHTS_PER_CLUSTER);
+            clusterLists[cluster * 2] = (GLuint)lightIndices.size();
+            clusterLists[cluster * 2 + 1] = count;
+            const uint32_t* slots = &clusterSlots[cluster * MAX_LIGHTS_PER_CLUSTER];
+            lightIndices.insert(lightIndices.end(), slots, slots + count);
+
+            stats.occupiedClusters += count > 0 ? 1 : 0;
+            stats.maxClusterLights = std::max(stats.maxClusterLights, clusterCounts[cluster]);
+            stats.droppedReferences += clusterCounts[cluster] - count;
+        }
+        stats.lights = (unsigned int)lights.size();
+        stats.visibleLights = (unsigned int)visibleLights.size();
+        stats.lightReferences = (unsigned int)lightIndices.size();
+        if (lightIndices.empty()) {
+            lightIndices.push_back(0);
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+        glBufferData(GL_TEXTURE_BUFFER, clusterLists.size() * sizeof(GLuint), clusterLists.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+        glBufferData(GL_TEXTURE_BUFFER, lightIndices.size() * sizeof(GLuint), lightIndices.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+        glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), glm::value_ptr(lightData[0]), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        stats.assignMilliseconds = elapsedMilliseconds(start);
+    }
+
+    void ClusteredLights::Bind(gps::Shader shader, int firstUnit) {
+        const char* samplers[3] = { "clusterLists", "clusterLightIndices", "pointLights" };
+        shader.useShaderProgram();
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, samplers[i]), firstUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        //slice = log(depth) * scale + bias, the inverse of the spacing buildGrid uses
+        float scale = CLUSTER_SLICES / std::log(gridFar / gridNear);
+        float bias = -scale * std::log(gridNear);
+        glUniform3ui(glGetUniformLocation(shader.shaderProgram, "clusterGrid"), CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterTileSize"),
+            (float)gridWidth / CLUSTER_TILES_X, (float)gridHeight / CLUSTER_TILES_Y);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterDepthScale"), scale, bias);
+    }
+
+    ClusterStats ClusteredLights::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef ClusteredLights_hpp
+#define ClusteredLights_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "WorkerPool.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    //world space point light, it reaches nothing past its radius
+    struct PointLight
+    {
+        glm::vec3 position;
+        float radius;
+        glm::vec3 color;
+    };
+
+    //froxel grid, tiles of the screen times slices of the view depth
+    const int CLUSTER_TILES_X = 16;
+    const int CLUSTER_TILES_Y = 9;
+    const int CLUSTER_SLICES = 24;
+    //lights past this count in one cluster are dropped from it
+    const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+    struct ClusterStats
+    {
+        unsigned int lights;
+        //lights inside the depth range of the camera
+        unsigned int visibleLights;
+        //light indices in all of the cluster lists
+        unsigned int lightReferences;
+        unsigned int occupiedClusters;
+        unsigned int maxClusterLights;
+        unsigned int droppedReferences;
+        double assignMilliseconds;
+    };
+
+    //reads one light per line, "x y z" or "x y z radius r g b", lines starting with # are skipped
+    //returns false when the file cannot be opened
+    bool LoadPointLights(std::string fileName, std::vector<PointLight>& lights);
+
+    //clustered forward lighting, the view frustum is split into froxels with slices spaced
+    //exponentially in depth, and every froxel gets the list of the lights whose sphere touches it
+    //the lights are assigned on the cpu each frame, slice by slice on the worker threads, with each
+    //sphere tested against 8 (avx) or 4 (sse) froxel boxes at a time
+    //the fragment shader finds its froxel from gl_FragCoord and its depth and loops over that list only
+    //the lists reach the shader through three buffer textures: per froxel offset and count,
+    //the light indices, and two texels per light with the view space position, radius and color
+    class ClusteredLights
+    {
+    public:
+        ClusteredLights();
+        ~ClusteredLights();
+        //a null pool assigns on the calling thread
+        void Init(gps::WorkerPool* pool);
+        bool isInitialized();
+        void setLights(const std::vector<PointLight>& lights);
+        const std::vector<PointLight>& getLights();
+        //assigns the lights to the froxels of the camera and uploads the lists
+        //the froxel boxes are rebuilt only when the projection changes
+        void Update(const glm::mat4& view, float fovY, int width, int height, float nearPlane, float farPlane);
+        //binds the buffer textures to firstUnit and the two units after it and sends the grid uniforms
+        void Bind(gps::Shader shader, int firstUnit);
+        ClusterStats getStats();
+
+    private:
+        static const int CLUSTERS_PER_SLICE = CLUSTER_TILES_X * CLUSTER_TILES_Y;
+        static const int CLUSTER_COUNT = CLUSTERS_PER_SLICE * CLUSTER_SLICES;
+
+        //sphere in view space and the slices it spans
+        struct VisibleLight
+        {
+            glm::vec3 center;
+            float radius;
+            int firstSlice;
+            int lastSlice;
+            uint32_t index;
+        };
+
+        gps::WorkerPool* pool;
+        std::vector<PointLight> lights;
+        std::vector<VisibleLight> visibleLights;
+
+        //view space boxes of the froxels, one array per axis, slice after slice
+        std::vector<float> boxMinX, boxMinY, boxMinZ;
+        std::vector<float> boxMaxX, boxMaxY, boxMaxZ;
+        float gridFovY;
+        int gridWidth;
+        int gridHeight;
+        float gridNear;
+        float gridFar;
+
+        //fixed capacity lists the slices fill in parallel, then packed for the upload
+        std::vector<uint32_t> clusterSlots;
+        std::vector<uint32_t> clusterCounts;
+        std::vector<GLuint> clusterLists;
+        std::vector<GLuint> lightIndices;
+        std::vector<glm::vec4> lightData;
+
+        //0 offsets and counts, 1 indices, 2 light data
+        GLuint buffers[3];
+        GLuint textures[3];
+        ClusterStats stats;
+
+        void buildGrid(float fovY, int width, int height, float nearPlane, float farPlane);
+        int sliceOf(float depth);
+        void assignSlice(int slice);
+    };
+}
+
+#endif /* ClusteredLights_hpp */
@@ -0,0 +1,136 @@
+#include "DepthPrepass.hpp"
+
+namespace gps {
+
+    //auto mode turns the prepass on above ENABLE_OVERDRAW and off again below DISABLE_OVERDRAW
+    const float ENABLE_OVERDRAW = 1.5f;
+    const float DISABLE_OVERDRAW = 1.2f;
+
+    DepthPrepass::DepthPrepass() {
+        for (int i = 0; i < QUERY_FRAMES; i++) {
+            prepassQueries[i] = 0;
+            shadingQueries[i] = 0;
+            prepassIssued[i] = false;
+            shadingIssued[i] = false;
+        }
+        currentFrame = 0;
+        pixelSamples = 1.0;
+        mode = PREPASS_AUTO;
+        active = false;
+        stats = PrepassStats();
+    }
+
+    DepthPrepass::~DepthPrepass() {
+        if (prepassQueries[0] != 0) {
+            glDeleteQueries(QUERY_FRAMES, prepassQueries);
+            glDeleteQueries(QUERY_FRAMES, shadingQueries);
+        }
+    }
+
+    void DepthPrepass::Init(int width, int height) {
+        glGenQueries(QUERY_FRAMES, prepassQueries);
+        glGenQueries(QUERY_FRAMES, shadingQueries);
+
+        //GL_SAMPLES_PASSED counts samples, the default framebuffer is multisampled
+        GLint samples = 0;
+        glGetIntegerv(GL_SAMPLES, &samples);
+        setFramebufferSize(width, height, samples);
+    }
+
+    void DepthPrepass::setFramebufferSize(int width, int height, int samples) {
+        pixelSamples = (double)width * height * (samples > 0 ? samples : 1);
+    }
+
+    void DepthPrepass::setMode(PrepassMode prepassMode) {
+        mode = prepassMode;
+    }
+
+    PrepassMode DepthPrepass::getMode() {
+        return mode;
+    }
+
+    //without a prepass the opaque pass count is the overdraw itself, with one the prepass
+    //passes exactly the fragments the opaque pass would have shaded
+    void DepthPrepass::readResults(int frame) {
+        if (!shadingIssued[frame]) {
+            return;
+        }
+        GLuint available = 0;
+        glGetQueryObjectuiv(shadingQueries[frame], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available && prepassIssued[frame]) {
+            glGetQueryObjectuiv(prepassQueries[frame], GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (!available) {
+            return;
+        }
+
+        GLuint64 shaded = 0;
+        glGetQueryObjectui64v(shadingQueries[frame], GL_QUERY_RESULT, &shaded);
+        GLuint64 depthTested = shaded;
+        if (prepassIssued[frame]) {
+            glGetQueryObjectui64v(prepassQueries[frame], GL_QUERY_RESULT, &depthTested);
+        }
+
+        stats.shadedSamples = shaded;
+        stats.savedSamples = depthTested > shaded ? depthTested - shaded : 0;
+        stats.overdraw = (float)(depthTested / pixelSamples);
+        shadingIssued[frame] = false;
+        prepassIssued[frame] = false;
+    }
+
+    void DepthPrepass::BeginFrame() {
+        currentFrame = (currentFrame + 1) % QUERY_FRAMES;
+        //the queries of this slot were issued QUERY_FRAMES frames ago
+        readResults(currentFrame);
+
+        if (mode == PREPASS_AUTO) {
+            if (!active && stats.overdraw > ENABLE_OVERDRAW) {
+                active = true;
+            }
+            else if (active && stats.overdraw < DISABLE_OVERDRAW) {
+                active = false;
+            }
+        }
+        else {
+            active = mode == PREPASS_ON;
+        }
+        stats.active = active;
+    }
+
+    bool DepthPrepass::isActive() {
+        return active;
+    }
+
+    void DepthPrepass::BeginPrepass() {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        glBeginQuery(GL_SAMPLES_PASSED, prepassQueries[currentFrame]);
+    }
+
+    void DepthPrepass::EndPrepass() {
+        glEndQuery(GL_SAMPLES_PASSED);
+        prepassIssued[currentFrame] = true;
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    //after a prepass only the nearest fragment of each pixel is still equal to the depth buffer
+    void DepthPrepass::BeginShading() {
+        if (active) {
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        glBeginQuery(GL_SAMPLES_PASSED, shadingQueries[currentFrame]);
+    }
+
+    void DepthPrepass::EndShading() {
+        glEndQuery(GL_SAMPLES_PASSED);
+        shadingIssued[currentFrame] = true;
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    PrepassStats DepthPrepass::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef DepthPrepass_hpp
+#define DepthPrepass_hpp
+
+#include <GL/glew.h>
+
+namespace gps {
+
+    enum PrepassMode {PREPASS_OFF, PREPASS_ON, PREPASS_AUTO};
+
+    struct PrepassStats
+    {
+        bool active;
+        //fragments that pass the depth test without a prepass, per screen pixel
+        float overdraw;
+        //fragments the opaque pass shaded, and the ones the prepass kept it from shading
+        GLuint64 shadedSamples;
+        GLuint64 savedSamples;
+    };
+
+    //depth only pass before the opaque pass, which then shades with GL_EQUAL and no depth writes
+    //GL_SAMPLES_PASSED queries around both passes measure the overdraw, read a few frames later
+    //so they never stall; in auto mode the prepass turns on when the overdraw is high enough to pay for it
+    class DepthPrepass
+    {
+    public:
+        DepthPrepass();
+        ~DepthPrepass();
+        //pixels of the framebuffer the overdraw is measured on
+        void Init(int width, int height);
+        //the framebuffer the passes draw into changed size or sample count
+        void setFramebufferSize(int width, int height, int samples);
+        void setMode(PrepassMode mode);
+        PrepassMode getMode();
+        //reads the finished queries and decides whether this frame has a prepass
+        void BeginFrame();
+        bool isActive();
+        //depth writes only, the geometry must go through the same transform as the opaque pass
+        void BeginPrepass();
+        void EndPrepass();
+        void BeginShading();
+        void EndShading();
+        PrepassStats getStats();
+
+    private:
+        static const int QUERY_FRAMES = 3;
+
+        GLuint prepassQueries[QUERY_FRAMES];
+        GLuint shadingQueries[QUERY_FRAMES];
+        bool prepassIssued[QUERY_FRAMES];
+        bool shadingIssued[QUERY_FRAMES];
+        int currentFrame;
+        double pixelSamples;
+        PrepassMode mode;
+        bool active;
+        PrepassStats stats;
+
+        void readResults(int frame);
+    };
+}
+
+#endif /* DepthPrepass_hpp */
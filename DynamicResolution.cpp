@@ -0,0 +1,110 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    const float DynamicResolution::SCALE_STEP = 0.05f;
+    //the gpu timers answer a few frames late, the frames right after a change still show the old scale
+    const int TIMING_LATENCY_FRAMES = 4;
+    //frames after a change before the scale may drop again, and before it may rise
+    const int DROP_DELAY_FRAMES = 8;
+    const int RISE_DELAY_FRAMES = 60;
+    //weight of the newest timing in the smoothed one
+    const float TIMING_SMOOTHING = 0.2f;
+    //the scale rises only while the frame stays under this fraction of the target
+    const float RISE_HEADROOM = 0.85f;
+
+    DynamicResolution::DynamicResolution() {
+        minScale = 0.5f;
+        maxScale = 1.0f;
+        targetMilliseconds = 1000.0f / 60.0f;
+        scale = 1.0f;
+        frameMilliseconds = 0.0f;
+        scaledMilliseconds = 0.0f;
+        measured = false;
+        framesSinceChange = 0;
+        scaleChanges = 0;
+    }
+
+    void DynamicResolution::Init(float minimumScale, float maximumScale, float target) {
+        minScale = minimumScale;
+        maxScale = maximumScale;
+        targetMilliseconds = target;
+        Reset();
+    }
+
+    void DynamicResolution::setTarget(float target) {
+        targetMilliseconds = target;
+    }
+
+    float DynamicResolution::getTarget() {
+        return targetMilliseconds;
+    }
+
+    void DynamicResolution::Reset() {
+        scale = maxScale;
+        measured = false;
+        framesSinceChange = 0;
+    }
+
+    float DynamicResolution::quantize(float value) {
+        return std::floor(value / SCALE_STEP + 1.0e-4f) * SCALE_STEP;
+    }
+
+    void DynamicResolution::Update(float frameTime, float scaledTime) {
+        framesSinceChange++;
+        if (framesSinceChange <= TIMING_LATENCY_FRAMES) {
+            return;
+        }
+        if (!measured) {
+            frameMilliseconds = frameTime;
+            scaledMilliseconds = scaledTime;
+            measured = true;
+        }
+        else {
+            frameMilliseconds += (frameTime - frameMilliseconds) * TIMING_SMOOTHING;
+            scaledMilliseconds += (scaledTime - scaledMilliseconds) * TIMING_SMOOTHING;
+        }
+
+        //the fixed part alone may be over the target, the scaled part still gets a tenth of it
+        float fixedMilliseconds = std::max(frameMilliseconds - scaledMilliseconds, 0.0f);
+        float available = std::max(targetMilliseconds - fixedMilliseconds, 0.1f * targetMilliseconds);
+        float fitScale = scale * std::sqrt(available / std::max(scaledMilliseconds, 0.01f));
+
+        float next = scale;
+        if (frameMilliseconds > targetMilliseconds && framesSinceChange >= DROP_DELAY_FRAMES) {
+            next = std::min(quantize(fitScale), scale - SCALE_STEP);
+        }
+        else if (frameMilliseconds < targetMilliseconds * RISE_HEADROOM && framesSinceChange >= RISE_DELAY_FRAMES
+            && fitScale >= scale + SCALE_STEP) {
+            next = scale + SCALE_STEP;
+        }
+        next = std::min(std::max(next, minScale), maxScale);
+        if (next != scale) {
+            scale = next;
+            measured = false;
+            framesSinceChange = 0;
+            scaleChanges++;
+        }
+    }
+
+    float DynamicResolution::getScale() {
+        return scale;
+    }
+
+    void DynamicResolution::getRenderSize(int windowWidth, int windowHeight, int& width, int& height) {
+        width = std::max((int)(windowWidth * scale + 0.5f), 1);
+        height = std::max((int)(windowHeight * scale + 0.5f), 1);
+    }
+
+    ResolutionStats DynamicResolution::getStats() {
+        ResolutionStats stats;
+        stats.scale = scale;
+        stats.frameMilliseconds = frameMilliseconds;
+        stats.scaledMilliseconds = scaledMilliseconds;
+        stats.scaleChanges = scaleChanges;
+        return stats;
+    }
+}
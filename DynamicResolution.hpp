@@ -0,0 +1,54 @@
+#ifndef DynamicResolution_hpp
+#define DynamicResolution_hpp
+
+namespace gps {
+
+    struct ResolutionStats
+    {
+        float scale;
+        //smoothed gpu time of the frame and of the part of it that follows the render size
+        float frameMilliseconds;
+        float scaledMilliseconds;
+        unsigned int scaleChanges;
+    };
+
+    //frame time controller of the render scale, the fraction of the window size the main pass renders at
+    //the scaled time is taken to grow with the pixel count, so the scale that fits the budget is
+    //scale * sqrt(available / scaled), the rest of the frame (shadows, upscale) being fixed
+    //the scale moves in steps of SCALE_STEP, so a few render target sizes come back again and again;
+    //it drops as soon as the frame is over budget and rises one step at a time once there is headroom,
+    //waiting after every change for the delayed gpu timings to catch up
+    class DynamicResolution
+    {
+    public:
+        DynamicResolution();
+        void Init(float minScale, float maxScale, float targetMilliseconds);
+        void setTarget(float targetMilliseconds);
+        float getTarget();
+        //call once per frame with the newest gpu timings
+        void Update(float frameMilliseconds, float scaledMilliseconds);
+        float getScale();
+        //the render size of a window, at least one pixel
+        void getRenderSize(int windowWidth, int windowHeight, int& width, int& height);
+        //back to the largest scale, e.g. when the controller is turned back on
+        void Reset();
+        ResolutionStats getStats();
+
+    private:
+        static const float SCALE_STEP;
+
+        float minScale;
+        float maxScale;
+        float targetMilliseconds;
+        float scale;
+        float frameMilliseconds;
+        float scaledMilliseconds;
+        bool measured;
+        int framesSinceChange;
+        unsigned int scaleChanges;
+
+        float quantize(float value);
+    };
+}
+
+#endif /* DynamicResolution_hpp */
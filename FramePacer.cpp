@@ -0,0 +1,238 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace gps {
+
+    //the limiter sleeps until this close to the deadline and spins the rest, sleeps overshoot by a millisecond or more
+    const double SPIN_SECONDS = 0.002;
+    //the cpu and gpu clocks drift apart slowly, the offset is measured again after this many frames
+    const unsigned int CALIBRATION_FRAMES = 600;
+    //glClientWaitSync timeout of one try, the wait goes on until the fence signals
+    const GLuint64 FENCE_TIMEOUT_NANOSECONDS = 100000000;
+
+    FramePacer::FramePacer() {
+        window = NULL;
+        mode = PRESENT_VSYNC;
+        adaptiveSupported = false;
+        capRate = 60.0;
+        maxFramesInFlight = 2;
+        frameNumber = 0;
+        for (int i = 0; i < FRAME_SLOTS; i++) {
+            fences[i] = 0;
+            timestampQueries[i] = 0;
+            timestampIssued[i] = false;
+            inputTimes[i] = 0.0;
+        }
+        inputTime = 0.0;
+        lastFrameStart = -1.0;
+        nextFrameTime = 0.0;
+        clockOffset = 0.0;
+        for (int m = 0; m < PRESENT_MODE_COUNT; m++) {
+            for (int f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+                accumulators[m][f] = Accumulator();
+            }
+        }
+    }
+
+    FramePacer::~FramePacer() {
+        for (int i = 0; i < FRAME_SLOTS; i++) {
+            if (fences[i] != 0) {
+                glDeleteSync(fences[i]);
+            }
+        }
+        if (timestampQueries[0] != 0) {
+            glDeleteQueries(FRAME_SLOTS, timestampQueries);
+        }
+    }
+
+    void FramePacer::Init(GLFWwindow* presentWindow) {
+        window = presentWindow;
+        glGenQueries(FRAME_SLOTS, timestampQueries);
+        adaptiveSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+        calibrateClock();
+        setMode(mode);
+    }
+
+    void FramePacer::applySwapInterval() {
+        switch (mode) {
+            case PRESENT_VSYNC:
+                glfwSwapInterval(1);
+                break;
+            case PRESENT_ADAPTIVE:
+                //a negative interval swaps at once when the frame missed the vertical blank
+                glfwSwapInterval(adaptiveSupported ? -1 : 1);
+                break;
+            default:
+                glfwSwapInterval(0);
+                break;
+        }
+    }
+
+    void FramePacer::setMode(PresentMode presentMode) {
+        mode = presentMode;
+        applySwapInterval();
+        //the first frame of a mode has no interval, and the pending latencies belong to the old one
+        lastFrameStart = -1.0;
+        nextFrameTime = glfwGetTime();
+        for (int i = 0; i < FRAME_SLOTS; i++) {
+            timestampIssued[i] = false;
+        }
+    }
+
+    PresentMode FramePacer::getMode() {
+        return mode;
+    }
+
+    bool FramePacer::isAdaptiveSupported() {
+        return adaptiveSupported;
+    }
+
+    void FramePacer::setCapRate(double hertz) {
+        capRate = std::max(hertz, 1.0);
+    }
+
+    double FramePacer::getCapRate() {
+        return capRate;
+    }
+
+    void FramePacer::setMaxFramesInFlight(int frames) {
+        maxFramesInFlight = std::min(std::max(frames, 1), MAX_FRAMES_IN_FLIGHT);
+        setMode(mode);
+    }
+
+    int FramePacer::getMaxFramesInFlight() {
+        return maxFramesInFlight;
+    }
+
+    FramePacer::Accumulator& FramePacer::current() {
+        return accumulators[mode][maxFramesInFlight - 1];
+    }
+
+    void FramePacer::calibrateClock() {
+        GLint64 gpuNanoseconds = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNanoseconds);
+        clockOffset = glfwGetTime() - gpuNanoseconds * 1.0e-9;
+    }
+
+    //the fence of the frame maxFramesInFlight frames back, once it signals fewer frames than that are queued
+    void FramePacer::waitForFence() {
+        if (frameNumber < (unsigned int)maxFramesInFlight) {
+            return;
+        }
+        int slot = (frameNumber - maxFramesInFlight) % FRAME_SLOTS;
+        if (fences[slot] == 0) {
+            return;
+        }
+        double start = glfwGetTime();
+        GLenum result = GL_TIMEOUT_EXPIRED;
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NANOSECONDS);
+        }
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+        current().fenceWait += (glfwGetTime() - start) * 1000.0;
+    }
+
+    void FramePacer::waitForCap() {
+        if (mode != PRESENT_CAPPED) {
+            return;
+        }
+        double start = glfwGetTime();
+        double sleepSeconds = nextFrameTime - start - SPIN_SECONDS;
+        if (sleepSeconds > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(sleepSeconds));
+        }
+        double now = glfwGetTime();
+        while (now < nextFrameTime) {
+            std::this_thread::yield();
+            now = glfwGetTime();
+        }
+        //a frame later than a whole interval drops the debt instead of rushing the next ones
+        double interval = 1.0 / capRate;
+        nextFrameTime = now - nextFrameTime > interval ? now + interval : nextFrameTime + interval;
+        current().limiter += (now - start) * 1000.0;
+    }
+
+    void FramePacer::readTimestamps() {
+        for (int slot = 0; slot < FRAME_SLOTS; slot++) {
+            if (!timestampIssued[slot]) {
+                continue;
+            }
+            GLuint available = 0;
+            glGetQueryObjectuiv(timestampQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                continue;
+            }
+            GLuint64 gpuNanoseconds = 0;
+            glGetQueryObjectui64v(timestampQueries[slot], GL_QUERY_RESULT, &gpuNanoseconds);
+            timestampIssued[slot] = false;
+
+            double latency = (gpuNanoseconds * 1.0e-9 + clockOffset - inputTimes[slot]) * 1000.0;
+            Accumulator& accumulator = current();
+            accumulator.latencySamples++;
+            accumulator.latencySum += latency;
+            accumulator.latencyMax = std::max(accumulator.latencyMax, latency);
+        }
+    }
+
+    void FramePacer::BeginFrame() {
+        waitForFence();
+        waitForCap();
+        readTimestamps();
+        if (frameNumber % CALIBRATION_FRAMES == 0) {
+            calibrateClock();
+        }
+
+        double now = glfwGetTime();
+        if (lastFrameStart >= 0.0) {
+            double frameMilliseconds = (now - lastFrameStart) * 1000.0;
+            Accumulator& accumulator = current();
+            accumulator.frames++;
+            accumulator.frameSum += frameMilliseconds;
+            accumulator.frameSquareSum += frameMilliseconds * frameMilliseconds;
+            accumulator.frameMax = std::max(accumulator.frameMax, frameMilliseconds);
+        }
+        lastFrameStart = now;
+        inputTime = now;
+    }
+
+    void FramePacer::Present() {
+        int slot = frameNumber % FRAME_SLOTS;
+        //a timestamp still pending after FRAME_SLOTS frames is dropped rather than waited on
+        glQueryCounter(timestampQueries[slot], GL_TIMESTAMP);
+        timestampIssued[slot] = true;
+        inputTimes[slot] = inputTime;
+
+        glfwSwapBuffers(window);
+
+        if (fences[slot] != 0) {
+            glDeleteSync(fences[slot]);
+        }
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameNumber++;
+    }
+
+    FramePacingStats FramePacer::getStats(PresentMode presentMode, int framesInFlight) {
+        const Accumulator& accumulator = accumulators[presentMode][framesInFlight - 1];
+        FramePacingStats stats = FramePacingStats();
+        stats.frames = accumulator.frames;
+        if (accumulator.frames > 0) {
+            stats.averageFrameMilliseconds = accumulator.frameSum / accumulator.frames;
+            double variance = accumulator.frameSquareSum / accumulator.frames - stats.averageFrameMilliseconds * stats.averageFrameMilliseconds;
+            stats.frameDeviationMilliseconds = std::sqrt(std::max(variance, 0.0));
+            stats.maxFrameMilliseconds = accumulator.frameMax;
+            stats.fenceWaitMilliseconds = accumulator.fenceWait / accumulator.frames;
+            stats.limiterMilliseconds = accumulator.limiter / accumulator.frames;
+        }
+        stats.latencySamples = accumulator.latencySamples;
+        if (accumulator.latencySamples > 0) {
+            stats.averageLatencyMilliseconds = accumulator.latencySum / accumulator.latencySamples;
+            stats.maxLatencyMilliseconds = accumulator.latencyMax;
+        }
+        return stats;
+    }
+}
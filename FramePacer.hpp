@@ -0,0 +1,102 @@
+#ifndef FramePacer_hpp
+#define FramePacer_hpp
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace gps {
+
+    //vsync waits for the vertical blank, adaptive only when the frame is on time (tears when late),
+    //uncapped presents at once, capped presents at once but no faster than the cap rate
+    enum PresentMode {PRESENT_VSYNC, PRESENT_ADAPTIVE, PRESENT_UNCAPPED, PRESENT_CAPPED, PRESENT_MODE_COUNT};
+
+    const int MAX_FRAMES_IN_FLIGHT = 3;
+
+    struct FramePacingStats
+    {
+        unsigned int frames;
+        //interval between frame starts, its spread is the stutter the mode shows
+        double averageFrameMilliseconds;
+        double frameDeviationMilliseconds;
+        double maxFrameMilliseconds;
+        //from reading the input of a frame to the gpu finishing it, the present is at most one refresh later
+        unsigned int latencySamples;
+        double averageLatencyMilliseconds;
+        double maxLatencyMilliseconds;
+        //cpu time per frame spent waiting for the fence, and in the limiter of the capped mode
+        double fenceWaitMilliseconds;
+        double limiterMilliseconds;
+    };
+
+    //presents the frames and paces the cpu against the gpu and the display
+    //a fence after every swap lets BeginFrame wait until at most framesInFlight frames are queued,
+    //so the input is read as late as the gpu allows; a timestamp query at the end of every frame
+    //dates its completion on the cpu clock, which gives the latency from the input
+    //the stats are kept apart for every mode and frames in flight count
+    class FramePacer
+    {
+    public:
+        FramePacer();
+        ~FramePacer();
+        void Init(GLFWwindow* window);
+        void setMode(PresentMode mode);
+        PresentMode getMode();
+        //adaptive sync needs the swap control tear extension, vsync is used without it
+        bool isAdaptiveSupported();
+        void setCapRate(double hertz);
+        double getCapRate();
+        //1 to MAX_FRAMES_IN_FLIGHT
+        void setMaxFramesInFlight(int frames);
+        int getMaxFramesInFlight();
+        //waits for the gpu and the cap, call right before reading the input of the frame
+        void BeginFrame();
+        //dates the end of the frame, swaps and fences it
+        void Present();
+        FramePacingStats getStats(PresentMode mode, int framesInFlight);
+
+    private:
+        static const int FRAME_SLOTS = MAX_FRAMES_IN_FLIGHT + 1;
+
+        GLFWwindow* window;
+        PresentMode mode;
+        bool adaptiveSupported;
+        double capRate;
+        int maxFramesInFlight;
+        unsigned int frameNumber;
+
+        GLsync fences[FRAME_SLOTS];
+        GLuint timestampQueries[FRAME_SLOTS];
+        bool timestampIssued[FRAME_SLOTS];
+        double inputTimes[FRAME_SLOTS];
+        //cpu time of the current frame input and start, and when the capped mode may start the next frame
+        double inputTime;
+        double lastFrameStart;
+        double nextFrameTime;
+        //cpu clock minus gpu clock in seconds, measured again every CALIBRATION_FRAMES frames
+        double clockOffset;
+
+        //running sums per mode and frames in flight, the deviation from the sum of squares
+        struct Accumulator
+        {
+            unsigned int frames;
+            double frameSum;
+            double frameSquareSum;
+            double frameMax;
+            unsigned int latencySamples;
+            double latencySum;
+            double latencyMax;
+            double fenceWait;
+            double limiter;
+        };
+        Accumulator accumulators[PRESENT_MODE_COUNT][MAX_FRAMES_IN_FLIGHT];
+
+        Accumulator& current();
+        void applySwapInterval();
+        void calibrateClock();
+        void waitForFence();
+        void waitForCap();
+        void readTimestamps();
+    };
+}
+
+#endif /* FramePacer_hpp */
@@ -0,0 +1,126 @@
+#include "Frustum.hpp"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SIMD_WIDTH 4
+#else
+#define FRUSTUM_SIMD_WIDTH 1
+#endif
+
+namespace gps {
+
+    void Frustum::Extract(const glm::mat4& m) {
+        //rows of the matrix, glm is column major
+        glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[PLANE_LEFT] = row3 + row0;
+        planes[PLANE_RIGHT] = row3 - row0;
+        planes[PLANE_BOTTOM] = row3 + row1;
+        planes[PLANE_TOP] = row3 - row1;
+        planes[PLANE_NEAR] = row3 + row2;
+        planes[PLANE_FAR] = row3 - row2;
+
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            float length = glm::length(glm::vec3(planes[i]));
+            if (length > 0.0f) {
+                planes[i] = planes[i] / length;
+            }
+        }
+    }
+
+    void Frustum::RemovePlane(FRUSTUM_PLANE plane) {
+        planes[plane] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    bool Frustum::Intersects(const BoundingBox& box) const {
+        glm::vec3 center = BoxCenter(box);
+        glm::vec3 extent = BoxExtent(box);
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            glm::vec3 normal = glm::vec3(planes[i]);
+            float distance = glm::dot(normal, center) + planes[i].w;
+            float radius = glm::dot(glm::abs(normal), extent);
+            if (distance < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Frustum::Intersects(const BoundingSphere& sphere) const {
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Frustum::CullBoxes(BoxListSoA& boxes, std::vector<uint8_t>& visible) const {
+        size_t count = boxes.size();
+        visible.resize(count);
+        boxes.pad(FRUSTUM_SIMD_WIDTH);
+
+        const float* cx = boxes.centerX.data();
+        const float* cy = boxes.centerY.data();
+        const float* cz = boxes.centerZ.data();
+        const float* ex = boxes.extentX.data();
+        const float* ey = boxes.extentY.data();
+        const float* ez = boxes.extentZ.data();
+
+        for (size_t i = 0; i < count; i += FRUSTUM_SIMD_WIDTH) {
+#if FRUSTUM_SIMD_WIDTH == 8
+            __m256 centerX = _mm256_loadu_ps(cx + i), centerY = _mm256_loadu_ps(cy + i), centerZ = _mm256_loadu_ps(cz + i);
+            __m256 extentX = _mm256_loadu_ps(ex + i), extentY = _mm256_loadu_ps(ey + i), extentZ = _mm256_loadu_ps(ez + i);
+            __m256 outside = _mm256_setzero_ps();
+            for (int p = 0; p < PLANE_COUNT; p++) {
+                __m256 nx = _mm256_set1_ps(planes[p].x), ny = _mm256_set1_ps(planes[p].y), nz = _mm256_set1_ps(planes[p].z);
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, centerX), _mm256_mul_ps(ny, centerY)),
+                    _mm256_add_ps(_mm256_mul_ps(nz, centerZ), _mm256_set1_ps(planes[p].w)));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(std::fabs(planes[p].x)), extentX),
+                    _mm256_mul_ps(_mm256_set1_ps(std::fabs(planes[p].y)), extentY)),
+                    _mm256_mul_ps(_mm256_set1_ps(std::fabs(planes[p].z)), extentZ));
+                //distance + radius < 0 means the box is fully behind the plane
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+            int outsideMask = _mm256_movemask_ps(outside);
+#elif FRUSTUM_SIMD_WIDTH == 4
+            __m128 centerX = _mm_loadu_ps(cx + i), centerY = _mm_loadu_ps(cy + i), centerZ = _mm_loadu_ps(cz + i);
+            __m128 extentX = _mm_loadu_ps(ex + i), extentY = _mm_loadu_ps(ey + i), extentZ = _mm_loadu_ps(ez + i);
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < PLANE_COUNT; p++) {
+                __m128 nx = _mm_set1_ps(planes[p].x), ny = _mm_set1_ps(planes[p].y), nz = _mm_set1_ps(planes[p].z);
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, centerX), _mm_mul_ps(ny, centerY)),
+                    _mm_add_ps(_mm_mul_ps(nz, centerZ), _mm_set1_ps(planes[p].w)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(std::fabs(planes[p].x)), extentX),
+                    _mm_mul_ps(_mm_set1_ps(std::fabs(planes[p].y)), extentY)),
+                    _mm_mul_ps(_mm_set1_ps(std::fabs(planes[p].z)), extentZ));
+                //distance + radius < 0 means the box is fully behind the plane
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            int outsideMask = _mm_movemask_ps(outside);
+#else
+            int outsideMask = 0;
+            for (int p = 0; p < PLANE_COUNT; p++) {
+                float distance = planes[p].x * cx[i] + planes[p].y * cy[i] + planes[p].z * cz[i] + planes[p].w;
+                float radius = std::fabs(planes[p].x) * ex[i] + std::fabs(planes[p].y) * ey[i] + std::fabs(planes[p].z) * ez[i];
+                if (distance + radius < 0.0f) {
+                    outsideMask = 1;
+                }
+            }
+#endif
+            for (size_t lane = 0; lane < FRUSTUM_SIMD_WIDTH && i + lane < count; lane++) {
+                visible[i + lane] = (outsideMask & (1 << lane)) ? 0 : 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    enum FRUSTUM_PLANE {PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT};
+
+    class Frustum
+    {
+    public:
+        //extracts the normalized planes of a projection * view matrix, normals point inside
+        void Extract(const glm::mat4& viewProjection);
+        //turns a plane into one every point is inside of, e.g. to extend a light frustum toward the light
+        void RemovePlane(FRUSTUM_PLANE plane);
+        bool Intersects(const BoundingBox& box) const;
+        bool Intersects(const BoundingSphere& sphere) const;
+        //tests every box of the list, visible[i] is set to 1 when box i intersects the frustum
+        //boxes are processed 8 at a time with AVX, 4 at a time with SSE, one at a time otherwise
+        void CullBoxes(BoxListSoA& boxes, std::vector<uint8_t>& visible) const;
+
+        //xyz is the inward normal, w the distance term
+        glm::vec4 planes[PLANE_COUNT];
+    };
+}
+
+#endif /* Frustum_hpp */
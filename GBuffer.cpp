@@ -0,0 +1,82 @@
+#include "GBuffer.hpp"
+
+namespace gps {
+
+    GBuffer::GBuffer() {
+        pool = NULL;
+        target = NULL;
+        width = 0;
+        height = 0;
+    }
+
+    GBuffer::~GBuffer() {
+    }
+
+    void GBuffer::Init(gps::RenderTargetPool* targetPool) {
+        pool = targetPool;
+    }
+
+    void GBuffer::Resize(int framebufferWidth, int framebufferHeight) {
+        if (target != NULL && framebufferWidth == width && framebufferHeight == height) {
+            return;
+        }
+        if (target != NULL) {
+            pool->Release(target);
+        }
+        width = framebufferWidth;
+        height = framebufferHeight;
+
+        RenderTargetDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.colorFormats[0] = GL_SRGB8_ALPHA8;
+        desc.colorFormats[1] = GL_RG16_SNORM;
+        desc.colorCount = 2;
+        desc.depthFormat = GL_DEPTH_COMPONENT24;
+        target = pool->Acquire(desc);
+    }
+
+    bool GBuffer::isInitialized() {
+        return pool != NULL;
+    }
+
+    int GBuffer::getWidth() {
+        return width;
+    }
+
+    int GBuffer::getHeight() {
+        return height;
+    }
+
+    void GBuffer::BeginGeometryPass() {
+        glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+        glViewport(0, 0, width, height);
+        //cleared per attachment so the clear color of the default framebuffer is left alone,
+        //the resolve skips the pixels still at the far plane, so the color values do not matter
+        const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const GLfloat farDepth = 1.0f;
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_COLOR, 1, zero);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+    }
+
+    void GBuffer::EndGeometryPass() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void GBuffer::BindTextures(gps::Shader shader, int firstUnit) {
+        GLuint textures[3] = { target->colorTextures[0], target->colorTextures[1], target->depthTexture };
+        const char* names[3] = { "gAlbedoSpecular", "gNormal", "gDepth" };
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, names[i]), firstUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    GLsizeiptr GBuffer::getMemorySize() {
+        //4 bytes albedo and specular, 4 normal, 4 for the padded 24 bit depth
+        return (GLsizeiptr)width * height * 12;
+    }
+}
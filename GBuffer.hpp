@@ -0,0 +1,43 @@
+#ifndef GBuffer_hpp
+#define GBuffer_hpp
+
+#include <GL/glew.h>
+
+#include "Shader.hpp"
+#include "RenderTargetPool.hpp"
+
+namespace gps {
+
+    //g-buffer of the deferred path, 8 bytes per pixel plus the depth
+    //  albedo and specular: GL_SRGB8_ALPHA8, the diffuse color in rgb and the specular intensity in alpha,
+    //  with GL_FRAMEBUFFER_SRGB on the writes are encoded, which keeps the dark colors precise in 8 bits
+    //  normal: GL_RG16_SNORM, the eye space normal folded onto an octahedron
+    //  depth: GL_DEPTH_COMPONENT24, the eye space position is rebuilt from it with the inverse projection
+    class GBuffer
+    {
+    public:
+        GBuffer();
+        ~GBuffer();
+        //the targets come from the pool, which keeps owning them
+        void Init(gps::RenderTargetPool* pool);
+        bool isInitialized();
+        //takes targets of the new size from the pool and gives the old ones back, nothing when the size is the same
+        void Resize(int width, int height);
+        int getWidth();
+        int getHeight();
+        //binds and clears the g-buffer, the geometry pass draws into it with its own shader
+        void BeginGeometryPass();
+        void EndGeometryPass();
+        //binds the targets to firstUnit and the two units after it and sends their samplers
+        void BindTextures(gps::Shader shader, int firstUnit);
+        GLsizeiptr getMemorySize();
+
+    private:
+        gps::RenderTargetPool* pool;
+        gps::RenderTarget* target;
+        int width;
+        int height;
+    };
+}
+
+#endif /* GBuffer_hpp */
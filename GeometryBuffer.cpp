@@ -0,0 +1,113 @@
+#include "GeometryBuffer.hpp"
+
+namespace gps {
+
+    GeometryBuffer::GeometryBuffer() {
+        buffers.VAO = 0;
+        buffers.VBO = 0;
+        buffers.EBO = 0;
+        drawIdVBO = 0;
+        drawIdCapacity = 0;
+    }
+
+    GeometryBuffer::~GeometryBuffer() {
+        if (buffers.VAO != 0) {
+            glDeleteBuffers(1, &buffers.VBO);
+            glDeleteBuffers(1, &buffers.EBO);
+            glDeleteBuffers(1, &drawIdVBO);
+            glDeleteVertexArrays(1, &buffers.VAO);
+        }
+    }
+
+    void GeometryBuffer::Build(std::vector<std::vector<gps::Mesh>*> meshLists, GLuint maxDraws) {
+        std::vector<gps::Vertex> vertices;
+        std::vector<GLuint> indices;
+
+        //the submeshes of a shape share its vertices, they are copied once for all of them
+        std::unordered_map<const std::vector<gps::Vertex>*, GLint> baseVertices;
+
+        ranges.clear();
+        for (size_t m = 0; m < meshLists.size(); m++) {
+            std::vector<gps::Mesh>& meshes = *meshLists[m];
+            for (size_t i = 0; i < meshes.size(); i++) {
+                const std::vector<gps::Vertex>* meshVertices = meshes[i].vertices.get();
+                std::unordered_map<const std::vector<gps::Vertex>*, GLint>::iterator found = baseVertices.find(meshVertices);
+                if (found == baseVertices.end()) {
+                    found = baseVertices.insert(std::make_pair(meshVertices, (GLint)vertices.size())).first;
+                    vertices.insert(vertices.end(), meshVertices->begin(), meshVertices->end());
+                }
+
+                MeshRange range;
+                range.firstIndex = (GLuint)indices.size();
+                range.indexCount = (GLuint)meshes[i].indices.size();
+                range.baseVertex = found->second;
+                ranges[&meshes[i]] = range;
+
+                indices.insert(indices.end(), meshes[i].indices.begin(), meshes[i].indices.end());
+            }
+        }
+
+        glGenVertexArrays(1, &buffers.VAO);
+        glGenBuffers(1, &buffers.VBO);
+        glGenBuffers(1, &buffers.EBO);
+        glGenBuffers(1, &drawIdVBO);
+
+        glBindVertexArray(buffers.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(gps::Vertex), vertices.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+        // same layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gps::Vertex), (GLvoid*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(gps::Vertex), (GLvoid*)offsetof(gps::Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(gps::Vertex), (GLvoid*)offsetof(gps::Vertex, TexCoords));
+
+        // draw id, advanced once per instance so baseInstance selects it
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+        glVertexAttribDivisor(3, 1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        reserveDraws(maxDraws);
+
+        std::cout << "Geometry buffer : " << vertices.size() << " vertices, " << indices.size() << " indices, "
+            << ranges.size() << " meshes" << std::endl;
+    }
+
+    bool GeometryBuffer::contains(const gps::Mesh* mesh) {
+        return ranges.find(mesh) != ranges.end();
+    }
+
+    void GeometryBuffer::reserveDraws(GLuint drawCount) {
+        if (drawCount <= drawIdCapacity) {
+            return;
+        }
+
+        std::vector<GLuint> drawIds(drawCount);
+        for (GLuint i = 0; i < drawCount; i++) {
+            drawIds[i] = i;
+        }
+
+        //the VAO keeps referencing the same buffer object, only its storage is replaced
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        drawIdCapacity = drawCount;
+    }
+
+    MeshRange GeometryBuffer::getRange(const gps::Mesh* mesh) {
+        return ranges.at(mesh);
+    }
+
+    GLuint GeometryBuffer::getVAO() {
+        return buffers.VAO;
+    }
+}
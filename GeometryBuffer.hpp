@@ -0,0 +1,46 @@
+#ifndef GeometryBuffer_hpp
+#define GeometryBuffer_hpp
+
+#include <GL/glew.h>
+
+#include "Mesh.hpp"
+#include "Model3D.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace gps {
+
+    //location of a mesh inside the shared vertex/index buffers
+    struct MeshRange
+    {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+    };
+
+    //all scene meshes packed into one vertex buffer and one index buffer behind a single VAO
+    class GeometryBuffer
+    {
+    public:
+        GeometryBuffer();
+        ~GeometryBuffer();
+        //copies the vertices and indices of every mesh of the lists, e.g. the meshes of a model, into the shared buffers
+        void Build(std::vector<std::vector<gps::Mesh>*> meshLists, GLuint maxDraws);
+        //true when the mesh was packed by Build
+        bool contains(const gps::Mesh* mesh);
+        //grows the draw id attribute so draws 0..drawCount-1 can be addressed
+        void reserveDraws(GLuint drawCount);
+        MeshRange getRange(const gps::Mesh* mesh);
+        GLuint getVAO();
+
+    private:
+        Buffers buffers;
+        //per instance attribute holding 0..maxDraws-1, fetched through the draw baseInstance
+        GLuint drawIdVBO;
+        GLuint drawIdCapacity;
+        std::unordered_map<const gps::Mesh*, MeshRange> ranges;
+    };
+}
+
+#endif /* GeometryBuffer_hpp */
@@ -0,0 +1,74 @@
+#include "GpuTimer.hpp"
+
+namespace gps {
+
+    GpuTimer::GpuTimer() {
+        for (int i = 0; i < QUERY_FRAMES; i++) {
+            queries[i] = 0;
+            issued[i] = false;
+        }
+        current = 0;
+        milliseconds = 0.0f;
+        result = false;
+        resultCount = 0;
+    }
+
+    GpuTimer::~GpuTimer() {
+        if (queries[0] != 0) {
+            glDeleteQueries(QUERY_FRAMES, queries);
+        }
+    }
+
+    void GpuTimer::Init() {
+        glGenQueries(QUERY_FRAMES, queries);
+    }
+
+    bool GpuTimer::isInitialized() {
+        return queries[0] != 0;
+    }
+
+    //takes the newest available result, oldest slot first so a newer one overwrites it
+    void GpuTimer::readResults() {
+        for (int i = 1; i <= QUERY_FRAMES; i++) {
+            int slot = (current + i) % QUERY_FRAMES;
+            if (!issued[slot]) {
+                continue;
+            }
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+                milliseconds = (float)(nanoseconds / 1.0e6);
+                result = true;
+                resultCount++;
+                issued[slot] = false;
+            }
+        }
+    }
+
+    void GpuTimer::Begin() {
+        readResults();
+        //a slot still pending after QUERY_FRAMES uses is dropped rather than waited on
+        issued[current] = false;
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void GpuTimer::End() {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[current] = true;
+        current = (current + 1) % QUERY_FRAMES;
+    }
+
+    float GpuTimer::getMilliseconds() {
+        return milliseconds;
+    }
+
+    bool GpuTimer::hasResult() {
+        return result;
+    }
+
+    unsigned int GpuTimer::getResultCount() {
+        return resultCount;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#include <GL/glew.h>
+
+namespace gps {
+
+    //gpu time of a block of commands, measured with GL_TIME_ELAPSED queries
+    //the result of a frame is read a few frames later, so the timer never stalls the pipeline
+    //time elapsed queries cannot nest, only one timer may be running at a time
+    class GpuTimer
+    {
+    public:
+        GpuTimer();
+        ~GpuTimer();
+        void Init();
+        bool isInitialized();
+        void Begin();
+        void End();
+        //last finished measurement, 0 until one is available
+        float getMilliseconds();
+        bool hasResult();
+        //measurements read so far, it changes when getMilliseconds has a new one
+        unsigned int getResultCount();
+
+    private:
+        static const int QUERY_FRAMES = 3;
+
+        GLuint queries[QUERY_FRAMES];
+        bool issued[QUERY_FRAMES];
+        int current;
+        float milliseconds;
+        bool result;
+        unsigned int resultCount;
+
+        void readResults();
+    };
+}
+
+#endif /* GpuTimer_hpp */
@@ -0,0 +1,252 @@
+#include "ImpostorAtlas.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace gps {
+
+    //levels below a frame of 8 pixels would blend the neighbouring frames together
+    const int IMPOSTOR_MAX_LEVEL = 3;
+
+    ImpostorAtlas::ImpostorAtlas() {
+        albedoArray = 0;
+        normalArray = 0;
+        quadVAO = 0;
+        stats = ImpostorStats();
+    }
+
+    ImpostorAtlas::~ImpostorAtlas() {
+        if (albedoArray != 0) {
+            glDeleteTextures(1, &albedoArray);
+            glDeleteTextures(1, &normalArray);
+            glDeleteVertexArrays(1, &quadVAO);
+        }
+    }
+
+    int ImpostorAtlas::Add(gps::Model3D& model3D) {
+        std::vector<gps::Mesh>& meshes = model3D.getMeshes();
+        gps::BoundingBox bounds = gps::EmptyBox();
+        for (size_t i = 0; i < meshes.size(); i++) {
+            bounds = gps::MergeBoxes(bounds, meshes[i].bounds);
+        }
+
+        Impostor impostor;
+        impostor.model = &model3D;
+        impostor.sphere.center = gps::BoxCenter(bounds);
+        impostor.sphere.radius = 0.0f;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            float reach = glm::length(meshes[i].sphere.center - impostor.sphere.center) + meshes[i].sphere.radius;
+            impostor.sphere.radius = std::max(impostor.sphere.radius, reach);
+        }
+        impostors.push_back(impostor);
+        return (int)impostors.size() - 1;
+    }
+
+    //the frame grid covers [-1, 1]^2, the upper half of the octahedron fills the diamond in the middle
+    //and the lower half is folded out into the corners
+    glm::vec3 ImpostorAtlas::frameDirection(glm::ivec2 frame) {
+        glm::vec2 p = glm::vec2((float)frame.x, (float)frame.y) / (float)(IMPOSTOR_FRAMES - 1) * 2.0f - glm::vec2(1.0f);
+        glm::vec3 direction = glm::vec3(p.x, 1.0f - std::fabs(p.x) - std::fabs(p.y), p.y);
+        if (direction.y < 0.0f) {
+            direction.x = (1.0f - std::fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f);
+            direction.z = (1.0f - std::fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return glm::normalize(direction);
+    }
+
+    glm::ivec2 ImpostorAtlas::closestFrame(glm::vec3 direction) {
+        direction /= std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+        glm::vec2 p = glm::vec2(direction.x, direction.z);
+        if (direction.y < 0.0f) {
+            p = glm::vec2((1.0f - std::fabs(direction.z)) * (direction.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::fabs(direction.x)) * (direction.z >= 0.0f ? 1.0f : -1.0f));
+        }
+        glm::vec2 grid = (p * 0.5f + glm::vec2(0.5f)) * (float)(IMPOSTOR_FRAMES - 1);
+        int frameX = std::min(std::max((int)std::lround(grid.x), 0), IMPOSTOR_FRAMES - 1);
+        int frameY = std::min(std::max((int)std::lround(grid.y), 0), IMPOSTOR_FRAMES - 1);
+        return glm::ivec2(frameX, frameY);
+    }
+
+    //screen axes of a frame, the same for the bake and the quad so the texels land where they were rendered
+    void ImpostorAtlas::frameAxes(glm::vec3 direction, glm::vec3& right, glm::vec3& up) {
+        glm::vec3 worldUp = std::fabs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        right = glm::normalize(glm::cross(worldUp, direction));
+        up = glm::cross(direction, right);
+    }
+
+    void ImpostorAtlas::Build(gps::Shader bakeShader) {
+        if (impostors.empty()) {
+            return;
+        }
+        GLsizei atlasSize = IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE;
+        GLsizei layers = (GLsizei)impostors.size();
+
+        GLuint arrays[2];
+        glGenTextures(2, arrays);
+        albedoArray = arrays[0];
+        normalArray = arrays[1];
+        //srgb like the material textures, the normals are plain data
+        GLenum formats[2] = { GL_SRGB8_ALPHA8, GL_RGBA8 };
+        for (int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i]);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, formats[i], atlasSize, atlasSize, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        GLuint framebuffer;
+        GLuint depthBuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        bakeShader.useShaderProgram();
+        for (int i = 0; i < (int)impostors.size(); i++) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, albedoArray, 0, i);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, normalArray, 0, i);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cout << "impostor framebuffer incomplete" << std::endl;
+                break;
+            }
+            bake(bakeShader, i);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+
+        for (int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, IMPOSTOR_MAX_LEVEL);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenVertexArrays(1, &quadVAO);
+
+        stats.impostors = (unsigned int)impostors.size();
+        //two arrays of 4 bytes per texel and a third more for the mipmaps
+        stats.memorySize = (GLsizeiptr)atlasSize * atlasSize * layers * 4 * 2 * 4 / 3;
+        std::cout << "Impostors : " << stats.impostors << " props, " << IMPOSTOR_FRAMES * IMPOSTOR_FRAMES << " views of "
+            << IMPOSTOR_FRAME_SIZE << " pixels each, " << stats.memorySize / 1024 << " kB" << std::endl;
+    }
+
+    //one orthographic view per frame, fitted to the bounding sphere
+    void ImpostorAtlas::bake(gps::Shader bakeShader, int impostor) {
+        //empty texels read as no coverage, and as a zero normal that averages out of the mipmaps
+        const GLfloat noAlbedo[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const GLfloat noNormal[4] = { 0.5f, 0.5f, 0.5f, 0.0f };
+        const GLfloat farDepth = 1.0f;
+        glClearBufferfv(GL_COLOR, 0, noAlbedo);
+        glClearBufferfv(GL_COLOR, 1, noNormal);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+        Impostor& current = impostors[impostor];
+        glm::vec3 center = current.sphere.center;
+        float radius = std::max(current.sphere.radius, 1e-4f);
+        glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.5f * radius, 3.5f * radius);
+        GLint viewProjectionLoc = glGetUniformLocation(bakeShader.shaderProgram, "viewProjection");
+        GLint materialIdLoc = glGetUniformLocation(bakeShader.shaderProgram, "meshMaterialId");
+        std::vector<gps::Mesh>& meshes = current.model->getMeshes();
+
+        for (int y = 0; y < IMPOSTOR_FRAMES; y++) {
+            for (int x = 0; x < IMPOSTOR_FRAMES; x++) {
+                glm::vec3 direction = frameDirection(glm::ivec2(x, y));
+                glm::vec3 right, up;
+                frameAxes(direction, right, up);
+                glm::mat4 viewProjection = projection * glm::lookAt(center + direction * (2.0f * radius), center, up);
+                glUniformMatrix4fv(viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+                glViewport(x * IMPOSTOR_FRAME_SIZE, y * IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+                for (size_t i = 0; i < meshes.size(); i++) {
+                    glUniform1ui(materialIdLoc, meshes[i].materialId);
+                    meshes[i].DrawElements();
+                }
+            }
+        }
+    }
+
+    gps::BoundingSphere ImpostorAtlas::getSphere(int impostor, const glm::mat4& model) {
+        const gps::BoundingSphere& sphere = impostors[impostor].sphere;
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        gps::BoundingSphere placed;
+        placed.center = glm::vec3(model * glm::vec4(sphere.center, 1.0f));
+        placed.radius = sphere.radius * scale;
+        return placed;
+    }
+
+    void ImpostorAtlas::BindTextures(gps::Shader shader, int firstUnit) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, albedoArray);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "impostorAlbedo"), firstUnit);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, normalArray);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "impostorNormal"), firstUnit + 1);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void ImpostorAtlas::BeginFrame() {
+        stats.drawn = 0;
+        stats.fading = 0;
+    }
+
+    void ImpostorAtlas::Draw(gps::Shader shader, int impostor, const glm::mat4& model, const glm::mat4& view, const glm::vec3& cameraPosition, float fade) {
+        Impostor& current = impostors[impostor];
+        glm::vec3 toCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f)) - current.sphere.center;
+        if (glm::length(toCamera) < 1e-6f) {
+            toCamera = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+        glm::ivec2 frame = closestFrame(glm::normalize(toCamera));
+        glm::vec3 direction = frameDirection(frame);
+        glm::vec3 right, up;
+        frameAxes(direction, right, up);
+
+        //the quad sits on the front of the sphere, so it covers the meshes it fades in over
+        float radius = current.sphere.radius;
+        glm::vec3 quadCenter = current.sphere.center + direction * radius;
+        glm::vec3 quadRight = right * radius;
+        glm::vec3 quadUp = up * radius;
+        glm::vec2 frameOrigin = glm::vec2((float)frame.x, (float)frame.y) / (float)IMPOSTOR_FRAMES;
+        glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+
+        GLuint program = shader.shaderProgram;
+        glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        glUniform3fv(glGetUniformLocation(program, "quadCenter"), 1, glm::value_ptr(quadCenter));
+        glUniform3fv(glGetUniformLocation(program, "quadRight"), 1, glm::value_ptr(quadRight));
+        glUniform3fv(glGetUniformLocation(program, "quadUp"), 1, glm::value_ptr(quadUp));
+        glUniform2fv(glGetUniformLocation(program, "frameOrigin"), 1, glm::value_ptr(frameOrigin));
+        glUniform1f(glGetUniformLocation(program, "frameSize"), 1.0f / (float)IMPOSTOR_FRAMES);
+        glUniform1f(glGetUniformLocation(program, "impostorLayer"), (float)impostor);
+        glUniformMatrix3fv(glGetUniformLocation(program, "impostorNormalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        glUniform1f(glGetUniformLocation(program, "impostorFade"), fade);
+
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+
+        stats.drawn++;
+        if (fade < 1.0f) {
+            stats.fading++;
+        }
+    }
+
+    ImpostorStats ImpostorAtlas::getStats() {
+        return stats;
+    }
+}
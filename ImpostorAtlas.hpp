@@ -0,0 +1,75 @@
+#ifndef ImpostorAtlas_hpp
+#define ImpostorAtlas_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "Model3D.hpp"
+#include "Shader.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    //views per side of the octahedral grid, IMPOSTOR_FRAMES * IMPOSTOR_FRAMES directions around a prop
+    const int IMPOSTOR_FRAMES = 8;
+    //pixels per side of the view from one direction
+    const int IMPOSTOR_FRAME_SIZE = 64;
+
+    struct ImpostorStats
+    {
+        unsigned int impostors;
+        //quads drawn in the last frame, and how many of them were still fading in over their meshes
+        unsigned int drawn;
+        unsigned int fading;
+        GLsizeiptr memorySize;
+    };
+
+    //views of small props rendered at load time, so a far prop is drawn as one quad instead of its meshes
+    //every prop has a layer in two texture arrays, split into a grid of frames that each see it from one direction;
+    //the directions are an octahedron unfolded into the square, which spreads them evenly over the sphere
+    //the albedo layer keeps the coverage in alpha and the normal layer the object space normal and specular
+    //intensity, so the quad is lit like the meshes and moves with the object transform of the prop
+    class ImpostorAtlas
+    {
+    public:
+        ImpostorAtlas();
+        ~ImpostorAtlas();
+        //queues the model, the returned impostor is what Draw takes
+        int Add(gps::Model3D& model3D);
+        //renders the queued models into their layers; bakeShader must already sample the material textures
+        void Build(gps::Shader bakeShader);
+        //bounding sphere of the impostor placed by the object transform
+        gps::BoundingSphere getSphere(int impostor, const glm::mat4& model);
+        //binds the albedo array to firstUnit and the normal array to firstUnit + 1
+        void BindTextures(gps::Shader shader, int firstUnit);
+        void BeginFrame();
+        //draws the frame closest to the direction the camera sees the object from, on a quad in front of it
+        //fade is the share of the pixels drawn, the dithered rest lets the meshes behind show through
+        void Draw(gps::Shader shader, int impostor, const glm::mat4& model, const glm::mat4& view, const glm::vec3& cameraPosition, float fade);
+        ImpostorStats getStats();
+
+    private:
+        struct Impostor
+        {
+            gps::Model3D* model;
+            //object space sphere around all the meshes, the frames look at its center
+            gps::BoundingSphere sphere;
+        };
+
+        std::vector<Impostor> impostors;
+        GLuint albedoArray;
+        GLuint normalArray;
+        //the quad comes from gl_VertexID, but the core profile needs a VAO bound to draw
+        GLuint quadVAO;
+        ImpostorStats stats;
+
+        static glm::vec3 frameDirection(glm::ivec2 frame);
+        static glm::ivec2 closestFrame(glm::vec3 direction);
+        static void frameAxes(glm::vec3 direction, glm::vec3& right, glm::vec3& up);
+        void bake(gps::Shader bakeShader, int impostor);
+    };
+}
+
+#endif /* ImpostorAtlas_hpp */
@@ -0,0 +1,143 @@
+#include "IndirectRenderer.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+namespace gps {
+
+    //storage buffer binding point declared in the *_indirect.vert shaders
+    const GLuint DRAW_DATA_BINDING = 0;
+
+    IndirectRenderer::IndirectRenderer() {
+        geometry = NULL;
+        streamBuffer = NULL;
+        storageAlignment = 1;
+        capacity = 0;
+    }
+
+    void IndirectRenderer::Init(gps::GeometryBuffer* geometry, gps::StreamBuffer* streamBuffer, GLuint maxDraws) {
+        this->geometry = geometry;
+        this->streamBuffer = streamBuffer;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+        reserve(maxDraws);
+    }
+
+    bool IndirectRenderer::isInitialized() {
+        return geometry != NULL;
+    }
+
+    void IndirectRenderer::reserve(GLuint drawCount) {
+        if (drawCount <= capacity) {
+            return;
+        }
+
+        //the draw ids the commands fetch through their base instance
+        geometry->reserveDraws(drawCount);
+        capacity = drawCount;
+    }
+
+    void IndirectRenderer::Draw(std::vector<RenderCommand>& commands, glm::mat4 view, PassStats& stats) {
+        drawCommands.clear();
+        drawData.clear();
+
+        //commands whose mesh was not packed into the geometry buffer cannot be drawn from it
+        std::vector<RenderCommand*> packed;
+        packed.reserve(commands.size());
+        for (size_t i = 0; i < commands.size(); i++) {
+            if (!geometry->contains(commands[i].mesh)) {
+                continue;
+            }
+
+            MeshRange range = geometry->getRange(commands[i].mesh);
+            DrawElementsIndirectCommand drawCommand;
+            drawCommand.count = range.indexCount;
+            drawCommand.instanceCount = 1;
+            drawCommand.firstIndex = range.firstIndex;
+            drawCommand.baseVertex = range.baseVertex;
+            drawCommand.baseInstance = (GLuint)drawCommands.size();
+            drawCommands.push_back(drawCommand);
+
+            DrawData data;
+            data.model = commands[i].model;
+            data.normalMatrix = glm::mat4(commands[i].normalMatrix);
+            data.layerMask = commands[i].layerMask;
+            data.materialId = commands[i].mesh->materialId;
+            data.padding[0] = data.padding[1] = 0;
+            drawData.push_back(data);
+
+            packed.push_back(&commands[i]);
+            stats.triangles += range.indexCount / 3;
+        }
+
+        if (packed.empty()) {
+            return;
+        }
+
+        reserve((GLuint)packed.size());
+
+        //one allocation for both, so a growing stream buffer cannot separate them:
+        //the commands first, then the draw data at the next storage buffer offset alignment
+        GLsizeiptr commandBytes = drawCommands.size() * sizeof(DrawElementsIndirectCommand);
+        GLsizeiptr drawDataStart = (commandBytes + storageAlignment - 1) / storageAlignment * storageAlignment;
+        GLsizeiptr drawDataBytes = drawData.size() * sizeof(DrawData);
+        GLintptr offset;
+        GLubyte* range = (GLubyte*)streamBuffer->Allocate(drawDataStart + drawDataBytes, storageAlignment, offset);
+        memcpy(range, drawCommands.data(), commandBytes);
+        memcpy(range + drawDataStart, drawData.data(), drawDataBytes);
+        streamBuffer->Flush();
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, streamBuffer->getBuffer());
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, streamBuffer->getBuffer(), offset + drawDataStart, drawDataBytes);
+
+        glBindVertexArray(geometry->getVAO());
+
+        //the model comes from the draw data, so the shaders see an identity model
+        //and a normal matrix that only has to bring world space normals into eye space
+        glm::mat4 identity = glm::mat4(1.0f);
+        glm::mat3 viewNormalMatrix = glm::mat3(glm::inverseTranspose(view));
+
+        GLuint currentProgram = 0;
+        size_t runStart = 0;
+        for (size_t i = 0; i <= packed.size(); i++) {
+            bool endOfRun = i == packed.size();
+            if (!endOfRun && i > runStart) {
+                //conditional draws are issued one by one, each under its own query
+                endOfRun = packed[i]->shader.shaderProgram != packed[runStart]->shader.shaderProgram ||
+                    packed[i]->conditionQuery != 0 || packed[runStart]->conditionQuery != 0;
+            }
+            if (!endOfRun) {
+                continue;
+            }
+
+            RenderCommand& first = *packed[runStart];
+            if (first.shader.shaderProgram != currentProgram) {
+                first.shader.useShaderProgram();
+                currentProgram = first.shader.shaderProgram;
+                glUniformMatrix4fv(glGetUniformLocation(currentProgram, "model"), 1, GL_FALSE, glm::value_ptr(identity));
+                GLint normalMatrixLoc = glGetUniformLocation(currentProgram, "normalMatrix");
+                if (normalMatrixLoc != -1) {
+                    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(viewNormalMatrix));
+                }
+                stats.shaderBinds++;
+            }
+
+            if (first.conditionQuery != 0) {
+                glBeginConditionalRender(first.conditionQuery, GL_QUERY_NO_WAIT);
+                stats.conditionalDraws++;
+            }
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (GLvoid*)(offset + runStart * sizeof(DrawElementsIndirectCommand)), (GLsizei)(i - runStart), 0);
+            if (first.conditionQuery != 0) {
+                glEndConditionalRender();
+            }
+            stats.drawCalls++;
+            runStart = i;
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, 0);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef IndirectRenderer_hpp
+#define IndirectRenderer_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GeometryBuffer.hpp"
+#include "RenderQueue.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    //layout defined by the GL spec for glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    class IndirectRenderer
+    {
+    public:
+        IndirectRenderer();
+        //the indirect commands and the draw data of every Draw are written into the stream buffer, needs a 4.3 context
+        void Init(gps::GeometryBuffer* geometry, gps::StreamBuffer* streamBuffer, GLuint maxDraws);
+        bool isInitialized();
+        //draws the sorted commands from the shared geometry buffer
+        //one glMultiDrawElementsIndirect is issued per run of equal shader, the textures come from the material arrays
+        //layered commands are drawn once, the shaders read their layer mask from the draw data
+        void Draw(std::vector<RenderCommand>& commands, glm::mat4 view, PassStats& stats);
+
+    private:
+        gps::GeometryBuffer* geometry;
+        gps::StreamBuffer* streamBuffer;
+        GLint storageAlignment;
+        GLuint capacity;
+        std::vector<DrawElementsIndirectCommand> drawCommands;
+        std::vector<DrawData> drawData;
+
+        void reserve(GLuint drawCount);
+    };
+}
+
+#endif /* IndirectRenderer_hpp */
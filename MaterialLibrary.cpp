@@ -0,0 +1,227 @@
+#include "MaterialLibrary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace gps {
+
+    //bucket of a missing texture, the shaders match no array and read black like an unbound unit did
+    const GLuint NO_TEXTURE_BUCKET = MAX_TEXTURE_BUCKETS;
+
+    MaterialLibrary::MaterialLibrary() {
+        materialBuffer = 0;
+        stats = MaterialStats();
+    }
+
+    MaterialLibrary::~MaterialLibrary() {
+        for (size_t i = 0; i < buckets.size(); i++) {
+            glDeleteTextures(1, &buckets[i].array);
+        }
+        if (materialBuffer != 0) {
+            glDeleteBuffers(1, &materialBuffer);
+        }
+    }
+
+    uint32_t MaterialLibrary::AddMaterial(GLuint diffuseTexture, GLuint specularTexture) {
+        glm::uvec2 textures = glm::uvec2(diffuseTexture, specularTexture);
+        for (size_t i = 0; i < materialTextures.size(); i++) {
+            if (materialTextures[i] == textures) {
+                return (uint32_t)i;
+            }
+        }
+        if (materialTextures.size() == MAX_MATERIALS) {
+            std::cout << "material library full, " << MAX_MATERIALS << " materials" << std::endl;
+            return 0;
+        }
+        materialTextures.push_back(textures);
+        return (uint32_t)(materialTextures.size() - 1);
+    }
+
+    void MaterialLibrary::AddModel(gps::Model3D& model3D) {
+        std::vector<gps::Mesh>& meshes = model3D.getMeshes();
+        for (size_t i = 0; i < meshes.size(); i++) {
+            GLuint diffuseTexture = 0;
+            GLuint specularTexture = 0;
+            for (size_t t = 0; t < meshes[i].textures.size(); t++) {
+                if (meshes[i].textures[t].type == "diffuseTexture") {
+                    diffuseTexture = meshes[i].textures[t].id;
+                }
+                else if (meshes[i].textures[t].type == "specularTexture") {
+                    specularTexture = meshes[i].textures[t].id;
+                }
+            }
+            meshes[i].materialId = AddMaterial(diffuseTexture, specularTexture);
+            modelTextures.push_back(diffuseTexture);
+            modelTextures.push_back(specularTexture);
+        }
+        models.push_back(&model3D);
+    }
+
+    glm::uvec2 MaterialLibrary::findLayer(GLuint texture) {
+        for (size_t b = 0; b < buckets.size(); b++) {
+            std::vector<GLuint>& textures = buckets[b].textures;
+            std::vector<GLuint>::iterator found = std::find(textures.begin(), textures.end(), texture);
+            if (found != textures.end()) {
+                return glm::uvec2((GLuint)b, (GLuint)(found - textures.begin()));
+            }
+        }
+        return glm::uvec2(NO_TEXTURE_BUCKET, 0);
+    }
+
+    void MaterialLibrary::Build() {
+        //every texture once, with its size
+        std::vector<GLuint> textures;
+        for (size_t i = 0; i < materialTextures.size(); i++) {
+            for (int t = 0; t < 2; t++) {
+                GLuint texture = materialTextures[i][t];
+                if (texture != 0 && std::find(textures.begin(), textures.end(), texture) == textures.end()) {
+                    textures.push_back(texture);
+                }
+            }
+        }
+        std::vector<glm::ivec2> sizes(textures.size());
+        for (size_t i = 0; i < textures.size(); i++) {
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &sizes[i].x);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &sizes[i].y);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        //the most used sizes get a bucket, the textures of the others are scaled into the bucket of the closest area
+        std::vector<std::pair<int, glm::ivec2> > sizeCounts;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            size_t s = 0;
+            while (s < sizeCounts.size() && sizeCounts[s].second != sizes[i]) {
+                s++;
+            }
+            if (s == sizeCounts.size()) {
+                sizeCounts.push_back(std::make_pair(0, sizes[i]));
+            }
+            sizeCounts[s].first++;
+        }
+        std::sort(sizeCounts.begin(), sizeCounts.end(), [](const std::pair<int, glm::ivec2>& a, const std::pair<int, glm::ivec2>& b) {
+            return a.first != b.first ? a.first > b.first : a.second.x * a.second.y > b.second.x * b.second.y;
+        });
+        for (size_t s = 0; s < sizeCounts.size() && s < (size_t)MAX_TEXTURE_BUCKETS; s++) {
+            TextureBucket bucket;
+            bucket.width = sizeCounts[s].second.x;
+            bucket.height = sizeCounts[s].second.y;
+            bucket.array = 0;
+            buckets.push_back(bucket);
+        }
+        for (size_t i = 0; i < textures.size(); i++) {
+            size_t closest = 0;
+            float closestDistance = INFINITY;
+            for (size_t b = 0; b < buckets.size(); b++) {
+                float distance = std::fabs(std::log2((float)(sizes[i].x * sizes[i].y) / (float)(buckets[b].width * buckets[b].height)));
+                if (distance < closestDistance) {
+                    closest = b;
+                    closestDistance = distance;
+                }
+            }
+            if (sizes[i] != glm::ivec2(buckets[closest].width, buckets[closest].height)) {
+                stats.resampled++;
+            }
+            buckets[closest].textures.push_back(textures[i]);
+        }
+
+        for (size_t b = 0; b < buckets.size(); b++) {
+            fillArray(buckets[b]);
+        }
+
+        materialLayers.resize(materialTextures.size());
+        for (size_t i = 0; i < materialTextures.size(); i++) {
+            glm::uvec2 diffuse = findLayer(materialTextures[i].x);
+            glm::uvec2 specular = findLayer(materialTextures[i].y);
+            materialLayers[i] = glm::uvec4(diffuse, specular);
+        }
+        //the block is declared with MAX_MATERIALS entries, the bound range has to cover all of them
+        glGenBuffers(1, &materialBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(glm::uvec4), NULL, GL_STATIC_DRAW);
+        if (!materialLayers.empty()) {
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, materialLayers.size() * sizeof(glm::uvec4), materialLayers.data());
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        //the arrays hold the pixels now, the textures of the models would only double the texture memory
+        //the ones added with AddMaterial belong to the caller and stay
+        std::vector<GLuint> released;
+        for (size_t i = 0; i < textures.size(); i++) {
+            if (std::find(modelTextures.begin(), modelTextures.end(), textures[i]) != modelTextures.end()) {
+                released.push_back(textures[i]);
+            }
+            else {
+                stats.resident++;
+                stats.residentMemorySize += (GLsizeiptr)sizes[i].x * sizes[i].y * 4 * 4 / 3;
+            }
+        }
+        for (size_t m = 0; m < models.size(); m++) {
+            models[m]->ReleaseTextures(released);
+        }
+        stats.released = (unsigned int)released.size();
+
+        stats.materials = (unsigned int)materialTextures.size();
+        stats.buckets = (unsigned int)buckets.size();
+        stats.layers = (unsigned int)textures.size();
+    }
+
+    //the textures are blitted into the layers, which scales the ones of another size
+    void MaterialLibrary::fillArray(TextureBucket& bucket) {
+        GLsizei layers = (GLsizei)bucket.textures.size();
+        glGenTextures(1, &bucket.array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.array);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB8_ALPHA8, bucket.width, bucket.height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        GLuint framebuffers[2];
+        glGenFramebuffers(2, framebuffers);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        for (GLsizei layer = 0; layer < layers; layer++) {
+            GLuint texture = bucket.textures[layer];
+            GLint width, height;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, bucket.array, 0, layer);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, bucket.width, bucket.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(2, framebuffers);
+
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        //4 bytes per texel and a third more for the mipmaps
+        stats.memorySize += (GLsizeiptr)bucket.width * bucket.height * layers * 4 * 4 / 3;
+    }
+
+    void MaterialLibrary::BindTextures(gps::Shader shader, int firstUnit) {
+        //every sampler of the array needs a unit of its own, the ones of missing buckets point at empty units
+        for (int i = 0; i < MAX_TEXTURE_BUCKETS; i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, i < (int)buckets.size() ? buckets[i].array : 0);
+            std::string name = "materialTextures[" + std::to_string(i) + "]";
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, name.c_str()), firstUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        GLuint blockIndex = glGetUniformBlockIndex(shader.shaderProgram, "Materials");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader.shaderProgram, blockIndex, MATERIALS_BINDING);
+        }
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIALS_BINDING, materialBuffer);
+    }
+
+    MaterialStats MaterialLibrary::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef MaterialLibrary_hpp
+#define MaterialLibrary_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Model3D.hpp"
+#include "Shader.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    //texture arrays the scene shaders sample, one per size bucket (MAX_TEXTURE_BUCKETS in materials.glsl)
+    const int MAX_TEXTURE_BUCKETS = 4;
+    //entries of the Materials uniform block, 16 bytes each fill the 16 kB every context supports
+    const int MAX_MATERIALS = 1024;
+    //uniform buffer binding point of the Materials block
+    const GLuint MATERIALS_BINDING = 1;
+
+    struct MaterialStats
+    {
+        unsigned int materials;
+        unsigned int buckets;
+        unsigned int layers;
+        //textures whose size has no bucket of its own, scaled to the closest one
+        unsigned int resampled;
+        GLsizeiptr memorySize;
+        //textures of the models, deleted once copied, and the ones added with AddMaterial that stay resident beside the arrays
+        unsigned int released;
+        unsigned int resident;
+        GLsizeiptr residentMemorySize;
+    };
+
+    //the diffuse and specular textures of the scene copied into a few GL_TEXTURE_2D_ARRAYs, one per texture size,
+    //and a table of materials that gives the array and layer of both textures of every material
+    //the meshes carry their material id in the draw data, so the scene is drawn with the arrays bound once
+    //and meshes with different textures follow each other, or share a multi-draw, without any texture bind
+    class MaterialLibrary
+    {
+    public:
+        MaterialLibrary();
+        ~MaterialLibrary();
+        //the material of the texture pair, the same pair gives the same id, 0 for a missing texture
+        uint32_t AddMaterial(GLuint diffuseTexture, GLuint specularTexture);
+        //sets the material id of every mesh of the model from its diffuseTexture and specularTexture
+        void AddModel(gps::Model3D& model3D);
+        //copies the textures into the bucket arrays and uploads the material table,
+        //then deletes the textures of the added models, the meshes keep only their material id
+        void Build();
+        //binds the arrays to units firstUnit to firstUnit + MAX_TEXTURE_BUCKETS - 1 and the table to MATERIALS_BINDING
+        void BindTextures(gps::Shader shader, int firstUnit);
+        MaterialStats getStats();
+
+    private:
+        struct TextureBucket
+        {
+            int width;
+            int height;
+            GLuint array;
+            std::vector<GLuint> textures;
+        };
+
+        //per material the diffuse and specular texture names, and after Build their bucket and layer
+        std::vector<glm::uvec2> materialTextures;
+        std::vector<glm::uvec4> materialLayers;
+        std::vector<TextureBucket> buckets;
+        //the added models and the textures they own, Build releases them
+        std::vector<gps::Model3D*> models;
+        std::vector<GLuint> modelTextures;
+        GLuint materialBuffer;
+        MaterialStats stats;
+
+        glm::uvec2 findLayer(GLuint texture);
+        void fillArray(TextureBucket& bucket);
+    };
+}
+
+#endif /* MaterialLibrary_hpp */
@@ -4,13 +4,29 @@ namespace gps {
 	/* Mesh Constructor */
 	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures)
 	{
-		this->vertices = vertices;
+		this->vertices = std::make_shared<const std::vector<Vertex> >(vertices);
 		this->indices = indices;
 		this->textures = textures;
+		this->materialId = 0;
+		this->firstIndex = 0;
 
+		this->computeBounds();
 		this->setupMesh();
 	}
 
+	/* Submesh Constructor */
+	Mesh::Mesh(std::shared_ptr<const std::vector<Vertex> > vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Buffers buffers, GLuint firstIndex)
+	{
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->materialId = 0;
+		this->firstIndex = firstIndex;
+		this->buffers = buffers;
+
+		this->computeBounds();
+	}
+
 	Buffers Mesh::getBuffers() {
 	    return this->buffers;
 	}
@@ -20,40 +36,92 @@ namespace gps {
 	{
 		shader.useShaderProgram();
 
-		//set textures
+		BindTextures(shader);
+		DrawElements();
+		UnbindTextures();
+    }
+
+	// Binds the mesh textures to units 0..n and points the samplers at them
+	void Mesh::BindTextures(gps::Shader shader)
+	{
 		for (GLuint i = 0; i < textures.size(); i++)
 		{
 			glActiveTexture(GL_TEXTURE0 + i);
 			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
 			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
+	}
 
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
+	// Unbinds the texture units used by BindTextures
+	void Mesh::UnbindTextures()
+	{
         for(GLuint i = 0; i < this->textures.size(); i++)
         {
             glActiveTexture(GL_TEXTURE0 + i);
             glBindTexture(GL_TEXTURE_2D, 0);
         }
+	}
 
-    }
+	// Issues the indexed draw call, without touching any texture state
+	void Mesh::DrawElements()
+	{
+		glBindVertexArray(this->buffers.VAO);
+		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, (GLvoid*)(this->firstIndex * sizeof(GLuint)));
+		glBindVertexArray(0);
+	}
+
+	void Mesh::DrawElementsInstanced(GLsizei instanceCount)
+	{
+		glBindVertexArray(this->buffers.VAO);
+		glDrawElementsInstanced(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, (GLvoid*)(this->firstIndex * sizeof(GLuint)), instanceCount);
+		glBindVertexArray(0);
+	}
+
+	// Computes the bounding box and sphere of the vertices
+	// only the indexed ones count, a submesh uses part of the vertices of its shape
+	void Mesh::computeBounds()
+	{
+		if (indices.empty()) {
+			bounds.min = bounds.max = glm::vec3(0.0f);
+			sphere.center = glm::vec3(0.0f);
+			sphere.radius = 0.0f;
+			return;
+		}
+
+		const std::vector<Vertex>& vertices = *this->vertices;
+		bounds = EmptyBox();
+		for (size_t i = 0; i < indices.size(); i++) {
+			bounds.min = glm::min(bounds.min, vertices[indices[i]].Position);
+			bounds.max = glm::max(bounds.max, vertices[indices[i]].Position);
+		}
+
+		// centred on the box, the radius reaches the farthest vertex
+		sphere.center = BoxCenter(bounds);
+		sphere.radius = 0.0f;
+		for (size_t i = 0; i < indices.size(); i++) {
+			sphere.radius = glm::max(sphere.radius, glm::length(vertices[indices[i]].Position - sphere.center));
+		}
+	}
 
 	// Initializes all the buffer objects/arrays
 	void Mesh::setupMesh(){
+		this->buffers = CreateBuffers(*this->vertices, this->indices);
+	}
+
+	Buffers Mesh::CreateBuffers(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices){
+		Buffers buffers;
 		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
+		glGenVertexArrays(1, &buffers.VAO);
+		glGenBuffers(1, &buffers.VBO);
+		glGenBuffers(1, &buffers.EBO);
 
-		glBindVertexArray(this->buffers.VAO);
+		glBindVertexArray(buffers.VAO);
 		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
 		// Set the vertex attribute pointers
 		// Vertex Positions
@@ -67,5 +135,6 @@ namespace gps {
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
 
 		glBindVertexArray(0);
+		return buffers;
 	}
 }
@@ -5,7 +5,9 @@
 #include "glm/glm.hpp"
 
 #include "Shader.hpp"
+#include "Bounds.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -43,16 +45,43 @@ struct Buffers {
 class Mesh
 {
 public:
-    std::vector<Vertex> vertices;
+    // shared by the submeshes of a shape, so its vertices are stored once
+    std::shared_ptr<const std::vector<Vertex> > vertices;
     std::vector<GLuint> indices;
     std::vector<Texture> textures;
+    // index of the mesh textures in the MaterialLibrary, sent with the draw data
+    GLuint materialId;
+    // first of the indices in the element buffer, non zero for the submeshes after the first of a shape
+    GLuint firstIndex;
+    // object space bounding volumes, computed once at load time
+    BoundingBox bounds;
+    BoundingSphere sphere;
 
 	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
 
+	// Submesh of a shape, its indices point into vertices shared with the other submeshes
+	// and are stored from firstIndex in the buffers, already filled by CreateBuffers
+	Mesh(std::shared_ptr<const std::vector<Vertex> > vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Buffers buffers, GLuint firstIndex);
+
+	// Uploads the vertices and indices into a new VAO/VBO/EBO with the Vertex attribute layout
+	static Buffers CreateBuffers(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+
 	Buffers getBuffers();
 
 	void Draw(gps::Shader shader);
 
+	// Binds the mesh textures to units 0..n and points the samplers at them
+	void BindTextures(gps::Shader shader);
+
+	// Unbinds the texture units used by BindTextures
+	void UnbindTextures();
+
+	// Issues the indexed draw call, without touching any texture state
+	void DrawElements();
+
+	// Same draw repeated instanceCount times, e.g. once per layer of a layered target
+	void DrawElementsInstanced(GLsizei instanceCount);
+
 private:
     /*  Render data  */
     Buffers buffers;
@@ -60,6 +89,9 @@ private:
 	// Initializes all the buffer objects/arrays
 	void setupMesh();
 
+	// Computes the bounding box and sphere of the vertices
+	void computeBounds();
+
 };
 
 }
@@ -1,5 +1,8 @@
 #include "Model3D.hpp"
 
+#include <algorithm>
+#include <map>
+
 namespace gps {
 
 	void Model3D::LoadModel(std::string fileName)
@@ -20,6 +23,11 @@ namespace gps {
 			meshes[i].Draw(shaderProgram);
 	}
 
+	std::vector<gps::Mesh>& Model3D::getMeshes()
+	{
+		return meshes;
+	}
+
 	// Does the parsing of the .obj file and fills in the data structure
 	void Model3D::ReadOBJ(std::string fileName, std::string basePath){
 
@@ -46,16 +54,24 @@ namespace gps {
 		// Loop over shapes
 		for (size_t s = 0; s < shapes.size(); s++) {
 			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+			// indices of the faces of every material of the shape, -1 for faces without one
+			std::map<int, std::vector<GLuint> > materialIndices;
 
 			// Loop over faces(polygon)
 			size_t index_offset = 0;
 			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
 				int fv = shapes[s].mesh.num_face_vertices[f];
 
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
+				// get material id
+				// Only try to read materials if the .mtl file is present
+				materialId = -1;
+				if (f < shapes[s].mesh.material_ids.size() && materials.size() > 0) {
+					materialId = shapes[s].mesh.material_ids[f];
+					if (materialId >= (int)materials.size()) {
+						materialId = -1;
+					}
+				}
+				std::vector<GLuint>& indices = materialIndices[materialId];
 
 				// Loop over vertices in the face.
 				for (size_t v = 0; v < fv; v++) {
@@ -92,48 +108,63 @@ namespace gps {
 				index_offset += fv;
 			}
 
-			// get material id
-			// Only try to read materials if the .mtl file is present
-			int a = shapes[s].mesh.material_ids.size();
-			if (a > 0 && materials.size()>0) {
-				materialId = shapes[s].mesh.material_ids[0];
-				if (materialId != -1) {
-					gps::Material currentMaterial;
-					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
-					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
-					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
-
-					//ambient texture
-					std::string ambientTexturePath = materials[materialId].ambient_texname;
-					if (!ambientTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
-					}
-
-					//diffuse texture
-					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
-					if (!diffuseTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
-					}
+			if (vertices.empty()) {
+				continue;
+			}
 
-					//specular texture
-					std::string specularTexturePath = materials[materialId].specular_texname;
-					if (!specularTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
-					}
+			// One submesh per material, the index ranges follow each other in one element buffer
+			// and all of them index the vertex buffer of the shape
+			std::vector<GLuint> shapeIndices;
+			for (std::map<int, std::vector<GLuint> >::iterator it = materialIndices.begin(); it != materialIndices.end(); ++it) {
+				shapeIndices.insert(shapeIndices.end(), it->second.begin(), it->second.end());
+			}
+			gps::Buffers buffers = gps::Mesh::CreateBuffers(vertices, shapeIndices);
+			std::shared_ptr<const std::vector<gps::Vertex> > sharedVertices = std::make_shared<const std::vector<gps::Vertex> >(std::move(vertices));
+
+			GLuint firstIndex = 0;
+			for (std::map<int, std::vector<GLuint> >::iterator it = materialIndices.begin(); it != materialIndices.end(); ++it) {
+				std::vector<gps::Texture> textures;
+				if (it->first != -1) {
+					textures = LoadMaterialTextures(materials[it->first], basePath);
 				}
+				meshes.push_back(gps::Mesh(sharedVertices, it->second, textures, buffers, firstIndex));
+				firstIndex += (GLuint)it->second.size();
 			}
+		}
+	}
+
+	// Loads the ambient, diffuse and specular textures of the material
+	std::vector<gps::Texture> Model3D::LoadMaterialTextures(const tinyobj::material_t& material, std::string basePath) {
+		std::vector<gps::Texture> textures;
+
+		//ambient texture
+		std::string ambientTexturePath = material.ambient_texname;
+		if (!ambientTexturePath.empty())
+		{
+			gps::Texture currentTexture;
+			currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
+			textures.push_back(currentTexture);
+		}
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+		//diffuse texture
+		std::string diffuseTexturePath = material.diffuse_texname;
+		if (!diffuseTexturePath.empty())
+		{
+			gps::Texture currentTexture;
+			currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
+			textures.push_back(currentTexture);
+		}
+
+		//specular texture
+		std::string specularTexturePath = material.specular_texname;
+		if (!specularTexturePath.empty())
+		{
+			gps::Texture currentTexture;
+			currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
+			textures.push_back(currentTexture);
 		}
+
+		return textures;
 	}
 
 	// Retrieves a texture associated with the object - by its name and type
@@ -216,12 +247,43 @@ namespace gps {
 		return textureID;
 	}
 
+	// Deletes the loaded textures among textureIds, e.g. once they are copied into the material arrays
+	void Model3D::ReleaseTextures(const std::vector<GLuint>& textureIds) {
+		for (size_t i = 0; i < meshes.size(); i++) {
+			for (size_t t = 0; t < meshes[i].textures.size(); t++) {
+				if (std::find(textureIds.begin(), textureIds.end(), meshes[i].textures[t].id) != textureIds.end()) {
+					meshes[i].textures[t].id = 0;
+				}
+			}
+		}
+
+		std::vector<gps::Texture> keptTextures;
+		for (size_t i = 0; i < loadedTextures.size(); i++) {
+			if (std::find(textureIds.begin(), textureIds.end(), loadedTextures[i].id) != textureIds.end()) {
+				glDeleteTextures(1, &loadedTextures[i].id);
+			}
+			else {
+				keptTextures.push_back(loadedTextures[i]);
+			}
+		}
+		loadedTextures = keptTextures;
+	}
+
 	Model3D::~Model3D() {
         for (size_t i = 0; i < loadedTextures.size(); i++) {
             glDeleteTextures(1, &loadedTextures.at(i).id);
         }
 
+        ReleaseMeshes();
+	}
+
+	// Deletes the buffers and the data of the meshes, e.g. once they are merged into static batches
+	void Model3D::ReleaseMeshes() {
         for (size_t i = 0; i < meshes.size(); i++) {
+            // the submeshes after the first of a shape share its buffers
+            if (meshes.at(i).firstIndex != 0) {
+                continue;
+            }
             GLuint VBO = meshes.at(i).getBuffers().VBO;
             GLuint EBO = meshes.at(i).getBuffers().EBO;
             GLuint VAO = meshes.at(i).getBuffers().VAO;
@@ -229,5 +291,6 @@ namespace gps {
             glDeleteBuffers(1, &EBO);
             glDeleteVertexArrays(1, &VAO);
         }
+        meshes.clear();
 	}
 }
@@ -24,6 +24,16 @@ namespace gps {
 
 		void Draw(gps::Shader shaderProgram);
 
+		// Component meshes, for callers that submit them individually
+		std::vector<gps::Mesh>& getMeshes();
+
+		// Deletes the loaded textures among textureIds, e.g. once they are copied into the material arrays
+		// the meshes keep their texture entries, with id 0
+		void ReleaseTextures(const std::vector<GLuint>& textureIds);
+
+		// Deletes the buffers and the data of the meshes, e.g. once they are merged into static batches
+		void ReleaseMeshes();
+
     private:
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
@@ -33,6 +43,9 @@ namespace gps {
 		// Does the parsing of the .obj file and fills in the data structure
 		void ReadOBJ(std::string fileName, std::string basePath);
 
+		// Loads the textures of an .mtl material
+		std::vector<gps::Texture> LoadMaterialTextures(const tinyobj::material_t& material, std::string basePath);
+
 		// Retrieves a texture associated with the object - by its name and type
 		gps::Texture LoadTexture(std::string path, std::string type);
 
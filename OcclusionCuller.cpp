@@ -0,0 +1,342 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SIMD_WIDTH 4
+#else
+#define OCCLUSION_SIMD_WIDTH 1
+#endif
+
+namespace gps {
+
+    const int TILE_WIDTH = 64;
+    const int TILE_HEIGHT = 32;
+    //boxes tested per worker task
+    const unsigned int TEST_BATCH_SIZE = 64;
+
+    typedef std::chrono::high_resolution_clock OcclusionClock;
+
+    static double elapsedMilliseconds(OcclusionClock::time_point start) {
+        return std::chrono::duration<double, std::milli>(OcclusionClock::now() - start).count();
+    }
+
+    OcclusionCuller::OcclusionCuller() {
+        width = 0;
+        height = 0;
+        tilesX = 0;
+        tilesY = 0;
+        viewProjection = glm::mat4(1.0f);
+        pool = NULL;
+        stats = OcclusionStats();
+    }
+
+    void OcclusionCuller::Init(int bufferWidth, int bufferHeight, gps::WorkerPool* workerPool) {
+        //every 4 pixel group stays inside one row and one tile
+        width = (std::max(bufferWidth, 4) + 3) & ~3;
+        height = std::max(bufferHeight, 1);
+        tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        pool = workerPool;
+        depthBuffer.assign((size_t)width * height, 1.0f);
+        tileBins.assign((size_t)tilesX * tilesY, std::vector<uint32_t>());
+    }
+
+    void OcclusionCuller::BeginFrame(const glm::mat4& matrix) {
+        viewProjection = matrix;
+        std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+        triangles.clear();
+        for (size_t i = 0; i < tileBins.size(); i++) {
+            tileBins[i].clear();
+        }
+        stats = OcclusionStats();
+    }
+
+    void OcclusionCuller::AddOccluder(const Occluder& occluder, const glm::mat4& model) {
+        OcclusionClock::time_point start = OcclusionClock::now();
+
+        glm::mat4 transform = viewProjection * model;
+        clipPositions.resize(occluder.positions.size());
+        for (size_t i = 0; i < occluder.positions.size(); i++) {
+            clipPositions[i] = transform * glm::vec4(occluder.positions[i], 1.0f);
+        }
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+            stats.occluderTriangles++;
+            addClippedTriangle(clipPositions[occluder.indices[i]], clipPositions[occluder.indices[i + 1]],
+                clipPositions[occluder.indices[i + 2]]);
+        }
+        stats.rasterizeMilliseconds += elapsedMilliseconds(start);
+    }
+
+    //clips against the near plane z = -w, the far side needs no clipping since depth only decreases
+    void OcclusionCuller::addClippedTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+        const glm::vec4 input[3] = { a, b, c };
+        float distances[3];
+        int behind = 0;
+        for (int i = 0; i < 3; i++) {
+            distances[i] = input[i].z + input[i].w;
+            behind += distances[i] < 0.0f ? 1 : 0;
+        }
+        if (behind == 3) {
+            return;
+        }
+        if (behind == 0) {
+            setupTriangle(a, b, c);
+            return;
+        }
+
+        //one vertex behind leaves a quad, two leave a triangle
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int i = 0; i < 3; i++) {
+            int next = (i + 1) % 3;
+            if (distances[i] >= 0.0f) {
+                polygon[count++] = input[i];
+            }
+            if ((distances[i] >= 0.0f) != (distances[next] >= 0.0f)) {
+                float t = distances[i] / (distances[i] - distances[next]);
+                polygon[count++] = input[i] + (input[next] - input[i]) * t;
+            }
+        }
+        for (int i = 1; i + 1 < count; i++) {
+            setupTriangle(polygon[0], polygon[i], polygon[i + 1]);
+        }
+    }
+
+    void OcclusionCuller::setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+        //window coordinates, y up like the gl viewport
+        glm::vec3 v[3];
+        const glm::vec4* clip[3] = { &a, &b, &c };
+        for (int i = 0; i < 3; i++) {
+            glm::vec3 ndc = glm::vec3(*clip[i]) / clip[i]->w;
+            v[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+        }
+
+        //counter clockwise triangles face the camera, the others are culled like GL_CULL_FACE does
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (!(area > 0.0f)) {
+            return;
+        }
+
+        //range of the pixels whose centers may be covered
+        float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+        float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+        float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+        float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+        ScreenTriangle triangle;
+        triangle.minX = std::max(0, (int)std::ceil(minX - 0.5f));
+        triangle.maxX = std::min(width - 1, (int)std::floor(maxX - 0.5f));
+        triangle.minY = std::max(0, (int)std::ceil(minY - 0.5f));
+        triangle.maxY = std::min(height - 1, (int)std::floor(maxY - 0.5f));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            return;
+        }
+
+        //edge i goes from v[i] to v[i + 1] and is positive inside
+        for (int i = 0; i < 3; i++) {
+            const glm::vec3& from = v[i];
+            const glm::vec3& to = v[(i + 1) % 3];
+            triangle.edgeA[i] = from.y - to.y;
+            triangle.edgeB[i] = to.x - from.x;
+            triangle.edgeC[i] = -(triangle.edgeA[i] * from.x + triangle.edgeB[i] * from.y);
+        }
+
+        //window depth is linear in screen space
+        float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].z - v[0].z)) / area;
+        float dzdy = ((v[1].x - v[0].x) * (v[2].z - v[0].z) - (v[2].x - v[0].x) * (v[1].z - v[0].z)) / area;
+        triangle.depthA = dzdx;
+        triangle.depthB = dzdy;
+        triangle.depthC = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+
+        uint32_t index = (uint32_t)triangles.size();
+        triangles.push_back(triangle);
+        stats.rasterizedTriangles++;
+
+        for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++) {
+            for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++) {
+                tileBins[tileY * tilesX + tileX].push_back(index);
+            }
+        }
+    }
+
+    void OcclusionCuller::Rasterize() {
+        OcclusionClock::time_point start = OcclusionClock::now();
+        unsigned int tileCount = (unsigned int)tileBins.size();
+        if (pool != NULL) {
+            pool->Run(tileCount, [this](unsigned int tile) { rasterizeTile(tile); });
+        }
+        else {
+            for (unsigned int tile = 0; tile < tileCount; tile++) {
+                rasterizeTile(tile);
+            }
+        }
+        stats.rasterizeMilliseconds += elapsedMilliseconds(start);
+    }
+
+    //tiles do not share pixels, so they are rasterized without synchronization
+    void OcclusionCuller::rasterizeTile(unsigned int tile) {
+        int tileMinX = (int)(tile % tilesX) * TILE_WIDTH;
+        int tileMinY = (int)(tile / tilesX) * TILE_HEIGHT;
+        int tileMaxX = std::min(tileMinX + TILE_WIDTH, width) - 1;
+        int tileMaxY = std::min(tileMinY + TILE_HEIGHT, height) - 1;
+
+        const std::vector<uint32_t>& bin = tileBins[tile];
+        for (size_t t = 0; t < bin.size(); t++) {
+            const ScreenTriangle& triangle = triangles[bin[t]];
+            int minX = std::max(triangle.minX, tileMinX) & ~(OCCLUSION_SIMD_WIDTH - 1);
+            int maxX = std::min(triangle.maxX, tileMaxX);
+            int minY = std::max(triangle.minY, tileMinY);
+            int maxY = std::min(triangle.maxY, tileMaxY);
+
+            for (int y = minY; y <= maxY; y++) {
+                float centerY = (float)y + 0.5f;
+                float* row = &depthBuffer[(size_t)y * width];
+                float rowEdge[3];
+                for (int e = 0; e < 3; e++) {
+                    rowEdge[e] = triangle.edgeB[e] * centerY + triangle.edgeC[e];
+                }
+                float rowDepth = triangle.depthB * centerY + triangle.depthC;
+
+#if OCCLUSION_SIMD_WIDTH == 4
+                const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]), edgeA1 = _mm_set1_ps(triangle.edgeA[1]), edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+                __m128 rowEdge0 = _mm_set1_ps(rowEdge[0]), rowEdge1 = _mm_set1_ps(rowEdge[1]), rowEdge2 = _mm_set1_ps(rowEdge[2]);
+                __m128 depthA = _mm_set1_ps(triangle.depthA), rowDepthV = _mm_set1_ps(rowDepth);
+                __m128 zero = _mm_setzero_ps();
+                for (int x = minX; x <= maxX; x += 4) {
+                    __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                    __m128 inside = _mm_and_ps(
+                        _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, centerX), rowEdge0), zero),
+                            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, centerX), rowEdge1), zero)),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, centerX), rowEdge2), zero));
+                    if (_mm_movemask_ps(inside) == 0) {
+                        continue;
+                    }
+                    __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, centerX), rowDepthV);
+                    __m128 stored = _mm_loadu_ps(row + x);
+                    __m128 nearest = _mm_min_ps(stored, depth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+                }
+#else
+                for (int x = minX; x <= maxX; x++) {
+                    float centerX = (float)x + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++) {
+                        inside = inside && triangle.edgeA[e] * centerX + rowEdge[e] >= 0.0f;
+                    }
+                    if (inside) {
+                        row[x] = std::min(row[x], triangle.depthA * centerX + rowDepth);
+                    }
+                }
+#endif
+            }
+        }
+    }
+
+    bool OcclusionCuller::TestBox(const BoundingBox& box) const {
+        float minX = (float)width, minY = (float)height, maxX = 0.0f, maxY = 0.0f;
+        float nearestDepth = 1.0f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 position = glm::vec4(
+                (corner & 1) ? box.max.x : box.min.x,
+                (corner & 2) ? box.max.y : box.min.y,
+                (corner & 4) ? box.max.z : box.min.z,
+                1.0f);
+            glm::vec4 clip = viewProjection * position;
+            //a box crossing the near plane covers the camera, it is never occluded
+            if (clip.z < -clip.w) {
+                return true;
+            }
+            float screenX = (clip.x / clip.w * 0.5f + 0.5f) * width;
+            float screenY = (clip.y / clip.w * 0.5f + 0.5f) * height;
+            minX = std::min(minX, screenX);
+            maxX = std::max(maxX, screenX);
+            minY = std::min(minY, screenY);
+            maxY = std::max(maxY, screenY);
+            nearestDepth = std::min(nearestDepth, clip.z / clip.w * 0.5f + 0.5f);
+        }
+
+        //every pixel the box touches plus a one pixel border: occluders only cover the pixels whose
+        //centers they contain, so a silhouette pixel may be marked covered while the box shows through it
+        int x0 = std::max(0, (int)std::floor(minX) - 1);
+        int x1 = std::min(width - 1, (int)std::floor(maxX) + 1);
+        int y0 = std::max(0, (int)std::floor(minY) - 1);
+        int y1 = std::min(height - 1, (int)std::floor(maxY) + 1);
+        if (x0 > x1 || y0 > y1) {
+            //outside the screen, that is for the frustum to decide
+            return true;
+        }
+
+        for (int y = y0; y <= y1; y++) {
+            const float* row = &depthBuffer[(size_t)y * width];
+#if OCCLUSION_SIMD_WIDTH == 4
+            __m128 boxDepth = _mm_set1_ps(nearestDepth);
+            __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+            __m128i first = _mm_set1_epi32(x0 - 1), last = _mm_set1_epi32(x1 + 1);
+            for (int x = x0 & ~3; x <= x1; x += 4) {
+                __m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+                __m128 inRange = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(lanes, first), _mm_cmplt_epi32(lanes, last)));
+                //a pixel at least as far as the box lets the box through
+                __m128 uncovered = _mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth);
+                if (_mm_movemask_ps(_mm_and_ps(inRange, uncovered)) != 0) {
+                    return true;
+                }
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                if (row[x] >= nearestDepth) {
+                    return true;
+                }
+            }
+#endif
+        }
+        return false;
+    }
+
+    void OcclusionCuller::TestBoxes(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visible) {
+        OcclusionClock::time_point start = OcclusionClock::now();
+        visible.resize(boxes.size());
+
+        unsigned int batchCount = (unsigned int)((boxes.size() + TEST_BATCH_SIZE - 1) / TEST_BATCH_SIZE);
+        std::function<void(unsigned int)> testBatch = [this, &boxes, &visible](unsigned int batch) {
+            size_t end = std::min(boxes.size(), (size_t)(batch + 1) * TEST_BATCH_SIZE);
+            for (size_t i = (size_t)batch * TEST_BATCH_SIZE; i < end; i++) {
+                visible[i] = TestBox(boxes[i]) ? 1 : 0;
+            }
+        };
+        if (pool != NULL) {
+            pool->Run(batchCount, testBatch);
+        }
+        else {
+            for (unsigned int batch = 0; batch < batchCount; batch++) {
+                testBatch(batch);
+            }
+        }
+
+        for (size_t i = 0; i < boxes.size(); i++) {
+            stats.occluded += visible[i] ? 0 : 1;
+        }
+        stats.tested += (unsigned int)boxes.size();
+        stats.testMilliseconds += elapsedMilliseconds(start);
+    }
+
+    int OcclusionCuller::getWidth() {
+        return width;
+    }
+
+    int OcclusionCuller::getHeight() {
+        return height;
+    }
+
+    const std::vector<float>& OcclusionCuller::getDepthBuffer() {
+        return depthBuffer;
+    }
+
+    OcclusionStats OcclusionCuller::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef OcclusionCuller_hpp
+#define OcclusionCuller_hpp
+
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "WorkerPool.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    //triangles of a mesh that hides what is behind it, kept on the cpu
+    struct Occluder
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    struct OcclusionStats
+    {
+        unsigned int occluderTriangles;
+        unsigned int rasterizedTriangles;
+        unsigned int tested;
+        unsigned int occluded;
+        double rasterizeMilliseconds;
+        double testMilliseconds;
+    };
+
+    //software depth buffer at a fraction of the window resolution
+    //occluders are rasterized into it tile by tile on the worker threads, 4 pixels at a time with SSE,
+    //then the screen rectangle of each occludee box is compared with the nearest depth of the box
+    //depth is the window depth in [0, 1], everything stays on the cpu so no gpu readback is needed
+    class OcclusionCuller
+    {
+    public:
+        OcclusionCuller();
+        //width is rounded up to a multiple of 4, a null pool rasterizes on the calling thread
+        void Init(int width, int height, gps::WorkerPool* pool);
+        //clears the depth buffer and the queued occluders
+        void BeginFrame(const glm::mat4& viewProjection);
+        //clips the occluder triangles against the near plane and queues the front facing ones
+        void AddOccluder(const Occluder& occluder, const glm::mat4& model);
+        //rasterizes the queued triangles into the depth buffer
+        void Rasterize();
+        //false when every pixel covered by the box holds an occluder nearer than the box
+        bool TestBox(const BoundingBox& box) const;
+        //tests every box, visible[i] is set to 0 when box i is occluded
+        void TestBoxes(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visible);
+
+        int getWidth();
+        int getHeight();
+        const std::vector<float>& getDepthBuffer();
+        OcclusionStats getStats();
+
+    private:
+        //edges and depth stored as planes over the pixel centers, E(x, y) = a * x + b * y + c
+        struct ScreenTriangle
+        {
+            float edgeA[3], edgeB[3], edgeC[3];
+            float depthA, depthB, depthC;
+            int minX, minY, maxX, maxY;
+        };
+
+        int width;
+        int height;
+        int tilesX;
+        int tilesY;
+        glm::mat4 viewProjection;
+        gps::WorkerPool* pool;
+        std::vector<float> depthBuffer;
+        std::vector<glm::vec4> clipPositions;
+        std::vector<ScreenTriangle> triangles;
+        std::vector<std::vector<uint32_t> > tileBins;
+        OcclusionStats stats;
+
+        void addClippedTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void rasterizeTile(unsigned int tile);
+    };
+}
+
+#endif /* OcclusionCuller_hpp */
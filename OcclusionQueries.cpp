@@ -0,0 +1,219 @@
+#include "OcclusionQueries.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+
+namespace gps {
+
+    //visible objects are queried again after this many frames, spread over the frames by object index
+    const unsigned int VISIBLE_QUERY_INTERVAL = 8;
+    //boxes closer than this to the camera may be cut by the near plane and are treated as visible
+    const float NEAR_MARGIN = 0.2f;
+
+    static double nowMilliseconds() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    OcclusionQueries::OcclusionQueries() {
+        mode = QUERY_MODE_CONDITIONAL;
+        frame = 0;
+        cameraPosition = glm::vec3(0.0f);
+        boxTransformLoc = -1;
+        boxVAO = 0;
+        boxVBO = 0;
+        boxEBO = 0;
+        stats = OcclusionQueryStats();
+    }
+
+    OcclusionQueries::~OcclusionQueries() {
+        if (boxVAO != 0) {
+            for (size_t i = 0; i < objects.size(); i++) {
+                glDeleteQueries(1, &objects[i].query);
+            }
+            glDeleteVertexArrays(1, &boxVAO);
+            glDeleteBuffers(1, &boxVBO);
+            glDeleteBuffers(1, &boxEBO);
+        }
+    }
+
+    void OcclusionQueries::Init(size_t objectCount, gps::Shader shader) {
+        boxShader = shader;
+        boxTransformLoc = glGetUniformLocation(boxShader.shaderProgram, "boxTransform");
+
+        objects.resize(objectCount);
+        for (size_t i = 0; i < objectCount; i++) {
+            ObjectState& state = objects[i];
+            glGenQueries(1, &state.query);
+            state.issued = false;
+            state.pending = false;
+            state.visible = true;
+            state.issueFrame = 0;
+            state.issueTime = 0.0;
+            state.seenFrame = 0;
+        }
+        createBoxMesh();
+    }
+
+    //unit cube, scaled and moved onto each queried box
+    void OcclusionQueries::createBoxMesh() {
+        const GLfloat corners[] = {
+            0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  0.0f, 1.0f, 1.0f,  1.0f, 1.0f, 1.0f };
+        const GLuint indices[] = {
+            0, 4, 6, 0, 6, 2,  1, 3, 7, 1, 7, 5,
+            0, 1, 5, 0, 5, 4,  2, 6, 7, 2, 7, 3,
+            0, 2, 3, 0, 3, 1,  4, 5, 7, 4, 7, 6 };
+
+        glGenVertexArrays(1, &boxVAO);
+        glGenBuffers(1, &boxVBO);
+        glGenBuffers(1, &boxEBO);
+
+        glBindVertexArray(boxVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+        glBindVertexArray(0);
+    }
+
+    bool OcclusionQueries::isInitialized() {
+        return boxVAO != 0;
+    }
+
+    void OcclusionQueries::setMode(OcclusionQueryMode queryMode) {
+        mode = queryMode;
+    }
+
+    OcclusionQueryMode OcclusionQueries::getMode() {
+        return mode;
+    }
+
+    void OcclusionQueries::BeginFrame(glm::vec3 position) {
+        frame++;
+        cameraPosition = position;
+        requests.clear();
+        stats = OcclusionQueryStats();
+
+        double now = nowMilliseconds();
+        unsigned int latencyFrames = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < pendingObjects.size(); i++) {
+            ObjectState& state = objects[pendingObjects[i]];
+            GLuint available = 0;
+            glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                pendingObjects[kept++] = pendingObjects[i];
+                continue;
+            }
+
+            GLuint anySamples = 0;
+            glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &anySamples);
+            state.visible = anySamples != 0;
+            state.pending = false;
+
+            stats.resolved++;
+            latencyFrames += frame - state.issueFrame;
+            stats.latencyMilliseconds += now - state.issueTime;
+        }
+        pendingObjects.resize(kept);
+
+        if (stats.resolved > 0) {
+            stats.latencyFrames = (float)latencyFrames / stats.resolved;
+            stats.latencyMilliseconds /= stats.resolved;
+        }
+    }
+
+    bool OcclusionQueries::shouldDraw(uint32_t object, GLuint& conditionQuery) {
+        ObjectState& state = objects[object];
+        conditionQuery = 0;
+        stats.tracked++;
+
+        //a result from before the object left the frustum says nothing about now
+        if (state.seenFrame + 1 < frame) {
+            state.visible = true;
+        }
+        state.seenFrame = frame;
+
+        if (state.visible) {
+            return true;
+        }
+        if (mode == QUERY_MODE_CONDITIONAL) {
+            conditionQuery = state.query;
+            stats.conditional++;
+            return true;
+        }
+        stats.rejected++;
+        return false;
+    }
+
+    void OcclusionQueries::requestQuery(uint32_t object, const BoundingBox& box) {
+        ObjectState& state = objects[object];
+        if (state.pending) {
+            return;
+        }
+        if (state.visible && state.issued && (frame + object) % VISIBLE_QUERY_INTERVAL != 0) {
+            return;
+        }
+
+        //the camera inside the box would clip the faces it should be tested with
+        glm::vec3 closest = glm::min(glm::max(cameraPosition, box.min), box.max);
+        if (glm::length(closest - cameraPosition) < NEAR_MARGIN) {
+            state.visible = true;
+            return;
+        }
+
+        QueryRequest request;
+        request.object = object;
+        request.box = box;
+        requests.push_back(request);
+    }
+
+    void OcclusionQueries::IssueQueries(const glm::mat4& viewProjection) {
+        if (requests.empty()) {
+            return;
+        }
+
+        //the boxes are tested against the depth buffer but must not change it
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+
+        boxShader.useShaderProgram();
+        glBindVertexArray(boxVAO);
+
+        double now = nowMilliseconds();
+        for (size_t i = 0; i < requests.size(); i++) {
+            ObjectState& state = objects[requests[i].object];
+            const BoundingBox& box = requests[i].box;
+            glm::mat4 boxTransform = glm::translate(glm::mat4(1.0f), box.min);
+            boxTransform = glm::scale(boxTransform, box.max - box.min);
+            boxTransform = viewProjection * boxTransform;
+            glUniformMatrix4fv(boxTransformLoc, 1, GL_FALSE, glm::value_ptr(boxTransform));
+
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, state.query);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+            state.issued = true;
+            state.pending = true;
+            state.issueFrame = frame;
+            state.issueTime = now;
+            pendingObjects.push_back(requests[i].object);
+            stats.issued++;
+        }
+
+        glBindVertexArray(0);
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        requests.clear();
+    }
+
+    OcclusionQueryStats OcclusionQueries::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef OcclusionQueries_hpp
+#define OcclusionQueries_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "Shader.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    //what the result of a box query drives
+    enum OcclusionQueryMode {
+        //an occluded object is still submitted, inside conditional rendering on its last query
+        QUERY_MODE_CONDITIONAL,
+        //an occluded object is not submitted until a later query finds it visible again
+        QUERY_MODE_NEXT_FRAME
+    };
+
+    struct OcclusionQueryStats
+    {
+        unsigned int tracked;
+        unsigned int issued;
+        unsigned int resolved;
+        unsigned int rejected;
+        unsigned int conditional;
+        //average delay between issuing a query and its result becoming available
+        float latencyFrames;
+        double latencyMilliseconds;
+    };
+
+    //GL_ANY_SAMPLES_PASSED queries on the bounding boxes of tracked objects, drawn against the
+    //depth buffer of the finished opaque pass
+    //results are only read once available, so the cpu never waits on the gpu: an object keeps its last
+    //visibility until a newer result arrives, visible ones are queried again every few frames
+    //and occluded ones every frame
+    class OcclusionQueries
+    {
+    public:
+        OcclusionQueries();
+        ~OcclusionQueries();
+        //creates one query per object and the box mesh drawn by the queries
+        void Init(size_t objectCount, gps::Shader boxShader);
+        bool isInitialized();
+        void setMode(OcclusionQueryMode mode);
+        OcclusionQueryMode getMode();
+        //reads the results that became available, boxes around cameraPosition are never queried
+        void BeginFrame(glm::vec3 cameraPosition);
+        //false when the object should not be drawn this frame, otherwise conditionQuery is the
+        //query the draw must be conditional on, or 0
+        bool shouldDraw(uint32_t object, GLuint& conditionQuery);
+        //queues a query of the object world box if one is due
+        void requestQuery(uint32_t object, const BoundingBox& box);
+        //draws the queued boxes without writing color or depth
+        void IssueQueries(const glm::mat4& viewProjection);
+        OcclusionQueryStats getStats();
+
+    private:
+        struct ObjectState
+        {
+            GLuint query;
+            bool issued;
+            bool pending;
+            bool visible;
+            unsigned int issueFrame;
+            double issueTime;
+            //last frame the object was inside the frustum
+            unsigned int seenFrame;
+        };
+
+        struct QueryRequest
+        {
+            uint32_t object;
+            BoundingBox box;
+        };
+
+        std::vector<ObjectState> objects;
+        std::vector<uint32_t> pendingObjects;
+        std::vector<QueryRequest> requests;
+        OcclusionQueryMode mode;
+        unsigned int frame;
+        glm::vec3 cameraPosition;
+        gps::Shader boxShader;
+        GLint boxTransformLoc;
+        GLuint boxVAO;
+        GLuint boxVBO;
+        GLuint boxEBO;
+        OcclusionQueryStats stats;
+
+        void createBoxMesh();
+    };
+}
+
+#endif /* OcclusionQueries_hpp */
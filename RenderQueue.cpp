@@ -0,0 +1,186 @@
+#include "RenderQueue.hpp"
+#include "IndirectRenderer.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    const int SHADER_BITS = 12;
+    const int DEPTH_BITS = 24;
+
+    RenderQueue::RenderQueue() {
+        for (int pass = 0; pass < PASS_COUNT; pass++) {
+            stats[pass] = PassStats();
+            views[pass] = glm::mat4(1.0f);
+            farPlanes[pass] = 1.0f;
+            culledCounts[pass] = 0;
+            instancedLayers[pass] = false;
+        }
+        streamBuffer = NULL;
+        drawDataStride = sizeof(DrawData);
+    }
+
+    void RenderQueue::setStreamBuffer(gps::StreamBuffer* buffer) {
+        streamBuffer = buffer;
+        GLint alignment = 1;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        drawDataStride = ((GLsizeiptr)sizeof(DrawData) + alignment - 1) / alignment * alignment;
+    }
+
+    void RenderQueue::BindDrawUniforms(GLuint shaderProgram) {
+        GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, "DrawUniforms");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shaderProgram, blockIndex, DRAW_UNIFORMS_BINDING);
+        }
+    }
+
+    uint64_t RenderQueue::MakeKey(RenderPass pass, GLuint shaderProgram, float depth) {
+        const uint64_t depthMax = (1ull << DEPTH_BITS) - 1;
+        uint64_t depthBucket = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * (float)depthMax);
+
+        uint64_t key = (uint64_t)pass;
+        key = (key << SHADER_BITS) | (shaderProgram & ((1u << SHADER_BITS) - 1));
+        key = (key << DEPTH_BITS) | depthBucket;
+        return key;
+    }
+
+    void RenderQueue::setView(RenderPass pass, glm::mat4 view, float farPlane) {
+        views[pass] = view;
+        farPlanes[pass] = farPlane;
+    }
+
+    void RenderQueue::Clear(RenderPass pass) {
+        commands[pass].clear();
+        culledCounts[pass] = 0;
+    }
+
+    void RenderQueue::Submit(RenderPass pass, gps::Shader shader, gps::Mesh& mesh, const ObjectTransform& transform,
+        GLuint conditionQuery, uint32_t layerMask) {
+        BoundingBox worldBounds = TransformBox(mesh.bounds, transform.model);
+
+        //opaque geometry goes front-to-back, so the depth is the distance along the view direction
+        glm::vec4 viewPos = views[pass] * glm::vec4(BoxCenter(worldBounds), 1.0f);
+        float depth = -viewPos.z / farPlanes[pass];
+
+        RenderCommand command;
+        command.key = MakeKey(pass, shader.shaderProgram, depth);
+        command.shader = shader;
+        command.mesh = &mesh;
+        command.model = transform.model;
+        command.normalMatrix = transform.normalMatrix;
+        command.worldBounds = worldBounds;
+        command.conditionQuery = conditionQuery;
+        command.layerMask = layerMask;
+        commands[pass].push_back(command);
+    }
+
+    void RenderQueue::Submit(RenderPass pass, gps::Shader shader, gps::Model3D& model3D, const ObjectTransform& transform) {
+        std::vector<gps::Mesh>& meshes = model3D.getMeshes();
+        for (size_t i = 0; i < meshes.size(); i++) {
+            Submit(pass, shader, meshes[i], transform);
+        }
+    }
+
+    void RenderQueue::countCulled(RenderPass pass, unsigned int count) {
+        culledCounts[pass] += count;
+    }
+
+    void RenderQueue::sortCommands(RenderPass pass) {
+        std::stable_sort(commands[pass].begin(), commands[pass].end(),
+            [](const RenderCommand& a, const RenderCommand& b) { return a.key < b.key; });
+    }
+
+    PassStats& RenderQueue::beginStats(RenderPass pass) {
+        PassStats& passStats = stats[pass];
+        passStats = PassStats();
+        passStats.visible = (unsigned int)commands[pass].size();
+        passStats.culled = culledCounts[pass];
+        passStats.submitted = passStats.visible + passStats.culled;
+        return passStats;
+    }
+
+    void RenderQueue::Flush(RenderPass pass) {
+        std::vector<RenderCommand>& queue = commands[pass];
+        sortCommands(pass);
+
+        PassStats& passStats = beginStats(pass);
+        if (queue.empty()) {
+            return;
+        }
+
+        //the draw data of the whole pass goes into one range, each draw binds its own part of it
+        GLintptr drawDataOffset;
+        GLubyte* drawDataRange = (GLubyte*)streamBuffer->Allocate(queue.size() * drawDataStride, drawDataStride, drawDataOffset);
+        for (size_t i = 0; i < queue.size(); i++) {
+            DrawData* data = (DrawData*)(drawDataRange + i * drawDataStride);
+            data->model = queue[i].model;
+            //the view is a rotation and a translation, so its inverse transpose is its own 3x3
+            data->normalMatrix = glm::mat4(glm::mat3(views[pass]) * queue[i].normalMatrix);
+            data->layerMask = queue[i].layerMask;
+            data->materialId = queue[i].mesh->materialId;
+            data->padding[0] = data->padding[1] = 0;
+        }
+        streamBuffer->Flush();
+        GLuint drawDataBuffer = streamBuffer->getBuffer();
+
+        GLuint currentProgram = 0;
+        for (size_t i = 0; i < queue.size(); i++) {
+            RenderCommand& command = queue[i];
+
+            if (command.shader.shaderProgram != currentProgram) {
+                command.shader.useShaderProgram();
+                currentProgram = command.shader.shaderProgram;
+                BindDrawUniforms(currentProgram);
+                passStats.shaderBinds++;
+            }
+
+            glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, drawDataBuffer,
+                drawDataOffset + i * drawDataStride, sizeof(DrawData));
+            GLsizei instances = 1;
+            if (instancedLayers[pass] && command.layerMask != 0) {
+                instances = layerCount(command.layerMask);
+            }
+
+            //the gpu skips the draw when the query found no samples, and draws it when the result is not ready
+            if (command.conditionQuery != 0) {
+                glBeginConditionalRender(command.conditionQuery, GL_QUERY_NO_WAIT);
+                command.mesh->DrawElements();
+                glEndConditionalRender();
+                passStats.conditionalDraws++;
+            }
+            else if (instances > 1) {
+                command.mesh->DrawElementsInstanced(instances);
+            }
+            else {
+                command.mesh->DrawElements();
+            }
+            passStats.drawCalls++;
+            passStats.triangles += (unsigned int)command.mesh->indices.size() / 3;
+        }
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, 0);
+    }
+
+    void RenderQueue::FlushIndirect(RenderPass pass, gps::IndirectRenderer& indirectRenderer) {
+        sortCommands(pass);
+
+        PassStats& passStats = beginStats(pass);
+        indirectRenderer.Draw(commands[pass], views[pass], passStats);
+    }
+
+    PassStats RenderQueue::getStats(RenderPass pass) {
+        return stats[pass];
+    }
+
+    void RenderQueue::setInstancedLayers(RenderPass pass, bool instanced) {
+        instancedLayers[pass] = instanced;
+    }
+
+    GLsizei RenderQueue::layerCount(uint32_t layerMask) {
+        GLsizei count = 0;
+        for (; layerMask != 0; layerMask &= layerMask - 1) {
+            count++;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef RenderQueue_hpp
+#define RenderQueue_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "Model3D.hpp"
+#include "Shader.hpp"
+#include "Bounds.hpp"
+#include "TransformCache.hpp"
+#include "StreamBuffer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    enum RenderPass {PASS_SHADOW, PASS_DEPTH, PASS_OPAQUE, PASS_COUNT};
+
+    class IndirectRenderer;
+
+    struct RenderCommand
+    {
+        uint64_t key;
+        gps::Shader shader;
+        gps::Mesh* mesh;
+        glm::mat4 model;
+        //world space, from the transform cache
+        glm::mat3 normalMatrix;
+        BoundingBox worldBounds;
+        //occlusion query the draw is conditional on, 0 draws unconditionally
+        GLuint conditionQuery;
+        //layers of a layered target the draw goes to, sent in the draw data, 0 for other targets
+        uint32_t layerMask;
+    };
+
+    //per-draw data written into the stream buffer, the std140 DrawUniforms block (draw_uniforms.glsl)
+    //and the std430 element of the indirect storage buffer, read there by draw id
+    //the struct is padded to the 16 byte alignment of its matrices
+    struct DrawData
+    {
+        glm::mat4 model;
+        glm::mat4 normalMatrix;
+        GLuint layerMask;
+        //entry of the MaterialLibrary table the shaders sample the mesh textures through
+        GLuint materialId;
+        GLuint padding[2];
+    };
+
+    //uniform buffer binding point of the DrawUniforms block
+    const GLuint DRAW_UNIFORMS_BINDING = 0;
+
+    struct PassStats
+    {
+        unsigned int submitted;
+        unsigned int culled;
+        unsigned int visible;
+        unsigned int drawCalls;
+        unsigned int shaderBinds;
+        unsigned int triangles;
+        unsigned int conditionalDraws;
+    };
+
+    class RenderQueue
+    {
+    public:
+        RenderQueue();
+        //the buffer Flush writes the per-draw data into, needs a context for the offset alignment
+        void setStreamBuffer(gps::StreamBuffer* buffer);
+        //points the DrawUniforms block of the program, if it has one, at DRAW_UNIFORMS_BINDING
+        static void BindDrawUniforms(GLuint shaderProgram);
+        //builds the 64 bit sort key, most significant bits first:
+        //pass (4) | shader program (12) | depth bucket (24)
+        //the textures come from the material arrays the pass binds once, so they do not split the draws
+        static uint64_t MakeKey(RenderPass pass, GLuint shaderProgram, float depth);
+        //sets the view used to compute the depth bucket of the pass submissions
+        //depth is measured along the view direction and normalized by farPlane
+        void setView(RenderPass pass, glm::mat4 view, float farPlane);
+        //removes every submission of the pass
+        void Clear(RenderPass pass);
+        //queues a single mesh, a non zero conditionQuery wraps its draw in conditional rendering
+        void Submit(RenderPass pass, gps::Shader shader, gps::Mesh& mesh, const ObjectTransform& transform,
+            GLuint conditionQuery = 0, uint32_t layerMask = 0);
+        //queues every mesh of a model
+        void Submit(RenderPass pass, gps::Shader shader, gps::Model3D& model3D, const ObjectTransform& transform);
+        //records draws that were culled before being submitted, e.g. by a bvh query
+        void countCulled(RenderPass pass, unsigned int count);
+        //sorts the pass submissions by key and draws them, changing state only when the key requires it
+        void Flush(RenderPass pass);
+        //same ordering as Flush, but the pass is drawn from the shared geometry buffer
+        //with multi-draw indirect, the submitted shaders must be the *_indirect variants
+        void FlushIndirect(RenderPass pass, gps::IndirectRenderer& indirectRenderer);
+        //statistics of the last flush of the pass
+        PassStats getStats(RenderPass pass);
+        //when set, Flush draws a layered command once per layer of its mask, for shaders that pick
+        //gl_Layer from gl_InstanceID; otherwise once, for geometry shaders with one invocation per layer
+        void setInstancedLayers(RenderPass pass, bool instanced);
+
+    private:
+        std::vector<RenderCommand> commands[PASS_COUNT];
+        PassStats stats[PASS_COUNT];
+        glm::mat4 views[PASS_COUNT];
+        float farPlanes[PASS_COUNT];
+        unsigned int culledCounts[PASS_COUNT];
+        bool instancedLayers[PASS_COUNT];
+        gps::StreamBuffer* streamBuffer;
+        //sizeof(DrawData) rounded up to the uniform buffer offset alignment
+        GLsizeiptr drawDataStride;
+
+        void sortCommands(RenderPass pass);
+        PassStats& beginStats(RenderPass pass);
+        static GLsizei layerCount(uint32_t layerMask);
+    };
+}
+
+#endif /* RenderQueue_hpp */
@@ -0,0 +1,174 @@
+#include "RenderTargetPool.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+    bool RenderTargetDesc::operator==(const RenderTargetDesc& other) const {
+        if (width != other.width || height != other.height || colorCount != other.colorCount || depthFormat != other.depthFormat) {
+            return false;
+        }
+        for (int i = 0; i < colorCount; i++) {
+            if (colorFormats[i] != other.colorFormats[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    RenderTargetPool::RenderTargetPool() {
+        frame = 0;
+        stats = RenderTargetPoolStats();
+        emptyVAO = 0;
+    }
+
+    RenderTargetPool::~RenderTargetPool() {
+        for (size_t i = 0; i < targets.size(); i++) {
+            deleteTarget(targets[i]);
+        }
+        if (emptyVAO != 0) {
+            glDeleteVertexArrays(1, &emptyVAO);
+        }
+    }
+
+    //pixel format and type glTexImage2D needs next to the internal format, no data is uploaded
+    static void transferFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+        switch (internalFormat) {
+            case GL_RG16_SNORM:
+                format = GL_RG;
+                type = GL_SHORT;
+                break;
+            case GL_RGBA16F:
+                format = GL_RGBA;
+                type = GL_HALF_FLOAT;
+                break;
+            case GL_DEPTH_COMPONENT24:
+            case GL_DEPTH_COMPONENT32F:
+                format = GL_DEPTH_COMPONENT;
+                type = GL_FLOAT;
+                break;
+            default:
+                format = GL_RGBA;
+                type = GL_UNSIGNED_BYTE;
+                break;
+        }
+    }
+
+    static GLuint createTexture(GLenum internalFormat, int width, int height) {
+        GLenum format, type;
+        transferFormat(internalFormat, format, type);
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        //linear for the upscale, the passes that need exact texels use texelFetch
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    RenderTarget* RenderTargetPool::createTarget(const RenderTargetDesc& desc) {
+        RenderTarget* target = new RenderTarget();
+        target->desc = desc;
+        target->depthTexture = 0;
+
+        glGenFramebuffers(1, &target->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+        GLenum drawBuffers[MAX_COLOR_TARGETS];
+        for (int i = 0; i < desc.colorCount; i++) {
+            target->colorTextures[i] = createTexture(desc.colorFormats[i], desc.width, desc.height);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, target->colorTextures[i], 0);
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        }
+        glDrawBuffers(desc.colorCount, drawBuffers);
+        if (desc.depthFormat != GL_NONE) {
+            target->depthTexture = createTexture(desc.depthFormat, desc.width, desc.height);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, target->depthTexture, 0);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "render target " << desc.width << "x" << desc.height << " is not complete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        stats.created++;
+        stats.memorySize += targetSize(desc);
+        return target;
+    }
+
+    void RenderTargetPool::deleteTarget(RenderTarget* target) {
+        glDeleteFramebuffers(1, &target->framebuffer);
+        glDeleteTextures(target->desc.colorCount, target->colorTextures);
+        if (target->depthTexture != 0) {
+            glDeleteTextures(1, &target->depthTexture);
+        }
+        stats.memorySize -= targetSize(target->desc);
+        delete target;
+    }
+
+    //every format the pool creates is 4 bytes per pixel except the half float one
+    GLsizeiptr RenderTargetPool::targetSize(const RenderTargetDesc& desc) {
+        GLsizeiptr pixelBytes = desc.depthFormat != GL_NONE ? 4 : 0;
+        for (int i = 0; i < desc.colorCount; i++) {
+            pixelBytes += desc.colorFormats[i] == GL_RGBA16F ? 8 : 4;
+        }
+        return (GLsizeiptr)desc.width * desc.height * pixelBytes;
+    }
+
+    RenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& desc) {
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (!targets[i]->inUse && targets[i]->desc == desc) {
+                targets[i]->inUse = true;
+                stats.reused++;
+                return targets[i];
+            }
+        }
+        RenderTarget* target = createTarget(desc);
+        target->inUse = true;
+        targets.push_back(target);
+        return target;
+    }
+
+    void RenderTargetPool::Release(RenderTarget* target) {
+        target->inUse = false;
+        target->lastUsedFrame = frame;
+    }
+
+    void RenderTargetPool::EndFrame(unsigned int maxIdleFrames) {
+        frame++;
+        size_t kept = 0;
+        for (size_t i = 0; i < targets.size(); i++) {
+            RenderTarget* target = targets[i];
+            if (!target->inUse && frame - target->lastUsedFrame > maxIdleFrames) {
+                deleteTarget(target);
+                stats.deleted++;
+                continue;
+            }
+            targets[kept++] = target;
+        }
+        targets.resize(kept);
+    }
+
+    void RenderTargetPool::DrawFullscreen() {
+        if (emptyVAO == 0) {
+            glGenVertexArrays(1, &emptyVAO);
+        }
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+
+    RenderTargetPoolStats RenderTargetPool::getStats() {
+        RenderTargetPoolStats current = stats;
+        current.targets = (unsigned int)targets.size();
+        current.inUse = 0;
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (targets[i]->inUse) {
+                current.inUse++;
+            }
+        }
+        return current;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef RenderTargetPool_hpp
+#define RenderTargetPool_hpp
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace gps {
+
+    const int MAX_COLOR_TARGETS = 2;
+
+    //size and formats of a framebuffer, GL_NONE for a missing depth attachment
+    struct RenderTargetDesc
+    {
+        int width;
+        int height;
+        GLenum colorFormats[MAX_COLOR_TARGETS];
+        int colorCount;
+        GLenum depthFormat;
+
+        bool operator==(const RenderTargetDesc& other) const;
+    };
+
+    //framebuffer with its attachments, textures so the next pass can read them
+    struct RenderTarget
+    {
+        RenderTargetDesc desc;
+        GLuint framebuffer;
+        GLuint colorTextures[MAX_COLOR_TARGETS];
+        GLuint depthTexture;
+        bool inUse;
+        //frame of the pool the target was last released on
+        unsigned int lastUsedFrame;
+    };
+
+    struct RenderTargetPoolStats
+    {
+        unsigned int targets;
+        unsigned int inUse;
+        //Acquire calls that created a target, and the ones a free target answered
+        unsigned int created;
+        unsigned int reused;
+        unsigned int deleted;
+        GLsizeiptr memorySize;
+    };
+
+    //framebuffers handed out by size and format and taken back when a pass no longer needs them
+    //a size the dynamic resolution or a window resize comes back to finds its targets still allocated,
+    //free targets unused for a while are deleted by EndFrame
+    class RenderTargetPool
+    {
+    public:
+        RenderTargetPool();
+        ~RenderTargetPool();
+        //a free target of the same size and formats, or a new one
+        RenderTarget* Acquire(const RenderTargetDesc& desc);
+        void Release(RenderTarget* target);
+        //deletes the free targets not acquired for maxIdleFrames frames
+        void EndFrame(unsigned int maxIdleFrames);
+        RenderTargetPoolStats getStats();
+        //one triangle over the bound target, the vertex shader places it from gl_VertexID (fullscreen.vert)
+        void DrawFullscreen();
+
+    private:
+        std::vector<RenderTarget*> targets;
+        //core contexts draw nothing without a vertex array, even one without attributes
+        GLuint emptyVAO;
+        unsigned int frame;
+        RenderTargetPoolStats stats;
+
+        RenderTarget* createTarget(const RenderTargetDesc& desc);
+        void deleteTarget(RenderTarget* target);
+        static GLsizeiptr targetSize(const RenderTargetDesc& desc);
+    };
+}
+
+#endif /* RenderTargetPool_hpp */
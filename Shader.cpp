@@ -22,6 +22,57 @@ namespace gps {
         return shaderString;
     }
 
+    std::string Shader::expandIncludes(std::string fileName, std::set<std::string>& included)
+    {
+        included.insert(fileName);
+        std::string directory = fileName.substr(0, fileName.find_last_of("/\\") + 1);
+
+        std::stringstream sourceStream(readShaderFile(fileName));
+        std::stringstream expanded;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(sourceStream, line)) {
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+                expanded << line << "\n";
+                continue;
+            }
+
+            size_t nameStart = line.find('"', start);
+            size_t nameEnd = nameStart == std::string::npos ? std::string::npos : line.find('"', nameStart + 1);
+            if (nameEnd == std::string::npos) {
+                std::cout << "Shader include error in " << fileName << ": " << line << std::endl;
+                continue;
+            }
+            std::string includeName = directory + line.substr(nameStart + 1, nameEnd - nameStart - 1);
+            if (included.count(includeName) == 0) {
+                //the compile log keeps the line numbers of the including file after the included text
+                expanded << "#line 1\n" << expandIncludes(includeName, included) << "#line " << lineNumber + 1 << "\n";
+            }
+        }
+        return expanded.str();
+    }
+
+    std::string Shader::addDefines(std::string source, const std::vector<std::string>& defines)
+    {
+        if (defines.empty()) {
+            return source;
+        }
+
+        //#version has to stay the first line
+        size_t versionEnd = source.find('\n');
+        if (versionEnd == std::string::npos) {
+            return source;
+        }
+        std::string defineLines;
+        for (size_t i = 0; i < defines.size(); i++) {
+            defineLines += "#define " + defines[i] + "\n";
+        }
+        defineLines += "#line 2\n";
+        return source.insert(versionEnd + 1, defineLines);
+    }
+
     void Shader::shaderCompileLog(GLuint shaderId)
     {
         GLint success;
@@ -49,34 +100,53 @@ namespace gps {
         }
     }
 
-    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName)
+    GLuint Shader::compileShader(std::string fileName, GLenum shaderType, const std::vector<std::string>& defines)
     {
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
-        const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
-
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
-        const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
+        //read, parse and compile the shader
+        std::set<std::string> included;
+        std::string source = addDefines(expandIncludes(fileName, included), defines);
+        const GLchar* shaderString = source.c_str();
+        GLuint shader;
+        shader = glCreateShader(shaderType);
+        glShaderSource(shader, 1, &shaderString, NULL);
+        glCompileShader(shader);
         //check compilation status
-        shaderCompileLog(fragmentShader);
+        shaderCompileLog(shader);
+        return shader;
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName,
+        const std::vector<std::string>& defines)
+    {
+        GLuint vertexShader = compileShader(vertexShaderFileName, GL_VERTEX_SHADER, defines);
+        GLuint fragmentShader = compileShader(fragmentShaderFileName, GL_FRAGMENT_SHADER, defines);
+
+        //attach and link the shader programs
+        this->shaderProgram = glCreateProgram();
+        glAttachShader(this->shaderProgram, vertexShader);
+        glAttachShader(this->shaderProgram, fragmentShader);
+        glLinkProgram(this->shaderProgram);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        //check linking info
+        shaderLinkLog(this->shaderProgram);
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string geometryShaderFileName, std::string fragmentShaderFileName,
+        const std::vector<std::string>& defines)
+    {
+        GLuint vertexShader = compileShader(vertexShaderFileName, GL_VERTEX_SHADER, defines);
+        GLuint geometryShader = compileShader(geometryShaderFileName, GL_GEOMETRY_SHADER, defines);
+        GLuint fragmentShader = compileShader(fragmentShaderFileName, GL_FRAGMENT_SHADER, defines);
 
         //attach and link the shader programs
         this->shaderProgram = glCreateProgram();
         glAttachShader(this->shaderProgram, vertexShader);
+        glAttachShader(this->shaderProgram, geometryShader);
         glAttachShader(this->shaderProgram, fragmentShader);
         glLinkProgram(this->shaderProgram);
         glDeleteShader(vertexShader);
+        glDeleteShader(geometryShader);
         glDeleteShader(fragmentShader);
         //check linking info
         shaderLinkLog(this->shaderProgram);
@@ -8,6 +8,8 @@
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <set>
 
 namespace gps {
 
@@ -15,11 +17,20 @@ class Shader
 {
 public:
     GLuint shaderProgram;
-    void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+    //each define is added as #define after the #version line, e.g. "FOG" or "SHADOW_QUALITY 2"
+    void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName,
+        const std::vector<std::string>& defines = std::vector<std::string>());
+    //same, with a geometry shader between the two stages
+    void loadShader(std::string vertexShaderFileName, std::string geometryShaderFileName, std::string fragmentShaderFileName,
+        const std::vector<std::string>& defines = std::vector<std::string>());
     void useShaderProgram();
 
 private:
     std::string readShaderFile(std::string fileName);
+    //replaces the #include "file" lines with the file, found next to the including one; a file is included once
+    std::string expandIncludes(std::string fileName, std::set<std::string>& included);
+    std::string addDefines(std::string source, const std::vector<std::string>& defines);
+    GLuint compileShader(std::string fileName, GLenum shaderType, const std::vector<std::string>& defines);
     void shaderCompileLog(GLuint shaderId);
     void shaderLinkLog(GLuint shaderProgramId);
 };
@@ -0,0 +1,65 @@
+#include "ShaderPermutations.hpp"
+
+namespace gps {
+
+    const char* FEATURE_DEFINES[SHADER_FEATURE_COUNT] = { "FOG", "POINT_LIGHT", "SHADOWS" };
+
+    ShaderPermutations::ShaderPermutations() {
+        variants.resize((1 << SHADER_FEATURE_COUNT) * SHADER_QUALITY_LEVELS);
+        compiled.assign(variants.size(), false);
+    }
+
+    ShaderPermutations::~ShaderPermutations() {
+        for (size_t i = 0; i < variants.size(); i++) {
+            if (compiled[i]) {
+                glDeleteProgram(variants[i].shaderProgram);
+            }
+        }
+    }
+
+    void ShaderPermutations::Init(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+        this->vertexShaderFileName = vertexShaderFileName;
+        this->fragmentShaderFileName = fragmentShaderFileName;
+    }
+
+    //the quality only changes the shadow filter, so the variants without shadows all share quality 0
+    int ShaderPermutations::variantIndex(uint32_t features, int quality) {
+        if (!(features & SHADER_SHADOWS)) {
+            quality = 0;
+        }
+        return quality * (1 << SHADER_FEATURE_COUNT) + (int)(features & SHADER_ALL_FEATURES);
+    }
+
+    std::vector<std::string> ShaderPermutations::definesFor(uint32_t features, int quality) {
+        std::vector<std::string> defines;
+        for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+            if (features & (1u << i)) {
+                defines.push_back(FEATURE_DEFINES[i]);
+            }
+        }
+        defines.push_back("SHADOW_QUALITY " + std::to_string(quality));
+        return defines;
+    }
+
+    gps::Shader ShaderPermutations::getShader(uint32_t features, int quality) {
+        int index = variantIndex(features, quality);
+        if (!compiled[index]) {
+            int variantQuality = index / (1 << SHADER_FEATURE_COUNT);
+            variants[index].loadShader(vertexShaderFileName, fragmentShaderFileName, definesFor(features, variantQuality));
+            compiled[index] = true;
+        }
+        return variants[index];
+    }
+
+    bool ShaderPermutations::isCompiled(uint32_t features, int quality) {
+        return compiled[variantIndex(features, quality)];
+    }
+
+    int ShaderPermutations::getCompiledCount() {
+        int count = 0;
+        for (size_t i = 0; i < compiled.size(); i++) {
+            count += compiled[i] ? 1 : 0;
+        }
+        return count;
+    }
+}
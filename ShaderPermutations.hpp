@@ -0,0 +1,48 @@
+#ifndef ShaderPermutations_hpp
+#define ShaderPermutations_hpp
+
+#include "Shader.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    //optional parts of the scene shader, each one compiles in with a #define of the same name
+    enum ShaderFeature
+    {
+        SHADER_FOG = 1 << 0,
+        SHADER_POINT_LIGHT = 1 << 1,
+        SHADER_SHADOWS = 1 << 2,
+    };
+    const int SHADER_FEATURE_COUNT = 3;
+    const uint32_t SHADER_ALL_FEATURES = (1u << SHADER_FEATURE_COUNT) - 1;
+    //SHADOW_QUALITY define, 0 takes one shadow map tap, 1 a 2x2 and 2 a 3x3 filter
+    const int SHADER_QUALITY_LEVELS = 3;
+
+    //every combination of features and quality of a vertex and fragment shader pair
+    //a variant is compiled the first time it is asked for and kept, so switching back is free
+    //and a variant without a feature does none of its work per fragment
+    class ShaderPermutations
+    {
+    public:
+        ShaderPermutations();
+        ~ShaderPermutations();
+        void Init(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        gps::Shader getShader(uint32_t features, int quality);
+        bool isCompiled(uint32_t features, int quality);
+        int getCompiledCount();
+
+    private:
+        std::string vertexShaderFileName;
+        std::string fragmentShaderFileName;
+        std::vector<gps::Shader> variants;
+        std::vector<bool> compiled;
+
+        static int variantIndex(uint32_t features, int quality);
+        static std::vector<std::string> definesFor(uint32_t features, int quality);
+    };
+}
+
+#endif /* ShaderPermutations_hpp */
@@ -0,0 +1,69 @@
+#include "ShadowCasterCuller.hpp"
+
+namespace gps {
+
+    ShadowCasterCuller::ShadowCasterCuller() {
+        lightView = glm::mat4(1.0f);
+        receiverBounds = EmptyBox();
+        stats = ShadowCullStats();
+    }
+
+    void ShadowCasterCuller::setLight(const glm::mat4& view, const glm::mat4& projection) {
+        lightView = view;
+        lightFrustum.Extract(projection * view);
+        lightFrustum.RemovePlane(PLANE_NEAR);
+    }
+
+    void ShadowCasterCuller::setReceivers(gps::Bvh& bvh, const std::vector<uint32_t>& receivers) {
+        receiverBoxes.clear();
+        receiverBounds = EmptyBox();
+        for (size_t i = 0; i < receivers.size(); i++) {
+            BoundingBox box = TransformBox(bvh.getPrimitiveBounds(receivers[i]), lightView);
+            receiverBoxes.push_back(box);
+            receiverBounds = MergeBoxes(receiverBounds, box);
+        }
+    }
+
+    //light space looks down -z, so the shadow of a box covers its xy footprint from its nearest
+    //point to the light, max.z, to infinity along -z
+    bool ShadowCasterCuller::reachesReceiver(const BoundingBox& casterBox, const BoundingBox& receiverBox) {
+        return casterBox.min.x <= receiverBox.max.x && casterBox.max.x >= receiverBox.min.x &&
+            casterBox.min.y <= receiverBox.max.y && casterBox.max.y >= receiverBox.min.y &&
+            casterBox.max.z >= receiverBox.min.z;
+    }
+
+    void ShadowCasterCuller::Cull(gps::Bvh& bvh, std::vector<uint32_t>& casters) {
+        stats = ShadowCullStats();
+        stats.receivers = (unsigned int)receiverBoxes.size();
+
+        candidates.clear();
+        bvh.QueryFrustum(lightFrustum, candidates);
+        stats.candidates = (unsigned int)candidates.size();
+        stats.outsideLight = (unsigned int)(bvh.getPrimitiveCount() - candidates.size());
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            BoundingBox casterBox = TransformBox(bvh.getPrimitiveBounds(candidates[i]), lightView);
+            bool castsOnReceiver = false;
+            if (reachesReceiver(casterBox, receiverBounds)) {
+                for (size_t r = 0; r < receiverBoxes.size() && !castsOnReceiver; r++) {
+                    castsOnReceiver = reachesReceiver(casterBox, receiverBoxes[r]);
+                }
+            }
+            if (castsOnReceiver) {
+                casters.push_back(candidates[i]);
+                stats.casters++;
+            }
+            else {
+                stats.noReceiver++;
+            }
+        }
+    }
+
+    const gps::Frustum& ShadowCasterCuller::getFrustum() {
+        return lightFrustum;
+    }
+
+    ShadowCullStats ShadowCasterCuller::getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef ShadowCasterCuller_hpp
+#define ShadowCasterCuller_hpp
+
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+#include "Bvh.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    struct ShadowCullStats
+    {
+        unsigned int receivers;
+        unsigned int candidates;
+        unsigned int outsideLight;
+        unsigned int noReceiver;
+        unsigned int casters;
+    };
+
+    //selects the shadow casters of a directional light
+    //a caster must be inside the light frustum extended toward the light, and its light space footprint,
+    //swept away from the light, must reach the box of a receiver the camera sees
+    class ShadowCasterCuller
+    {
+    public:
+        ShadowCasterCuller();
+        //the near plane is dropped, casters in front of it must be drawn with GL_DEPTH_CLAMP
+        void setLight(const glm::mat4& lightView, const glm::mat4& lightProjection);
+        //light space boxes of the bvh primitives that are receivers
+        void setReceivers(gps::Bvh& bvh, const std::vector<uint32_t>& receivers);
+        //appends the bvh primitives that can cast a shadow on a receiver
+        void Cull(gps::Bvh& bvh, std::vector<uint32_t>& casters);
+        const gps::Frustum& getFrustum();
+        ShadowCullStats getStats();
+
+    private:
+        glm::mat4 lightView;
+        gps::Frustum lightFrustum;
+        std::vector<BoundingBox> receiverBoxes;
+        //union of the receiver boxes, rejects most casters before the per receiver tests
+        BoundingBox receiverBounds;
+        std::vector<uint32_t> candidates;
+        ShadowCullStats stats;
+
+        bool reachesReceiver(const BoundingBox& casterBox, const BoundingBox& receiverBox);
+    };
+}
+
+#endif /* ShadowCasterCuller_hpp */
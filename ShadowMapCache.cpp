@@ -0,0 +1,91 @@
+#include "ShadowMapCache.hpp"
+
+namespace gps {
+
+    ShadowMapCache::ShadowMapCache() {
+        cacheFBO = 0;
+        cacheTexture = 0;
+        width = 0;
+        height = 0;
+        stats = ShadowCacheStats();
+    }
+
+    ShadowMapCache::~ShadowMapCache() {
+        if (cacheFBO != 0) {
+            glDeleteFramebuffers(1, &cacheFBO);
+            glDeleteTextures(1, &cacheTexture);
+        }
+    }
+
+    void ShadowMapCache::Init(GLsizei mapWidth, GLsizei mapHeight, int layers) {
+        if (cacheFBO != 0) {
+            glDeleteFramebuffers(1, &cacheFBO);
+            glDeleteTextures(1, &cacheTexture);
+        }
+        width = mapWidth;
+        height = mapHeight;
+
+        //only read through the blit, so no filtering or border state is needed
+        glGenTextures(1, &cacheTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, cacheTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, layers, 0,
+            GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &cacheFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        cachedLightSpaces.assign(layers, glm::mat4(1.0f));
+        validLayers.assign(layers, false);
+        rebuiltLayers.assign(layers, false);
+    }
+
+    bool ShadowMapCache::needsUpdate(int layer, const glm::mat4& lightSpaceTrMatrix) {
+        return !validLayers[layer] || lightSpaceTrMatrix != cachedLightSpaces[layer];
+    }
+
+    void ShadowMapCache::Invalidate() {
+        validLayers.assign(validLayers.size(), false);
+    }
+
+    void ShadowMapCache::BeginUpdate(int layer, const glm::mat4& lightSpaceTrMatrix) {
+        cachedLightSpaces[layer] = lightSpaceTrMatrix;
+        glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, layer);
+        glViewport(0, 0, width, height);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void ShadowMapCache::EndUpdate(int layer) {
+        validLayers[layer] = true;
+        rebuiltLayers[layer] = true;
+        stats.rebuilds++;
+        stats.rebuiltThisFrame++;
+    }
+
+    void ShadowMapCache::CopyTo(int layer, GLuint framebuffer) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, cacheFBO);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, layer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if (!rebuiltLayers[layer]) {
+            stats.cachedLayers++;
+        }
+    }
+
+    void ShadowMapCache::BeginFrame() {
+        rebuiltLayers.assign(rebuiltLayers.size(), false);
+        stats.rebuiltThisFrame = 0;
+    }
+
+    ShadowCacheStats ShadowMapCache::getStats() {
+        return stats;
+    }
+}
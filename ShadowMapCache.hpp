@@ -0,0 +1,55 @@
+#ifndef ShadowMapCache_hpp
+#define ShadowMapCache_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    struct ShadowCacheStats
+    {
+        //renders of the static casters into a layer since Init
+        unsigned int rebuilds;
+        //layers the working map started from the cache without a rebuild
+        unsigned int cachedLayers;
+        unsigned int rebuiltThisFrame;
+    };
+
+    //depth of the static shadow casters, rendered once into its own texture array and copied into
+    //the working shadow map every frame, so only the moving casters are drawn each frame
+    //a layer is rendered again when its light matrix changes or the static geometry is invalidated
+    class ShadowMapCache
+    {
+    public:
+        ShadowMapCache();
+        ~ShadowMapCache();
+        //the working shadow map must have the same size and a GL_DEPTH_COMPONENT24 format to be blitted into
+        void Init(GLsizei width, GLsizei height, int layers);
+        //true when the layer was rendered with another light matrix or the static geometry changed
+        bool needsUpdate(int layer, const glm::mat4& lightSpaceTrMatrix);
+        //a static caster moved, was added or removed
+        void Invalidate();
+        //binds and clears the layer, the static casters are drawn between the two calls
+        void BeginUpdate(int layer, const glm::mat4& lightSpaceTrMatrix);
+        void EndUpdate(int layer);
+        //copies the cached layer into the depth attachment of the framebuffer and leaves it bound
+        void CopyTo(int layer, GLuint framebuffer);
+        //starts the per frame counters
+        void BeginFrame();
+        ShadowCacheStats getStats();
+
+    private:
+        GLuint cacheFBO;
+        GLuint cacheTexture;
+        GLsizei width;
+        GLsizei height;
+        std::vector<glm::mat4> cachedLightSpaces;
+        std::vector<bool> validLayers;
+        std::vector<bool> rebuiltLayers;
+        ShadowCacheStats stats;
+    };
+}
+
+#endif /* ShadowMapCache_hpp */
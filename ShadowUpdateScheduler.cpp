@@ -0,0 +1,113 @@
+#include "ShadowUpdateScheduler.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    ShadowUpdateScheduler::ShadowUpdateScheduler() {
+        budget = 2.0f;
+        enabled = true;
+        stats = ShadowScheduleStats();
+    }
+
+    void ShadowUpdateScheduler::setViewCount(int count) {
+        ShadowView view;
+        view.interval = 1;
+        view.framesSinceUpdate = 0;
+        view.isStatic = false;
+        view.invalid = true;
+        view.update = false;
+        view.cost = 0.0f;
+        views.assign(count, view);
+    }
+
+    void ShadowUpdateScheduler::setInterval(int view, int frames) {
+        views[view].interval = std::max(frames, 1);
+    }
+
+    void ShadowUpdateScheduler::setStatic(int view, bool isStatic) {
+        views[view].isStatic = isStatic;
+    }
+
+    void ShadowUpdateScheduler::Invalidate(int view) {
+        views[view].invalid = true;
+    }
+
+    void ShadowUpdateScheduler::InvalidateAll() {
+        for (size_t i = 0; i < views.size(); i++) {
+            views[i].invalid = true;
+        }
+    }
+
+    void ShadowUpdateScheduler::setBudget(float milliseconds) {
+        budget = milliseconds;
+    }
+
+    void ShadowUpdateScheduler::setEnabled(bool schedulerEnabled) {
+        enabled = schedulerEnabled;
+    }
+
+    bool ShadowUpdateScheduler::isEnabled() {
+        return enabled;
+    }
+
+    void ShadowUpdateScheduler::BeginFrame() {
+        float totalSaved = stats.totalSavedMilliseconds;
+        stats = ShadowScheduleStats();
+        stats.totalSavedMilliseconds = totalSaved;
+        stats.views = (unsigned int)views.size();
+
+        dueViews.clear();
+        for (size_t i = 0; i < views.size(); i++) {
+            ShadowView& view = views[i];
+            view.framesSinceUpdate++;
+            view.update = false;
+            bool due = !enabled || view.invalid || (!view.isStatic && view.framesSinceUpdate >= view.interval);
+            if (due) {
+                dueViews.push_back((int)i);
+            }
+        }
+        stats.due = (unsigned int)dueViews.size();
+
+        //invalid views first, then the ones most late relative to their interval
+        std::stable_sort(dueViews.begin(), dueViews.end(), [this](int a, int b) {
+            if (views[a].invalid != views[b].invalid) {
+                return views[a].invalid;
+            }
+            return views[a].framesSinceUpdate * views[b].interval > views[b].framesSinceUpdate * views[a].interval;
+        });
+
+        for (size_t i = 0; i < dueViews.size(); i++) {
+            ShadowView& view = views[dueViews[i]];
+            if (enabled && i > 0 && stats.spentMilliseconds + view.cost > budget) {
+                stats.postponed++;
+                continue;
+            }
+            //the first update after an invalidation sets the phase, view i lands i frames later in its interval
+            view.framesSinceUpdate = view.invalid ? -(dueViews[i] % view.interval) : 0;
+            view.invalid = false;
+            view.update = true;
+            stats.updated++;
+            stats.spentMilliseconds += view.cost;
+        }
+
+        for (size_t i = 0; i < views.size(); i++) {
+            if (!views[i].update) {
+                stats.savedMilliseconds += views[i].cost;
+            }
+        }
+        stats.totalSavedMilliseconds += stats.savedMilliseconds;
+    }
+
+    bool ShadowUpdateScheduler::shouldUpdate(int view) {
+        return views[view].update;
+    }
+
+    void ShadowUpdateScheduler::setViewCost(int view, float milliseconds) {
+        views[view].cost = milliseconds;
+    }
+
+    ShadowScheduleStats ShadowUpdateScheduler::getStats() {
+        return stats;
+    }
+}
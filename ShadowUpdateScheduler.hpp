@@ -0,0 +1,67 @@
+#ifndef ShadowUpdateScheduler_hpp
+#define ShadowUpdateScheduler_hpp
+
+#include <vector>
+
+namespace gps {
+
+    struct ShadowScheduleStats
+    {
+        unsigned int views;
+        unsigned int due;
+        unsigned int updated;
+        //due views left for a later frame by the budget
+        unsigned int postponed;
+        //gpu time of the views updated this frame, and of the ones that were not, from their last measured update
+        float spentMilliseconds;
+        float savedMilliseconds;
+        float totalSavedMilliseconds;
+    };
+
+    //decides which shadow views are rendered each frame
+    //a view is due every interval frames, staggered by its index, or right after Invalidate;
+    //a static view is only due after Invalidate. due views are taken invalid first, then by how late
+    //they are, until their measured gpu cost reaches the frame budget
+    class ShadowUpdateScheduler
+    {
+    public:
+        ShadowUpdateScheduler();
+        //every view starts invalid with an interval of 1
+        void setViewCount(int count);
+        //1 updates the view every frame, N every N frames
+        void setInterval(int view, int frames);
+        void setStatic(int view, bool isStatic);
+        void Invalidate(int view);
+        void InvalidateAll();
+        //gpu milliseconds the updates of a frame may take, the most urgent due view is always updated
+        void setBudget(float milliseconds);
+        //when disabled every view is updated every frame
+        void setEnabled(bool enabled);
+        bool isEnabled();
+        //picks the views updated this frame
+        void BeginFrame();
+        bool shouldUpdate(int view);
+        //measured gpu time of the last update of the view
+        void setViewCost(int view, float milliseconds);
+        ShadowScheduleStats getStats();
+
+    private:
+        struct ShadowView
+        {
+            int interval;
+            int framesSinceUpdate;
+            bool isStatic;
+            bool invalid;
+            bool update;
+            float cost;
+        };
+
+        std::vector<ShadowView> views;
+        std::vector<int> dueViews;
+        float budget;
+        bool enabled;
+        ShadowScheduleStats stats;
+    };
+}
+
+#endif /* ShadowUpdateScheduler_hpp */
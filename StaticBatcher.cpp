@@ -0,0 +1,140 @@
+#include "StaticBatcher.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace gps {
+
+    StaticBatcher::StaticBatcher() {
+        stats = StaticBatchStats();
+    }
+
+    StaticBatcher::~StaticBatcher() {
+        for (size_t i = 0; i < meshes.size(); i++) {
+            Buffers buffers = meshes[i].getBuffers();
+            glDeleteBuffers(1, &buffers.VBO);
+            glDeleteBuffers(1, &buffers.EBO);
+            glDeleteVertexArrays(1, &buffers.VAO);
+        }
+    }
+
+    void StaticBatcher::Add(gps::Model3D& model3D, const glm::mat4& model) {
+        std::vector<gps::Mesh>& modelMeshes = model3D.getMeshes();
+        for (size_t i = 0; i < modelMeshes.size(); i++) {
+            Source source;
+            source.mesh = &modelMeshes[i];
+            source.model = model;
+            sources.push_back(source);
+        }
+    }
+
+    void StaticBatcher::Build(float chunkSize, float occluderMinSize) {
+        //triangles of a batch, gathered before any mesh is created
+        struct Batch
+        {
+            std::vector<gps::Vertex> vertices;
+            std::vector<GLuint> indices;
+            //batch vertex of every source vertex already in the batch, by source and index in its vertices
+            std::map<std::pair<size_t, GLuint>, GLuint> vertexIndices;
+            std::vector<gps::Texture> textures;
+            GLuint materialId;
+            bool occluder;
+        };
+        //ordered by material first, so the batches of one material follow each other
+        std::map<std::tuple<GLuint, bool, int, int>, size_t> batchIndices;
+        std::vector<Batch> batches;
+        std::set<std::pair<int, int> > chunks;
+        std::set<GLuint> materials;
+
+        for (size_t s = 0; s < sources.size(); s++) {
+            const gps::Mesh& mesh = *sources[s].mesh;
+            const std::vector<gps::Vertex>& meshVertices = *mesh.vertices;
+            const glm::mat4& model = sources[s].model;
+            glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(model));
+            gps::BoundingBox worldBounds = gps::TransformBox(mesh.bounds, model);
+            bool occluder = glm::length(worldBounds.max - worldBounds.min) >= occluderMinSize;
+
+            //each vertex is moved to world space once, however many triangles and batches use it
+            std::vector<gps::Vertex> worldVertices(meshVertices.size());
+            std::vector<bool> transformed(meshVertices.size(), false);
+
+            for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+                glm::vec3 centroid = glm::vec3(0.0f);
+                for (int c = 0; c < 3; c++) {
+                    GLuint index = mesh.indices[t + c];
+                    if (!transformed[index]) {
+                        worldVertices[index] = meshVertices[index];
+                        worldVertices[index].Position = glm::vec3(model * glm::vec4(meshVertices[index].Position, 1.0f));
+                        worldVertices[index].Normal = glm::normalize(normalMatrix * meshVertices[index].Normal);
+                        transformed[index] = true;
+                    }
+                    centroid += worldVertices[index].Position;
+                }
+                centroid /= 3.0f;
+
+                int chunkX = (int)std::floor(centroid.x / chunkSize);
+                int chunkZ = (int)std::floor(centroid.z / chunkSize);
+                std::tuple<GLuint, bool, int, int> key = std::make_tuple(mesh.materialId, occluder, chunkX, chunkZ);
+                std::map<std::tuple<GLuint, bool, int, int>, size_t>::iterator found = batchIndices.find(key);
+                if (found == batchIndices.end()) {
+                    Batch batch;
+                    batch.textures = mesh.textures;
+                    batch.materialId = mesh.materialId;
+                    batch.occluder = occluder;
+                    found = batchIndices.insert(std::make_pair(key, batches.size())).first;
+                    batches.push_back(batch);
+                    chunks.insert(std::make_pair(chunkX, chunkZ));
+                    materials.insert(mesh.materialId);
+                }
+
+                //the corners shared with triangles already in the batch are indexed again, not copied
+                Batch& batch = batches[found->second];
+                for (int c = 0; c < 3; c++) {
+                    GLuint index = mesh.indices[t + c];
+                    std::pair<std::map<std::pair<size_t, GLuint>, GLuint>::iterator, bool> inserted =
+                        batch.vertexIndices.insert(std::make_pair(std::make_pair(s, index), (GLuint)batch.vertices.size()));
+                    if (inserted.second) {
+                        batch.vertices.push_back(worldVertices[index]);
+                    }
+                    batch.indices.push_back(inserted.first->second);
+                }
+            }
+        }
+
+        //the mesh constructor uploads the buffers, the vector is sized first so the meshes are not copied around
+        meshes.reserve(batches.size());
+        for (std::map<std::tuple<GLuint, bool, int, int>, size_t>::iterator it = batchIndices.begin(); it != batchIndices.end(); ++it) {
+            Batch& batch = batches[it->second];
+            meshes.push_back(gps::Mesh(batch.vertices, batch.indices, batch.textures));
+            meshes.back().materialId = batch.materialId;
+            occluders.push_back(batch.occluder);
+            stats.triangles += (unsigned int)(batch.indices.size() / 3);
+            stats.vertices += (unsigned int)batch.vertices.size();
+            if (batch.occluder) {
+                stats.occluders++;
+            }
+        }
+
+        stats.sourceMeshes = (unsigned int)sources.size();
+        stats.batches = (unsigned int)meshes.size();
+        stats.materials = (unsigned int)materials.size();
+        stats.chunks = (unsigned int)chunks.size();
+        sources.clear();
+    }
+
+    std::vector<gps::Mesh>& StaticBatcher::getMeshes() {
+        return meshes;
+    }
+
+    bool StaticBatcher::isOccluder(size_t batch) {
+        return occluders[batch];
+    }
+
+    StaticBatchStats StaticBatcher::getStats() {
+        return stats;
+    }
+}
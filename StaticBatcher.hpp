@@ -0,0 +1,60 @@
+#ifndef StaticBatcher_hpp
+#define StaticBatcher_hpp
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "Model3D.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    struct StaticBatchStats
+    {
+        unsigned int sourceMeshes;
+        unsigned int batches;
+        unsigned int materials;
+        unsigned int chunks;
+        unsigned int triangles;
+        unsigned int vertices;
+        unsigned int occluders;
+    };
+
+    //merges the meshes of the models that never move into one mesh per material and chunk
+    //the vertices are transformed to world space at build time, so the batches are drawn with an identity model
+    //every triangle goes to the chunk of a square grid on the ground its centroid is in, so the batches
+    //stay small enough for the frustum, bvh and occlusion culling to reject the ones out of sight
+    //the triangles of large meshes get batches of their own, which occlude; the others stay occludees
+    class StaticBatcher
+    {
+    public:
+        StaticBatcher();
+        ~StaticBatcher();
+        //queues the meshes of the model, placed in the world by the model matrix
+        void Add(gps::Model3D& model3D, const glm::mat4& model);
+        //builds the batches from the queued meshes, chunkSize is the side of a grid cell in world units
+        //and the meshes whose world box has a diagonal of at least occluderMinSize go to the occluder batches
+        void Build(float chunkSize, float occluderMinSize);
+        std::vector<gps::Mesh>& getMeshes();
+        //whether the batch holds only triangles of large meshes
+        bool isOccluder(size_t batch);
+        StaticBatchStats getStats();
+
+    private:
+        struct Source
+        {
+            gps::Mesh* mesh;
+            glm::mat4 model;
+        };
+
+        std::vector<Source> sources;
+        std::vector<gps::Mesh> meshes;
+        std::vector<bool> occluders;
+        StaticBatchStats stats;
+    };
+}
+
+#endif /* StaticBatcher_hpp */
@@ -0,0 +1,181 @@
+#include "StreamBuffer.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+
+namespace gps {
+
+    //glClientWaitSync timeout of one try, the wait goes on until the fence signals
+    const GLuint64 FENCE_TIMEOUT_NANOSECONDS = 100000000;
+    //region sizes are kept a multiple of the largest offset alignment drivers ask for
+    const GLsizeiptr REGION_GRANULARITY = 256;
+
+    StreamBuffer::StreamBuffer() {
+        buffer = 0;
+        persistent = false;
+        regionSize = 0;
+        mapped = NULL;
+        for (int i = 0; i < STREAM_REGIONS; i++) {
+            fences[i] = 0;
+        }
+        region = 0;
+        head = 0;
+        flushed = 0;
+        frameBytes = 0;
+        frameAllocations = 0;
+        frames = 0;
+        totalBytes = 0.0;
+        stats = StreamBufferStats();
+    }
+
+    StreamBuffer::~StreamBuffer() {
+        deleteStorage();
+    }
+
+    void StreamBuffer::Init(GLsizeiptr size) {
+        persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+        regionSize = (size + REGION_GRANULARITY - 1) / REGION_GRANULARITY * REGION_GRANULARITY;
+        allocateStorage();
+    }
+
+    bool StreamBuffer::isInitialized() {
+        return buffer != 0;
+    }
+
+    bool StreamBuffer::isPersistent() {
+        return persistent;
+    }
+
+    GLuint StreamBuffer::getBuffer() {
+        return buffer;
+    }
+
+    void StreamBuffer::allocateStorage() {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * STREAM_REGIONS, NULL, flags);
+            mapped = (GLubyte*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * STREAM_REGIONS, flags);
+        }
+        else {
+            glBufferData(GL_COPY_WRITE_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+            staging.resize(regionSize);
+            mapped = staging.data();
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        region = 0;
+        head = 0;
+        flushed = 0;
+    }
+
+    //the gpu keeps the storage of a deleted buffer until the draws already issued with it are done
+    void StreamBuffer::deleteStorage() {
+        for (int i = 0; i < STREAM_REGIONS; i++) {
+            if (fences[i] != 0) {
+                glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+        }
+        if (buffer == 0) {
+            return;
+        }
+        if (persistent) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        mapped = NULL;
+    }
+
+    GLintptr StreamBuffer::regionStart() {
+        return (GLintptr)region * regionSize;
+    }
+
+    void StreamBuffer::BeginFrame() {
+        head = 0;
+        flushed = 0;
+        frameBytes = 0;
+        frameAllocations = 0;
+        if (!persistent) {
+            //orphaning hands the old storage to the draws in flight and gives the frame a new one
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            return;
+        }
+
+        region = (region + 1) % STREAM_REGIONS;
+        if (fences[region] == 0) {
+            return;
+        }
+        GLenum result = glClientWaitSync(fences[region], 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            double start = glfwGetTime();
+            while (result == GL_TIMEOUT_EXPIRED) {
+                result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NANOSECONDS);
+            }
+            stats.fenceWaits++;
+            stats.fenceWaitMilliseconds += (glfwGetTime() - start) * 1000.0;
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+
+    void StreamBuffer::grow(GLsizeiptr required) {
+        //the ranges already allocated this frame have to reach the old buffer before it is dropped
+        Flush();
+        deleteStorage();
+        regionSize = std::max(regionSize * 2, (required + REGION_GRANULARITY - 1) / REGION_GRANULARITY * REGION_GRANULARITY);
+        allocateStorage();
+        stats.grows++;
+    }
+
+    void* StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset) {
+        GLintptr start = (regionStart() + head + alignment - 1) / alignment * alignment;
+        if (start + size > regionStart() + regionSize) {
+            //the frame so far and this allocation, so the next frame fits in one region
+            grow(head + size + alignment);
+            start = regionStart();
+        }
+        offset = start;
+        head = start + size - regionStart();
+        frameBytes += size;
+        frameAllocations++;
+        //the cpu copy of the fallback is the single region
+        return mapped + start;
+    }
+
+    void StreamBuffer::Flush() {
+        //the persistent mapping is coherent, the writes reach the gpu without a call
+        if (persistent || head == flushed) {
+            return;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, flushed, head - flushed, staging.data() + flushed);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        flushed = head;
+    }
+
+    void StreamBuffer::EndFrame() {
+        if (persistent) {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        frames++;
+        totalBytes += (double)frameBytes;
+        stats.frameBytes = frameBytes;
+        stats.frameAllocations = frameAllocations;
+        stats.peakFrameBytes = std::max(stats.peakFrameBytes, frameBytes);
+        stats.averageFrameBytes = totalBytes / frames;
+    }
+
+    StreamBufferStats StreamBuffer::getStats() {
+        StreamBufferStats current = stats;
+        current.persistent = persistent;
+        current.regionSize = regionSize;
+        return current;
+    }
+}
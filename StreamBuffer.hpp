@@ -0,0 +1,82 @@
+#ifndef StreamBuffer_hpp
+#define StreamBuffer_hpp
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace gps {
+
+    //one region per frame the gpu may still be reading, the cpu writes the next one meanwhile
+    const int STREAM_REGIONS = 3;
+
+    struct StreamBufferStats
+    {
+        bool persistent;
+        GLsizeiptr regionSize;
+        //bytes written in the last frame, the most in one frame and the average since Init
+        GLsizeiptr frameBytes;
+        GLsizeiptr peakFrameBytes;
+        double averageFrameBytes;
+        unsigned int frameAllocations;
+        //BeginFrame calls that found the gpu still reading the region, and the time they waited
+        unsigned int fenceWaits;
+        double fenceWaitMilliseconds;
+        //times a frame did not fit and the regions were reallocated larger
+        unsigned int grows;
+    };
+
+    //ring buffer for the data the cpu writes every frame, read by the gpu as uniform, storage or indirect buffer
+    //with buffer storage (4.4 or ARB_buffer_storage) the buffer holds STREAM_REGIONS regions and stays
+    //mapped persistent and coherent, a fence per region keeps the cpu from writing one the gpu still reads;
+    //without it the buffer holds one region, orphaned every frame and uploaded from a cpu copy by Flush
+    class StreamBuffer
+    {
+    public:
+        StreamBuffer();
+        ~StreamBuffer();
+        void Init(GLsizeiptr regionSize);
+        bool isInitialized();
+        bool isPersistent();
+        //changes when the regions grow, bind it again after every Allocate
+        GLuint getBuffer();
+        //waits until the gpu is done with the next region and starts writing there
+        void BeginFrame();
+        //reserves size bytes at a multiple of alignment from the start of the buffer, returns where to write them
+        //and their offset; a frame that does not fit grows the regions, the ranges allocated before stay valid
+        //in the old buffer, so draws must bind getBuffer() after their own allocation
+        void* Allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+        //makes the bytes allocated since the last call visible to the gpu, call before the draws that read them
+        void Flush();
+        //fences the region of the frame
+        void EndFrame();
+        StreamBufferStats getStats();
+
+    private:
+        GLuint buffer;
+        bool persistent;
+        GLsizeiptr regionSize;
+        //persistent mapping of the whole buffer, or the cpu copy of the region
+        GLubyte* mapped;
+        std::vector<GLubyte> staging;
+        GLsync fences[STREAM_REGIONS];
+        int region;
+        //write position in the region, and how far Flush uploaded it
+        GLsizeiptr head;
+        GLsizeiptr flushed;
+
+        //counted during the frame, EndFrame moves them to the stats
+        GLsizeiptr frameBytes;
+        unsigned int frameAllocations;
+        unsigned int frames;
+        double totalBytes;
+        StreamBufferStats stats;
+
+        void allocateStorage();
+        void deleteStorage();
+        void grow(GLsizeiptr required);
+        GLintptr regionStart();
+    };
+}
+
+#endif /* StreamBuffer_hpp */
@@ -0,0 +1,50 @@
+#include "TransformCache.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace gps {
+
+    uint32_t TransformCache::Add(const glm::mat4& model) {
+        ObjectTransform transform;
+        transform.model = model;
+        transform.normalMatrix = glm::inverseTranspose(glm::mat3(model));
+        previous.push_back(model);
+        current.push_back(model);
+        frame.push_back(transform);
+        moved.push_back(0);
+        return (uint32_t)(frame.size() - 1);
+    }
+
+    size_t TransformCache::size() {
+        return frame.size();
+    }
+
+    void TransformCache::BeginStep() {
+        previous = current;
+    }
+
+    void TransformCache::setTransform(uint32_t object, const glm::mat4& model) {
+        current[object] = model;
+    }
+
+    void TransformCache::Interpolate(float alpha) {
+        for (size_t i = 0; i < frame.size(); i++) {
+            glm::mat4 model = current[i];
+            model[3] = glm::mix(previous[i][3], current[i][3], alpha);
+
+            moved[i] = model != frame[i].model;
+            if (moved[i]) {
+                frame[i].model = model;
+                frame[i].normalMatrix = glm::inverseTranspose(glm::mat3(model));
+            }
+        }
+    }
+
+    const ObjectTransform& TransformCache::get(uint32_t object) const {
+        return frame[object];
+    }
+
+    bool TransformCache::hasMoved(uint32_t object) const {
+        return moved[object] != 0;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef TransformCache_hpp
+#define TransformCache_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    //world matrices of an object for one frame, the normal matrix is the inverse transpose of the model's 3x3
+    struct ObjectTransform
+    {
+        glm::mat4 model;
+        glm::mat3 normalMatrix;
+    };
+
+    //transforms of the scene objects, written by the fixed step simulation and read by every pass
+    //each object keeps the transform of the previous and of the current step; Interpolate blends them
+    //into the transform of the frame and computes its normal matrix, once per frame for every pass
+    //the objects are rigid and only translate, so the translation is interpolated and the rotation
+    //and scale come from the current step
+    class TransformCache
+    {
+    public:
+        //a new object at rest at the transform, its index is used by the other calls
+        uint32_t Add(const glm::mat4& model);
+        size_t size();
+        //keeps the current transforms as the previous ones, call before a step sets the new ones
+        void BeginStep();
+        void setTransform(uint32_t object, const glm::mat4& model);
+        //the transforms of the frame, alpha of the way from the previous step to the current one
+        void Interpolate(float alpha);
+        const ObjectTransform& get(uint32_t object) const;
+        //the transform of the frame differs from the one of the frame before
+        bool hasMoved(uint32_t object) const;
+
+    private:
+        std::vector<glm::mat4> previous;
+        std::vector<glm::mat4> current;
+        std::vector<ObjectTransform> frame;
+        std::vector<uint8_t> moved;
+    };
+}
+
+#endif /* TransformCache_hpp */
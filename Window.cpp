@@ -2,30 +2,42 @@
 
 namespace gps {
 
-    void Window::Create(int width, int height, const char *title) {
+    void Window::Create(int width, int height, const char *title, bool visible) {
         if (!glfwInit()) {
             throw std::runtime_error("Could not start GLFW3!");
         }
 
-        //window hints
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        //ask for the newest context first, 4.3 enables the multi-draw indirect path
+        //and 4.1 is the minimum the shaders need
+        const ContextVersion requestedVersions[] = { {4, 6}, {4, 5}, {4, 3}, {4, 1} };
+        this->window = NULL;
+        for (const ContextVersion& requested : requestedVersions) {
+            //window hints
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, requested.major);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, requested.minor);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-        // for sRGB framebuffer
-        glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+            // for sRGB framebuffer
+            glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 
-        // for multisampling/antialising
-        glfwWindowHint(GLFW_SAMPLES, 4);
+            // for multisampling/antialising
+            glfwWindowHint(GLFW_SAMPLES, 4);
 
-        this->window = glfwCreateWindow(width, height, title, NULL, NULL);
+            glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+            this->window = glfwCreateWindow(width, height, title, NULL, NULL);
+            if (this->window) {
+                break;
+            }
+        }
         if (!this->window) {
             throw std::runtime_error("Could not create GLFW3 window!");
         }
 
         glfwMakeContextCurrent(window);
 
+        //vsync until the frame pacer sets the present mode
         glfwSwapInterval(1);
 
         // start GLEW extension handler
@@ -37,6 +49,8 @@ namespace gps {
         const GLubyte* version = glGetString(GL_VERSION); // version as a string
         std::cout << "Renderer: " << renderer << std::endl;
         std::cout << "OpenGL version: " << version << std::endl;
+        glGetIntegerv(GL_MAJOR_VERSION, &this->contextVersion.major);
+        glGetIntegerv(GL_MINOR_VERSION, &this->contextVersion.minor);
 
         //for RETINA display
         glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
@@ -60,4 +74,13 @@ namespace gps {
     void Window::setWindowDimensions(WindowDimensions dimensions) {
         this->dimensions = dimensions;
     }
+
+    ContextVersion Window::getContextVersion() {
+        return this->contextVersion;
+    }
+
+    bool Window::isContextAtLeast(int major, int minor) {
+        return this->contextVersion.major > major ||
+            (this->contextVersion.major == major && this->contextVersion.minor >= minor);
+    }
 }
\ No newline at end of file
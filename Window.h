@@ -11,20 +11,30 @@ struct WindowDimensions {
     int height;
 };
 
+struct ContextVersion {
+    int major;
+    int minor;
+};
+
 namespace gps {
 
     class Window {
 
     public:
-        void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        //a window that is not visible still has a context, for the headless benchmarks
+        void Create(int width=800, int height=600, const char *title="OpenGL Project", bool visible=true);
         void Delete();
 
         GLFWwindow* getWindow();
         WindowDimensions getWindowDimensions();
         void setWindowDimensions(WindowDimensions dimensions);
+        ContextVersion getContextVersion();
+        //true when the context is at least the requested version
+        bool isContextAtLeast(int major, int minor);
 
     private:
         WindowDimensions dimensions;
+        ContextVersion contextVersion;
         GLFWwindow *window;
     };
 }
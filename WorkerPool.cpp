@@ -0,0 +1,103 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    WorkerPool::WorkerPool() {
+        currentTask = NULL;
+        taskCount = 0;
+        nextTask = 0;
+        busyWorkers = 0;
+        generation = 0;
+        stopping = false;
+    }
+
+    WorkerPool::~WorkerPool() {
+        Stop();
+    }
+
+    void WorkerPool::Start(unsigned int threadCount) {
+        Stop();
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        stopping = false;
+        for (unsigned int i = 1; i < threadCount; i++) {
+            workers.push_back(std::thread(&WorkerPool::workerLoop, this, generation));
+        }
+    }
+
+    void WorkerPool::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+    }
+
+    unsigned int WorkerPool::getThreadCount() {
+        return (unsigned int)workers.size() + 1;
+    }
+
+    void WorkerPool::Run(unsigned int count, const std::function<void(unsigned int)>& task) {
+        if (workers.empty() || count <= 1) {
+            for (unsigned int i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentTask = &task;
+            taskCount = count;
+            nextTask = 0;
+            busyWorkers = (unsigned int)workers.size();
+            generation++;
+        }
+        wakeCondition.notify_all();
+
+        runTasks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this]() { return busyWorkers == 0; });
+        currentTask = NULL;
+    }
+
+    //startGeneration is the last task run before the worker existed, so none is missed or repeated
+    void WorkerPool::workerLoop(uint64_t startGeneration) {
+        uint64_t seenGeneration = startGeneration;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [this, seenGeneration]() { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+            }
+
+            runTasks();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busyWorkers--;
+            }
+            doneCondition.notify_one();
+        }
+    }
+
+    //every thread pulls indices until none are left
+    void WorkerPool::runTasks() {
+        unsigned int index;
+        while ((index = nextTask.fetch_add(1)) < taskCount) {
+            (*currentTask)(index);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef WorkerPool_hpp
+#define WorkerPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    //fixed set of threads that run the indices of a task in parallel
+    //the thread calling Run works on the task too and returns when every index is done
+    class WorkerPool
+    {
+    public:
+        WorkerPool();
+        ~WorkerPool();
+        //starts threadCount - 1 workers, 0 uses one thread per hardware thread
+        void Start(unsigned int threadCount);
+        void Stop();
+        //threads taking part in Run, the calling one included
+        unsigned int getThreadCount();
+        //calls task(i) for every i in [0, taskCount), in no particular order
+        void Run(unsigned int taskCount, const std::function<void(unsigned int)>& task);
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+        const std::function<void(unsigned int)>* currentTask;
+        unsigned int taskCount;
+        std::atomic<unsigned int> nextTask;
+        unsigned int busyWorkers;
+        uint64_t generation;
+        bool stopping;
+
+        void workerLoop(uint64_t startGeneration);
+        void runTasks();
+    };
+}
+
+#endif /* WorkerPool_hpp */
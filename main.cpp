@@ -12,7 +12,34 @@
 #include "Camera.hpp"
 #include "Model3D.hpp"
 #include "SkyBox.hpp"
-
+#include "RenderQueue.hpp"
+#include "GeometryBuffer.hpp"
+#include "IndirectRenderer.hpp"
+#include "Frustum.hpp"
+#include "Bvh.hpp"
+#include "Benchmark.hpp"
+#include "WorkerPool.hpp"
+#include "OcclusionCuller.hpp"
+#include "OcclusionQueries.hpp"
+#include "ShadowCasterCuller.hpp"
+#include "DepthPrepass.hpp"
+#include "ShadowMapCache.hpp"
+#include "CascadedShadowMap.hpp"
+#include "ShadowUpdateScheduler.hpp"
+#include "GpuTimer.hpp"
+#include "ShaderPermutations.hpp"
+#include "ClusteredLights.hpp"
+#include "GBuffer.hpp"
+#include "RenderTargetPool.hpp"
+#include "DynamicResolution.hpp"
+#include "FramePacer.hpp"
+#include "TransformCache.hpp"
+#include "StreamBuffer.hpp"
+#include "MaterialLibrary.hpp"
+#include "StaticBatcher.hpp"
+#include "ImpostorAtlas.hpp"
+
+#include <algorithm>
 #include <iostream>
 
 // window
@@ -23,13 +50,26 @@ glm::mat4 model;
 glm::mat4 view;
 glm::mat4 projection;
 glm::mat3 normalMatrix;
+//projection * view, the only matrix the main and depth prepass vertex shaders transform positions with
+glm::mat4 viewProjection;
+const GLfloat SCENE_NEAR_PLANE = 0.1f;
+const GLfloat SCENE_FAR_PLANE = 20.0f;
 
 // light parameters
 glm::vec3 lightDir;
 glm::vec3 lightColor;
 glm::vec3 lightPosition;
-glm::vec3 lightPosOn;
 bool withLight = false;
+//street lamps read from LAMPS_FILE, lit through a froxel grid so a fragment only pays for the lamps near it
+//without the file the scene keeps its one red lamp at lightPosition
+gps::ClusteredLights clusteredLights;
+const char* LAMPS_FILE = "models/light/lamps.txt";
+const int CLUSTER_TEXTURE_UNIT = 4;
+//the scene textures in arrays per size, sampled by the material id of the draw
+gps::MaterialLibrary materialLibrary;
+const int MATERIAL_TEXTURE_UNIT = 8;
+//N turns the cascaded shadows off, the scene shader is then compiled without the lookup
+bool withShadows = true;
 
 //fog density
 glm::vec3 fogDensity;
@@ -69,21 +109,198 @@ gps::Model3D screenQuad;
 
 // shaders
 gps::Shader myBasicShader;
+//the scene shader compiled per combination of fog, point light, shadows and shadow filter quality
+gps::ShaderPermutations basicShaderVariants;
 gps::Shader depthMapShader;
 gps::Shader screenQuadShader;
 
-//shadow
-GLuint shadowMapFBO;
-GLuint depthMapTexture;
+//shadow, cascades fitted to the camera frustum every frame, J cycles the quality tiers
+gps::CascadedShadowMap shadowCascades;
 bool showDepthMap;
-const unsigned int SHADOW_WIDTH = 2048;
-const unsigned int SHADOW_HEIGHT = 2048;
 bool startPres = false;
 
 //skybox
 gps::SkyBox mySkyBox;
 gps::Shader skyboxShader;
 
+//sorted submission of the shadow and main pass draws
+gps::RenderQueue renderQueue;
+//the per-draw data of every pass, written into a ring of frame regions instead of uniforms per draw
+gps::StreamBuffer drawStream;
+//a frame of the scene needs a few hundred kB with 256 byte uniform offsets, the regions grow when it needs more
+const GLsizeiptr DRAW_STREAM_REGION_SIZE = 1024 * 1024;
+//planes of projection * view, rebuilt every frame before the main pass
+gps::Frustum cameraFrustum;
+
+//every mesh of the main pass, indexed by a bvh built once after loading
+//the animated models move their entries and the bvh is refitted every frame
+//the scene model is drawn as the batches of staticBatches, one per material and chunk, the props mesh by mesh
+struct SceneDraw {
+    gps::Mesh* mesh;
+    //object of sceneTransforms the mesh moves with
+    uint32_t object;
+};
+std::vector<SceneDraw> sceneDraws;
+gps::Bvh sceneBvh;
+std::vector<uint32_t> visibleSceneDraws;
+//first scene draw of each animated model, its meshes follow it
+uint32_t tractorFirstDraw;
+uint32_t tractorOnRoadFirstDraw;
+uint32_t boatFirstDraw;
+
+//world and normal matrices of the scene objects, the simulation writes them and every pass reads them
+//the static models share one object, each animated model has its own
+gps::TransformCache sceneTransforms;
+uint32_t staticObject;
+uint32_t tractorObject;
+uint32_t tractorOnRoadObject;
+uint32_t boatObject;
+
+const gps::ObjectTransform& transformOf(const SceneDraw& draw) {
+    return sceneTransforms.get(draw.object);
+}
+
+//the scene model merged per material into chunks of the ground grid, in world space
+gps::StaticBatcher staticBatches;
+//side of a chunk in world units, a few chunks cover the part of the scene in view
+const float STATIC_CHUNK_SIZE = 8.0f;
+
+//large meshes of the scene model are rasterized on the cpu and hide the props behind them
+gps::WorkerPool workerPool;
+gps::OcclusionCuller occlusionCuller;
+std::vector<gps::Occluder> sceneOccluders;
+//occluder of each scene draw, -1 for the draws that are only tested
+std::vector<int> sceneDrawOccluders;
+std::vector<gps::BoundingBox> occludeeBoxes;
+std::vector<uint32_t> occludeeDraws;
+std::vector<uint8_t> occludeeResults;
+bool useOcclusionCulling = true;
+const int OCCLUSION_BUFFER_WIDTH = 256;
+//diagonal of the smallest mesh box that is used as an occluder
+const float OCCLUDER_MIN_SIZE = 1.0f;
+
+//gpu box queries on the expensive meshes, K switches between off and the two query modes
+gps::OcclusionQueries occlusionQueries;
+gps::Shader occlusionBoxShader;
+//query object of each scene draw, -1 for the draws that are too cheap to query
+std::vector<int> sceneDrawQueries;
+bool useOcclusionQueries = false;
+const size_t QUERY_MIN_TRIANGLES = 1000;
+
+//the shadow pass draws only the scene draws that can shadow what the camera sees
+gps::ShadowCasterCuller shadowCasterCuller;
+std::vector<uint32_t> shadowReceiverDraws;
+std::vector<uint32_t> shadowCasterDraws;
+
+//depth of the static casters, rendered again only when the light or the static geometry changes
+//the shadow pass copies it into the shadow map and draws the moving casters on top, H toggles it
+gps::ShadowMapCache shadowMapCache;
+bool useShadowCache = true;
+//1 for the scene draws of the animated models
+std::vector<uint8_t> sceneDrawDynamic;
+//bounds of the static draws, the cascades are clamped to them
+gps::BoundingBox staticSceneBounds;
+
+//all cascades drawn in one pass, each caster once with the mask of the cascades it shadows, L toggles it
+//the layer comes from the vertex shader when the extension is there, from geometry shader instancing otherwise
+gps::Shader layeredDepthShader;
+gps::Shader layeredDepthIndirectShader;
+bool useLayeredShadows = true;
+bool vertexShaderLayer = false;
+std::vector<uint32_t> shadowCasterMasks;
+std::vector<uint32_t> layeredShadowDraws;
+unsigned int layeredShadowLayers = 0;
+std::vector<uint32_t> staticShadowDraws;
+std::vector<uint32_t> cascadeCasterDraws;
+
+//renders the far cascades less often than the near ones, within a gpu time budget per frame, U toggles it
+//a cascade without moving casters keeps its layer until the camera leaves the rectangle it was rendered with
+gps::ShadowUpdateScheduler shadowScheduler;
+gps::GpuTimer shadowCascadeTimers[gps::MAX_CASCADES];
+gps::GpuTimer layeredShadowTimer;
+//bit c is set for cascade c
+uint32_t updatedShadowCascades = 0;
+uint32_t dynamicShadowCascades = 0;
+uint32_t renderedDynamicCascades = 0;
+
+//depth only pass before the shaded one, V cycles auto, on and off
+gps::DepthPrepass depthPrepass;
+
+//multi-draw indirect path, only available on 4.3+ contexts
+gps::GeometryBuffer sceneGeometry;
+gps::IndirectRenderer indirectRenderer;
+gps::ShaderPermutations basicIndirectShaderVariants;
+gps::Shader depthMapIndirectShader;
+bool useIndirectDraws = false;
+const GLuint MAX_INDIRECT_DRAWS = 4096;
+
+//deferred path, the opaque pass fills a compact g-buffer and one full screen pass lights, shadows and fogs it
+//B cycles forward, deferred and the two on alternate frames, which times both along the same camera path
+enum RenderPath {RENDER_FORWARD, RENDER_DEFERRED, RENDER_ALTERNATE};
+RenderPath renderPath = RENDER_FORWARD;
+bool deferredFrame = false;
+gps::GBuffer gBuffer;
+gps::Shader gBufferShader;
+gps::Shader gBufferIndirectShader;
+gps::ShaderPermutations resolveShaderVariants;
+gps::GpuTimer forwardPassTimer;
+gps::GpuTimer geometryPassTimer;
+gps::GpuTimer resolvePassTimer;
+//gpu time of the main pass of each path, summed over the frames since Z started the presentation
+struct PathTiming {
+    double totalMilliseconds;
+    unsigned int frames;
+    unsigned int lastResult;
+};
+PathTiming forwardTiming = PathTiming();
+PathTiming deferredTiming = PathTiming();
+
+//dynamic resolution, the main pass renders into an offscreen target whose size follows a gpu frame time
+//budget and is upscaled to the window, 1 toggles it; without it the main pass draws straight into the
+//multisampled window framebuffer
+gps::RenderTargetPool renderTargetPool;
+gps::DynamicResolution dynamicResolution;
+gps::Shader upscaleShader;
+bool useDynamicResolution = false;
+const float MIN_RENDER_SCALE = 0.5f;
+const float FRAME_BUDGET_MILLISECONDS = 1000.0f / 60.0f * 0.9f;
+//free targets of sizes not used for this many frames are deleted
+const unsigned int TARGET_POOL_IDLE_FRAMES = 300;
+//null while the main pass renders into the window
+gps::RenderTarget* sceneTarget = NULL;
+//size of the main pass, the window size without dynamic resolution
+int renderWidth = 0;
+int renderHeight = 0;
+GLint windowSamples = 0;
+
+//present mode and frames in flight, 2 cycles vsync, adaptive, uncapped and capped, 3 cycles 1 to 3 frames in flight
+//--frame-cap <hz> starts in the capped mode at that rate
+gps::FramePacer framePacer;
+const double DEFAULT_FRAME_CAP = 60.0;
+
+//the props far from the camera are drawn as one quad with their view from the impostor atlas, 4 toggles it
+//in a band before that the quad dissolves in over the meshes, which the main pass drops past the band;
+//the shadow pass keeps drawing the meshes
+struct PropImpostor {
+    gps::Model3D* model;
+    uint32_t object;
+    uint32_t firstDraw;
+    int impostor;
+    //0 draws only the meshes, 1 only the quad, in between the share of pixels the quad takes over
+    float fade;
+};
+gps::ImpostorAtlas impostorAtlas;
+gps::ShaderPermutations impostorShaderVariants;
+gps::Shader impostorGBufferShader;
+std::vector<PropImpostor> propImpostors;
+//prop of each scene draw, -1 for the draws that are never replaced
+std::vector<int> sceneDrawImpostors;
+bool useImpostors = true;
+const int IMPOSTOR_TEXTURE_UNIT = 12;
+//distance where the quad starts fading in, and length of the band, in radii of the prop
+const float IMPOSTOR_START_RADII = 40.0f;
+const float IMPOSTOR_FADE_RADII = 8.0f;
+
 GLenum glCheckError_(const char *file, int line)
 {
 	GLenum errorCode;
@@ -118,9 +335,152 @@ GLenum glCheckError_(const char *file, int line)
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
 
+void printRenderStats() {
+    const char* passNames[gps::PASS_COUNT] = { "shadow", "depth prepass", "opaque" };
+    for (int pass = 0; pass < gps::PASS_COUNT; pass++) {
+        gps::PassStats stats = renderQueue.getStats((gps::RenderPass)pass);
+        std::cout << passNames[pass] << " pass: " << stats.submitted << " submitted, "
+            << stats.visible << " visible, " << stats.culled << " culled, " << stats.drawCalls << " draws, " << stats.shaderBinds << " shader binds, "
+            << stats.triangles << " triangles" << std::endl;
+    }
+    gps::MaterialStats materialStats = materialLibrary.getStats();
+    std::cout << "materials: " << materialStats.materials << " in " << materialStats.layers << " texture layers of "
+        << materialStats.buckets << " arrays (" << materialStats.resampled << " textures resampled, "
+        << materialStats.memorySize / (1024 * 1024) << " MB), " << materialStats.released << " source textures freed, "
+        << materialStats.resident << " still resident (" << materialStats.residentMemorySize / (1024 * 1024) << " MB)" << std::endl;
+    gps::ImpostorStats impostorStats = impostorAtlas.getStats();
+    std::cout << "impostors: " << impostorStats.drawn << " of " << impostorStats.impostors << " props drawn as quads, "
+        << impostorStats.fading << " fading in" << std::endl;
+    gps::StaticBatchStats batchStats = staticBatches.getStats();
+    std::cout << "static batches: " << batchStats.batches << " from " << batchStats.sourceMeshes << " meshes, "
+        << batchStats.materials << " materials in " << batchStats.chunks << " chunks, " << batchStats.occluders << " occluders" << std::endl;
+    gps::BvhRefitStats refitStats = sceneBvh.getLastRefitStats();
+    std::cout << "scene bvh: " << sceneBvh.getNodeCount() << " nodes, " << refitStats.leavesRefit << " leaves and "
+        << refitStats.nodesRefit << " nodes refit, " << refitStats.partialRebuilds << " subtree and "
+        << refitStats.fullRebuilds << " full rebuilds" << std::endl;
+    std::cout << "scene shader variants: " << basicShaderVariants.getCompiledCount() + basicIndirectShaderVariants.getCompiledCount()
+        << " compiled" << std::endl;
+    if (withLight) {
+        gps::ClusterStats clusterStats = clusteredLights.getStats();
+        std::cout << "clustered lights: " << clusterStats.visibleLights << "/" << clusterStats.lights << " in view, "
+            << clusterStats.lightReferences << " references in " << clusterStats.occupiedClusters << " clusters (at most "
+            << clusterStats.maxClusterLights << ", " << clusterStats.droppedReferences << " dropped), assigned in "
+            << clusterStats.assignMilliseconds << " ms" << std::endl;
+    }
+    gps::PrepassStats prepassStats = depthPrepass.getStats();
+    std::cout << "depth prepass " << (prepassStats.active ? "on" : "off") << ": overdraw " << prepassStats.overdraw
+        << ", " << prepassStats.shadedSamples << " samples shaded, " << prepassStats.savedSamples << " saved" << std::endl;
+    gps::ShadowCullStats shadowStats = shadowCasterCuller.getStats();
+    std::cout << "shadow casters: " << shadowStats.casters << " drawn, " << shadowStats.outsideLight
+        << " outside the light frustum, " << shadowStats.noReceiver << " without a visible receiver ("
+        << shadowStats.receivers << " receivers)" << std::endl;
+    gps::ShadowCacheStats cacheStats = shadowMapCache.getStats();
+    std::cout << "shadow cache " << (useShadowCache ? "on" : "off") << ": " << staticShadowDraws.size() << " static casters, "
+        << cacheStats.rebuilds << " layer rebuilds, " << cacheStats.cachedLayers << " layers from the cache" << std::endl;
+    if (useLayeredShadows) {
+        std::cout << "layered shadow pass (" << (vertexShaderLayer ? "vertex shader layer" : "geometry shader instancing")
+            << "): " << layeredShadowDraws.size() << " casters drawn into " << layeredShadowLayers << " cascade layers" << std::endl;
+    }
+    gps::ShadowScheduleStats scheduleStats = shadowScheduler.getStats();
+    std::cout << "shadow scheduler " << (shadowScheduler.isEnabled() ? "on" : "off") << ": " << scheduleStats.updated << "/"
+        << scheduleStats.views << " cascades updated, " << scheduleStats.postponed << " of " << scheduleStats.due
+        << " due postponed, " << scheduleStats.spentMilliseconds << " ms spent, " << scheduleStats.savedMilliseconds
+        << " ms saved (" << scheduleStats.totalSavedMilliseconds << " ms in total)" << std::endl;
+    const char* qualityNames[gps::SHADOW_QUALITY_COUNT] = { "low", "medium", "high" };
+    std::cout << "shadow cascades (" << qualityNames[shadowCascades.getQuality()] << "): " << shadowCascades.getCascadeCount()
+        << " x " << shadowCascades.getResolution() << "^2, " << shadowCascades.getMemorySize() / (1024 * 1024) << " MB" << std::endl;
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        const gps::Cascade& cascade = shadowCascades.getCascade(c);
+        std::cout << "  cascade " << c << ": " << cascade.splitNear << " - " << cascade.splitFar << ", "
+            << cascade.texelSize * 100.0f << " cm texels" << std::endl;
+    }
+    gps::OcclusionStats occlusionStats = occlusionCuller.getStats();
+    std::cout << "occlusion: " << occlusionStats.rasterizedTriangles << "/" << occlusionStats.occluderTriangles
+        << " occluder triangles rasterized in " << occlusionStats.rasterizeMilliseconds << " ms, "
+        << occlusionStats.occluded << "/" << occlusionStats.tested << " draws occluded, tested in "
+        << occlusionStats.testMilliseconds << " ms" << std::endl;
+    const char* presentNames[gps::PRESENT_MODE_COUNT] = { "vsync", "adaptive", "uncapped", "capped" };
+    std::cout << "frame pacing: " << presentNames[framePacer.getMode()] << ", " << framePacer.getMaxFramesInFlight()
+        << " frames in flight" << std::endl;
+    for (int mode = 0; mode < gps::PRESENT_MODE_COUNT; mode++) {
+        for (int frames = 1; frames <= gps::MAX_FRAMES_IN_FLIGHT; frames++) {
+            gps::FramePacingStats pacingStats = framePacer.getStats((gps::PresentMode)mode, frames);
+            if (pacingStats.frames == 0) {
+                continue;
+            }
+            std::cout << "  " << presentNames[mode] << ", " << frames << " in flight: " << pacingStats.averageFrameMilliseconds
+                << " ms frames (deviation " << pacingStats.frameDeviationMilliseconds << ", max " << pacingStats.maxFrameMilliseconds
+                << "), input to gpu finish " << pacingStats.averageLatencyMilliseconds << " ms (max "
+                << pacingStats.maxLatencyMilliseconds << "), " << pacingStats.fenceWaitMilliseconds << " ms fence wait, "
+                << pacingStats.limiterMilliseconds << " ms limiter, " << pacingStats.frames << " frames" << std::endl;
+        }
+    }
+    gps::StreamBufferStats streamStats = drawStream.getStats();
+    std::cout << "draw data stream (" << (streamStats.persistent ? "persistent mapping" : "orphaning") << "): "
+        << streamStats.frameBytes / 1024.0 << " kB in " << streamStats.frameAllocations << " ranges last frame, "
+        << streamStats.averageFrameBytes / 1024.0 << " kB average, " << streamStats.peakFrameBytes / 1024.0 << " kB peak, "
+        << gps::STREAM_REGIONS << " x " << streamStats.regionSize / 1024 << " kB regions (" << streamStats.grows
+        << " grows), " << streamStats.fenceWaits << " fence waits for " << streamStats.fenceWaitMilliseconds << " ms" << std::endl;
+    gps::ResolutionStats resolutionStats = dynamicResolution.getStats();
+    gps::RenderTargetPoolStats poolStats = renderTargetPool.getStats();
+    std::cout << "dynamic resolution " << (useDynamicResolution ? "on" : "off") << ": " << renderWidth << "x" << renderHeight
+        << " (scale " << resolutionStats.scale << ", " << resolutionStats.scaleChanges << " changes), gpu frame "
+        << resolutionStats.frameMilliseconds << " ms of " << dynamicResolution.getTarget() << " ms, "
+        << resolutionStats.scaledMilliseconds << " ms scaled" << std::endl;
+    std::cout << "render targets: " << poolStats.targets << " (" << poolStats.inUse << " in use, "
+        << poolStats.memorySize / (1024 * 1024) << " MB), " << poolStats.created << " created, " << poolStats.reused
+        << " reused, " << poolStats.deleted << " deleted" << std::endl;
+    const char* pathNames[] = { "forward", "deferred", "alternating" };
+    std::cout << "render path " << pathNames[renderPath] << ": forward " << forwardPassTimer.getMilliseconds() << " ms, g-buffer "
+        << geometryPassTimer.getMilliseconds() << " ms + resolve " << resolvePassTimer.getMilliseconds() << " ms ("
+        << gBuffer.getWidth() << "x" << gBuffer.getHeight() << ", " << gBuffer.getMemorySize() / (1024 * 1024) << " MB)" << std::endl;
+    if (forwardTiming.frames > 0 || deferredTiming.frames > 0) {
+        std::cout << "  presentation path: forward " << forwardTiming.totalMilliseconds / std::max(forwardTiming.frames, 1u)
+            << " ms over " << forwardTiming.frames << " frames, deferred "
+            << deferredTiming.totalMilliseconds / std::max(deferredTiming.frames, 1u) << " ms over " << deferredTiming.frames
+            << " frames" << std::endl;
+    }
+    if (useOcclusionQueries) {
+        gps::OcclusionQueryStats queryStats = occlusionQueries.getStats();
+        std::cout << "occlusion queries: " << queryStats.tracked << " tracked, " << queryStats.issued << " issued, "
+            << queryStats.resolved << " resolved after " << queryStats.latencyFrames << " frames ("
+            << queryStats.latencyMilliseconds << " ms), " << queryStats.rejected << " draws rejected, "
+            << queryStats.conditional << " conditional" << std::endl;
+    }
+}
+
+//cascade c is due every 2^c frames
+void initShadowSchedule() {
+    shadowScheduler.setViewCount(shadowCascades.getCascadeCount());
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        shadowScheduler.setInterval(c, 1 << c);
+    }
+    renderedDynamicCascades = 0;
+}
+
+//the aspect ratio follows the window, the scene shaders get projection * view every frame
+void updateProjection() {
+    projection = glm::perspective(glm::radians(45.0f),
+        (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
+        SCENE_NEAR_PLANE, SCENE_FAR_PLANE);
+    myBasicShader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(myBasicShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+}
+
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
 	fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
-	//TODO
+    //the framebuffer is larger than the window on high dpi screens
+    WindowDimensions dimensions;
+    glfwGetFramebufferSize(window, &dimensions.width, &dimensions.height);
+    //a minimized window has no framebuffer, everything keeps its size until it comes back
+    if (dimensions.width == 0 || dimensions.height == 0) {
+        return;
+    }
+    myWindow.setWindowDimensions(dimensions);
+    updateProjection();
+    //the software depth buffer keeps the aspect ratio of the window
+    occlusionCuller.Init(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_WIDTH * dimensions.height / dimensions.width, &workerPool);
+    //the offscreen targets follow on the next frame, see beginSceneTarget
 }
 
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
@@ -131,6 +491,113 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
     if (key == GLFW_KEY_M && action == GLFW_PRESS)
         showDepthMap = !showDepthMap;
 
+    if (key == GLFW_KEY_I && action == GLFW_PRESS)
+        printRenderStats();
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS && indirectRenderer.isInitialized()) {
+        useIndirectDraws = !useIndirectDraws;
+        std::cout << (useIndirectDraws ? "multi-draw indirect path" : "per-mesh draw path") << std::endl;
+    }
+
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        useOcclusionCulling = !useOcclusionCulling;
+        std::cout << "occlusion culling " << (useOcclusionCulling ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_J && action == GLFW_PRESS) {
+        const char* qualityNames[gps::SHADOW_QUALITY_COUNT] = { "low", "medium", "high" };
+        gps::ShadowQuality quality = (gps::ShadowQuality)((shadowCascades.getQuality() + 1) % gps::SHADOW_QUALITY_COUNT);
+        shadowCascades.Init(quality);
+        shadowMapCache.Init(shadowCascades.getResolution(), shadowCascades.getResolution(), shadowCascades.getCascadeCount());
+        initShadowSchedule();
+        std::cout << "shadow quality " << qualityNames[quality] << std::endl;
+    }
+
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        useLayeredShadows = !useLayeredShadows;
+        std::cout << "layered shadow pass " << (useLayeredShadows ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        withShadows = !withShadows;
+        std::cout << "shadows " << (withShadows ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_1 && action == GLFW_PRESS) {
+        useDynamicResolution = !useDynamicResolution;
+        dynamicResolution.Reset();
+        std::cout << "dynamic resolution " << (useDynamicResolution ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_2 && action == GLFW_PRESS) {
+        const char* presentNames[gps::PRESENT_MODE_COUNT] = { "vsync", "adaptive", "uncapped", "capped" };
+        gps::PresentMode mode = (gps::PresentMode)((framePacer.getMode() + 1) % gps::PRESENT_MODE_COUNT);
+        framePacer.setMode(mode);
+        std::cout << "present mode " << presentNames[mode];
+        if (mode == gps::PRESENT_ADAPTIVE && !framePacer.isAdaptiveSupported()) {
+            std::cout << " (not supported, vsync)";
+        }
+        if (mode == gps::PRESENT_CAPPED) {
+            std::cout << " at " << framePacer.getCapRate() << " Hz";
+        }
+        std::cout << std::endl;
+    }
+
+    if (key == GLFW_KEY_3 && action == GLFW_PRESS) {
+        framePacer.setMaxFramesInFlight(framePacer.getMaxFramesInFlight() % gps::MAX_FRAMES_IN_FLIGHT + 1);
+        std::cout << framePacer.getMaxFramesInFlight() << " frames in flight" << std::endl;
+    }
+
+    if (key == GLFW_KEY_4 && action == GLFW_PRESS) {
+        useImpostors = !useImpostors;
+        std::cout << "impostors " << (useImpostors ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        const char* pathNames[] = { "forward", "deferred", "alternating" };
+        renderPath = (RenderPath)((renderPath + 1) % 3);
+        std::cout << "render path " << pathNames[renderPath] << std::endl;
+    }
+
+    if (key == GLFW_KEY_U && action == GLFW_PRESS) {
+        shadowScheduler.setEnabled(!shadowScheduler.isEnabled());
+        std::cout << "shadow update scheduler " << (shadowScheduler.isEnabled() ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        useShadowCache = !useShadowCache;
+        std::cout << "shadow cache " << (useShadowCache ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        const char* modeNames[] = { "off", "on", "auto" };
+        gps::PrepassMode modes[] = { gps::PREPASS_ON, gps::PREPASS_OFF, gps::PREPASS_AUTO };
+        gps::PrepassMode next = gps::PREPASS_AUTO;
+        for (int i = 0; i < 3; i++) {
+            if (depthPrepass.getMode() == modes[i]) {
+                next = modes[(i + 1) % 3];
+            }
+        }
+        depthPrepass.setMode(next);
+        std::cout << "depth prepass " << modeNames[next] << std::endl;
+    }
+
+    if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        if (!useOcclusionQueries) {
+            useOcclusionQueries = true;
+            occlusionQueries.setMode(gps::QUERY_MODE_CONDITIONAL);
+            std::cout << "occlusion queries: conditional rendering" << std::endl;
+        }
+        else if (occlusionQueries.getMode() == gps::QUERY_MODE_CONDITIONAL) {
+            occlusionQueries.setMode(gps::QUERY_MODE_NEXT_FRAME);
+            std::cout << "occlusion queries: next frame decisions" << std::endl;
+        }
+        else {
+            useOcclusionQueries = false;
+            std::cout << "occlusion queries off" << std::endl;
+        }
+    }
+
 	if (key >= 0 && key < 1024) {
         if (action == GLFW_PRESS) {
             pressedKeys[key] = true;
@@ -178,28 +645,14 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 void initFBO() { //for depth map texture,shadow algorithm
-    glGenFramebuffers(1, &shadowMapFBO);
-
-    //create depth texture for FBO
-    glGenTextures(1, &depthMapTexture);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0,
-        GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    float borderColor[] = { 1.0f,1.0f,1.0f,1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
-    //attach texture to FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapTexture, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadowCascades.Init(gps::SHADOW_QUALITY_MEDIUM);
+    //the cache layers follow the size and count of the cascades
+    shadowMapCache.Init(shadowCascades.getResolution(), shadowCascades.getResolution(), shadowCascades.getCascadeCount());
+    initShadowSchedule();
+    for (int c = 0; c < gps::MAX_CASCADES; c++) {
+        shadowCascadeTimers[c].Init();
+    }
+    layeredShadowTimer.Init();
 }
 
 bool powerOn = false;
@@ -292,19 +745,18 @@ void processMovement() {
     }
 
     if (pressedKeys[GLFW_KEY_P]) {
-        if (withLight) {
-            lightPosOn.x = 0;
-            glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightPosOn"), 1, glm::value_ptr(lightPosOn));
-            withLight = false;
-        }
-        else {
-            lightPosOn.x = 1;
-            glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightPosOn"), 1, glm::value_ptr(lightPosOn));
-            withLight = true;
-        }
+        //the point light is compiled into the scene shader variant instead of switched by a uniform
+        withLight = !withLight;
     }
 
     if (pressedKeys[GLFW_KEY_Z]) {
+        //the path timings start over with the presentation
+        if (!startPres) {
+            forwardTiming = PathTiming();
+            deferredTiming = PathTiming();
+            forwardTiming.lastResult = forwardPassTimer.getResultCount();
+            deferredTiming.lastResult = resolvePassTimer.getResultCount();
+        }
         startPres = true;
     }
 
@@ -358,13 +810,287 @@ void initModels() {
     screenQuad.LoadModel("models/quad/quad.obj");  
 }
 
+void initMaterials() {
+    gps::Model3D* sceneModels[] = { &scene, &street_light, &tractor, &tractor_onRoad, &boat, &duck, &gray_dog, &white_dog };
+    for (gps::Model3D* sceneModel : sceneModels) {
+        materialLibrary.AddModel(*sceneModel);
+    }
+    materialLibrary.Build();
+}
+
+void initStaticBatches() {
+    //the scene sits where it was modelled, with an identity model matrix
+    //the static props stay apart, a prop in a batch could not be replaced by its impostor
+    staticBatches.Add(scene, glm::mat4(1.0f));
+    staticBatches.Build(STATIC_CHUNK_SIZE, OCCLUDER_MIN_SIZE);
+    //only the batches are drawn from now on
+    scene.ReleaseMeshes();
+    gps::StaticBatchStats batchStats = staticBatches.getStats();
+    std::cout << "Static batches : " << batchStats.sourceMeshes << " meshes merged into " << batchStats.batches << " batches of "
+        << batchStats.materials << " materials in " << batchStats.chunks << " chunks, " << batchStats.triangles << " triangles, "
+        << batchStats.vertices << " vertices, " << batchStats.occluders << " occluders" << std::endl;
+}
+
 void initShaders() {
-	myBasicShader.loadShader(
-        "shaders/basic.vert",
-        "shaders/basic.frag");
+    basicShaderVariants.Init("shaders/basic.vert", "shaders/basic.frag");
+    //the variant with every feature, the one initUniforms and processMovement set up
+    myBasicShader = basicShaderVariants.getShader(gps::SHADER_ALL_FEATURES, shadowCascades.getQuality());
     depthMapShader.loadShader("shaders/light.vert", "shaders/light.frag");
     screenQuadShader.loadShader("shaders/screenQuad.vert", "shaders/screenQuad.frag");
-   
+    occlusionBoxShader.loadShader("shaders/occlusion_box.vert", "shaders/light.frag");
+    vertexShaderLayer = GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_layer;
+    if (vertexShaderLayer) {
+        layeredDepthShader.loadShader("shaders/light_layered_vs.vert", "shaders/light.frag");
+    }
+    else {
+        layeredDepthShader.loadShader("shaders/light_layered.vert", "shaders/light_layered.geom", "shaders/light.frag");
+    }
+    //instanced once per layer when the vertex shader picks the layer
+    renderQueue.setInstancedLayers(gps::PASS_SHADOW, vertexShaderLayer);
+    if (myWindow.isContextAtLeast(4, 3)) {
+        basicIndirectShaderVariants.Init("shaders/basic_indirect.vert", "shaders/basic.frag");
+        depthMapIndirectShader.loadShader("shaders/light_indirect.vert", "shaders/light.frag");
+        //the draw id already uses the instance, so the indirect path always takes the geometry shader
+        layeredDepthIndirectShader.loadShader("shaders/light_layered_indirect.vert", "shaders/light_layered.geom", "shaders/light.frag");
+        gBufferIndirectShader.loadShader("shaders/basic_indirect.vert", "shaders/gbuffer.frag");
+    }
+    gBufferShader.loadShader("shaders/basic.vert", "shaders/gbuffer.frag");
+    resolveShaderVariants.Init("shaders/fullscreen.vert", "shaders/deferred_resolve.frag");
+    upscaleShader.loadShader("shaders/fullscreen.vert", "shaders/upscale.frag");
+}
+
+void initDrawStream() {
+    drawStream.Init(DRAW_STREAM_REGION_SIZE);
+    renderQueue.setStreamBuffer(&drawStream);
+    if (!drawStream.isPersistent()) {
+        std::cout << "buffer storage not available, the draw data buffer is orphaned every frame" << std::endl;
+    }
+}
+
+void initIndirectDraws() {
+    if (!myWindow.isContextAtLeast(4, 3)) {
+        std::cout << "OpenGL 4.3 not available, using per-mesh draws" << std::endl;
+        return;
+    }
+
+    std::vector<std::vector<gps::Mesh>*> sceneMeshes = { &staticBatches.getMeshes(), &street_light.getMeshes(),
+        &duck.getMeshes(), &gray_dog.getMeshes(), &white_dog.getMeshes(), &tractor.getMeshes(),
+        &tractor_onRoad.getMeshes(), &boat.getMeshes() };
+    sceneGeometry.Build(sceneMeshes, MAX_INDIRECT_DRAWS);
+    indirectRenderer.Init(&sceneGeometry, &drawStream, MAX_INDIRECT_DRAWS);
+    useIndirectDraws = true;
+}
+
+//adds the meshes to the scene draws and returns the index of the first one
+uint32_t addSceneDraws(std::vector<gps::Mesh>& meshes, uint32_t object, std::vector<gps::BoundingBox>& boxes) {
+    uint32_t firstDraw = (uint32_t)sceneDraws.size();
+    for (size_t i = 0; i < meshes.size(); i++) {
+        SceneDraw draw;
+        draw.mesh = &meshes[i];
+        draw.object = object;
+        sceneDraws.push_back(draw);
+        boxes.push_back(gps::TransformBox(meshes[i].bounds, transformOf(draw).model));
+    }
+    return firstDraw;
+}
+
+//adds the meshes of a prop like addSceneDraws and queues the model for the impostor atlas
+uint32_t addPropDraws(gps::Model3D& model3D, uint32_t object, std::vector<gps::BoundingBox>& boxes) {
+    PropImpostor prop;
+    prop.model = &model3D;
+    prop.object = object;
+    prop.firstDraw = addSceneDraws(model3D.getMeshes(), object, boxes);
+    prop.impostor = impostorAtlas.Add(model3D);
+    prop.fade = 0.0f;
+    propImpostors.push_back(prop);
+    return prop.firstDraw;
+}
+
+void initSceneBvh() {
+    //every model starts with an identity model matrix, the animated ones move from there
+    std::vector<gps::BoundingBox> boxes;
+    staticObject = sceneTransforms.Add(glm::mat4(1.0f));
+    tractorObject = sceneTransforms.Add(glm::mat4(1.0f));
+    tractorOnRoadObject = sceneTransforms.Add(glm::mat4(1.0f));
+    boatObject = sceneTransforms.Add(glm::mat4(1.0f));
+    addSceneDraws(staticBatches.getMeshes(), staticObject, boxes);
+    gps::Model3D* staticProps[] = { &street_light, &duck, &gray_dog, &white_dog };
+    for (gps::Model3D* staticProp : staticProps) {
+        addPropDraws(*staticProp, staticObject, boxes);
+    }
+    tractorFirstDraw = addPropDraws(tractor, tractorObject, boxes);
+    tractorOnRoadFirstDraw = addPropDraws(tractor_onRoad, tractorOnRoadObject, boxes);
+    boatFirstDraw = addSceneDraws(boat.getMeshes(), boatObject, boxes);
+    sceneDrawImpostors.assign(sceneDraws.size(), -1);
+    for (size_t p = 0; p < propImpostors.size(); p++) {
+        size_t meshCount = propImpostors[p].model->getMeshes().size();
+        for (size_t i = 0; i < meshCount; i++) {
+            sceneDrawImpostors[propImpostors[p].firstDraw + i] = (int)p;
+        }
+    }
+    staticSceneBounds = gps::EmptyBox();
+    for (size_t i = 0; i < tractorFirstDraw; i++) {
+        staticSceneBounds = gps::MergeBoxes(staticSceneBounds, boxes[i]);
+    }
+    //the animated models are added last
+    sceneDrawDynamic.assign(sceneDraws.size(), 0);
+    for (size_t i = tractorFirstDraw; i < sceneDraws.size(); i++) {
+        sceneDrawDynamic[i] = 1;
+    }
+
+    double start = glfwGetTime();
+    sceneBvh.Build(boxes);
+    std::cout << "Scene BVH : " << sceneDraws.size() << " meshes, " << sceneBvh.getNodeCount() << " nodes, "
+        << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+}
+
+void initOcclusionCulling() {
+    workerPool.Start(0);
+    int bufferHeight = OCCLUSION_BUFFER_WIDTH * myWindow.getWindowDimensions().height / myWindow.getWindowDimensions().width;
+    occlusionCuller.Init(OCCLUSION_BUFFER_WIDTH, bufferHeight, &workerPool);
+
+    //buildings and terrain come from the scene model, the props are too small to hide anything
+    //the static batches come first in the scene draws, the ones of the large scene meshes occlude
+    //and the batches of the small ones stay occludees
+    sceneDrawOccluders.assign(sceneDraws.size(), -1);
+    for (size_t i = 0; i < staticBatches.getMeshes().size(); i++) {
+        if (!staticBatches.isOccluder(i)) {
+            continue;
+        }
+        gps::Mesh* mesh = sceneDraws[i].mesh;
+        gps::Occluder occluder;
+        occluder.positions.reserve(mesh->vertices->size());
+        for (size_t v = 0; v < mesh->vertices->size(); v++) {
+            occluder.positions.push_back((*mesh->vertices)[v].Position);
+        }
+        occluder.indices.assign(mesh->indices.begin(), mesh->indices.end());
+        if (occluder.indices.empty()) {
+            continue;
+        }
+        sceneDrawOccluders[i] = (int)sceneOccluders.size();
+        sceneOccluders.push_back(occluder);
+    }
+    std::cout << "Occlusion culling : " << sceneOccluders.size() << " occluders, " << workerPool.getThreadCount()
+        << " threads" << std::endl;
+}
+
+void initDepthPrepass() {
+    glGetIntegerv(GL_SAMPLES, &windowSamples);
+    depthPrepass.Init(myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+}
+
+void initClusteredLights() {
+    std::vector<gps::PointLight> lamps;
+    if (!gps::LoadPointLights(LAMPS_FILE, lamps) || lamps.empty()) {
+        gps::PointLight lamp;
+        lamp.position = lightPosition;
+        lamp.radius = SCENE_FAR_PLANE;
+        lamp.color = glm::vec3(1.0f, 0.0f, 0.0f);
+        lamps.push_back(lamp);
+    }
+    clusteredLights.Init(&workerPool);
+    clusteredLights.setLights(lamps);
+    std::cout << "Clustered lights : " << lamps.size() << " point lights" << std::endl;
+}
+
+void initDeferredRendering() {
+    gBuffer.Init(&renderTargetPool);
+    forwardPassTimer.Init();
+    geometryPassTimer.Init();
+    resolvePassTimer.Init();
+}
+
+void initDynamicResolution() {
+    dynamicResolution.Init(MIN_RENDER_SCALE, 1.0f, FRAME_BUDGET_MILLISECONDS);
+    renderWidth = myWindow.getWindowDimensions().width;
+    renderHeight = myWindow.getWindowDimensions().height;
+}
+
+void initFramePacing(double frameCap) {
+    framePacer.Init(myWindow.getWindow());
+    if (frameCap > 0.0) {
+        framePacer.setCapRate(frameCap);
+        framePacer.setMode(gps::PRESENT_CAPPED);
+    }
+    else {
+        framePacer.setCapRate(DEFAULT_FRAME_CAP);
+    }
+}
+
+//renders the views of the props queued by initSceneBvh, their meshes sample the material arrays
+void initImpostors() {
+    gps::Shader bakeShader;
+    bakeShader.loadShader("shaders/impostor_bake.vert", "shaders/impostor_bake.frag");
+    bakeShader.useShaderProgram();
+    materialLibrary.BindTextures(bakeShader, MATERIAL_TEXTURE_UNIT);
+    impostorAtlas.Build(bakeShader);
+    glDeleteProgram(bakeShader.shaderProgram);
+
+    impostorShaderVariants.Init("shaders/impostor.vert", "shaders/impostor.frag");
+    impostorGBufferShader.loadShader("shaders/impostor.vert", "shaders/impostor_gbuffer.frag");
+}
+
+void initOcclusionQueries() {
+    size_t queryCount = 0;
+    sceneDrawQueries.assign(sceneDraws.size(), -1);
+    for (size_t i = 0; i < sceneDraws.size(); i++) {
+        if (sceneDraws[i].mesh->indices.size() / 3 >= QUERY_MIN_TRIANGLES) {
+            sceneDrawQueries[i] = (int)queryCount++;
+        }
+    }
+    occlusionQueries.Init(queryCount, occlusionBoxShader);
+    std::cout << "Occlusion queries : " << queryCount << " tracked meshes" << std::endl;
+}
+
+uint32_t activeShaderFeatures() {
+    uint32_t features = 0;
+    if (withFog) {
+        features |= gps::SHADER_FOG;
+    }
+    if (withLight) {
+        features |= gps::SHADER_POINT_LIGHT;
+    }
+    if (withShadows) {
+        features |= gps::SHADER_SHADOWS;
+    }
+    return features;
+}
+
+//the cheapest scene shader variant that has what the current state needs, compiled on first use
+gps::Shader activeBasicShader() {
+    //the shadow filter follows the cascade quality tier
+    int quality = shadowCascades.getQuality();
+    if (useIndirectDraws) {
+        return basicIndirectShaderVariants.getShader(activeShaderFeatures(), quality);
+    }
+    return basicShaderVariants.getShader(activeShaderFeatures(), quality);
+}
+
+//the resolve of the deferred path has the same features, the g-buffer shader has none
+gps::Shader activeResolveShader() {
+    return resolveShaderVariants.getShader(activeShaderFeatures(), shadowCascades.getQuality());
+}
+
+gps::Shader activeGBufferShader() {
+    return useIndirectDraws ? gBufferIndirectShader : gBufferShader;
+}
+
+gps::Shader activeDepthMapShader() {
+    return useIndirectDraws ? depthMapIndirectShader : depthMapShader;
+}
+
+gps::Shader activeLayeredDepthShader() {
+    return useIndirectDraws ? layeredDepthIndirectShader : layeredDepthShader;
+}
+
+//uploads the uniforms initUniforms and processMovement only send to myBasicShader, every variant has its own
+void uploadSceneUniforms(gps::Shader shader) {
+    shader.useShaderProgram();
+    //the shader lights in eye space, the direction is transformed and normalized here once per frame
+    glm::vec3 lightDirEye = glm::normalize(glm::mat3(view) * lightDir);
+    glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightDirEye"), 1, glm::value_ptr(lightDirEye));
+    glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
+    glUniform3fv(glGetUniformLocation(shader.shaderProgram, "fogDensity"), 1, glm::value_ptr(fogDensity));
 }
 
 void initUniforms() {
@@ -387,7 +1113,7 @@ void initUniforms() {
 	// create projection matrix
 	projection = glm::perspective(glm::radians(45.0f),
                                (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
-                               0.1f, 20.0f);
+                               SCENE_NEAR_PLANE, SCENE_FAR_PLANE);
 	projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
 	// send projection matrix to shader
 	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));	
@@ -409,22 +1135,16 @@ void initUniforms() {
     fogDensityLoc = glGetUniformLocation(myBasicShader.shaderProgram, "fogDensity");
     glUniform3fv(fogDensityLoc, 1, glm::value_ptr(fogDensity));
 
-    //set light position
+    //set light position, the lamp initClusteredLights falls back to
     lightPosition = glm::vec3(6.08f, 0.60f, 4.68f);
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightPosition"), 1, glm::value_ptr(lightPosition));
-
-    //set light point on
-    lightPosOn = glm::vec3(0, 0, 0);
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightPosOn"), 1, glm::value_ptr(lightPosOn));
 
 }
 
-glm::mat4 computeLightSpaceTrMatrix() {
-    glm::mat4 lightView = glm::lookAt(lightDir, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    const GLfloat near_plane = 0.0001f, far_plane = 500.0f;
-    glm::mat4 lightProjection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, near_plane, far_plane);
-    glm::mat4 lightSpaceTrMatrix = lightProjection * lightView;
-    return lightSpaceTrMatrix;
+//distance the shadow pass normalizes its sort depth with
+const GLfloat LIGHT_FAR_PLANE = 500.0f;
+
+glm::mat4 computeLightView() {
+    return glm::lookAt(lightDir, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 }
 
 void renderTeapot(gps::Shader shader) {
@@ -441,63 +1161,30 @@ void renderTeapot(gps::Shader shader) {
     teapot.Draw(shader);
 }
 
-void renderStreetLight(gps::Shader shader, bool depthPass) {
-    shader.useShaderProgram();
-    
-    model = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    if (!depthPass) {
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    }
-    street_light.Draw(shader);
-}
-
-void renderPrincipalScene(gps::Shader shader, bool depthPass) {
-    shader.useShaderProgram();
-    model = glm::mat4(1.0f);
-    //send scene model matrix data to shader
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-    //send scene normal matrix data to shader
-    if (!depthPass) {
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    }  
-    scene.Draw(shader);
+gps::RenderPass passFor(bool depthPass) {
+    return depthPass ? gps::PASS_SHADOW : gps::PASS_OPAQUE;
 }
 
-
-void renderDuck(gps::Shader shader, bool depthPass) {
-    // select active shader program
-    shader.useShaderProgram();
-    model = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    if (!depthPass) {
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+//both passes draw through the scene bvh, so an animated model only moves its entries
+//and the next Refit picks them up
+//only the dynamic draws are animated, the static casters in the shadow map cache never move after initSceneBvh
+void updateAnimatedDraws(gps::Model3D& model3D, uint32_t firstDraw) {
+    if (!sceneTransforms.hasMoved(sceneDraws[firstDraw].object)) {
+        return;
     }
-    duck.Draw(shader);
-}
-
-void renderGrayDog(gps::Shader shader, bool depthPass) {
-    // select active shader program
-    shader.useShaderProgram();
-    model = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    if (!depthPass) {
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+    std::vector<gps::Mesh>& meshes = model3D.getMeshes();
+    for (size_t i = 0; i < meshes.size(); i++) {
+        sceneBvh.UpdatePrimitive(firstDraw + (uint32_t)i, gps::TransformBox(meshes[i].bounds, transformOf(sceneDraws[firstDraw + i]).model));
     }
-    gray_dog.Draw(shader);
 }
 
-void renderWhiteDog(gps::Shader shader, bool depthPass) {
-    // select active shader program
-    shader.useShaderProgram();
-    model = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    if (!depthPass) {
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    }
-    white_dog.Draw(shader);
-}
+//the animations advance in fixed steps of SIMULATION_STEP seconds, which is how often the old per pass updates
+//ran with a shadow and a main pass per frame at 60 Hz, so the models keep their original speed at any frame rate
+const double SIMULATION_STEP = 1.0 / 120.0;
+//a longer frame (a stall, a dragged window) is not caught up
+const double MAX_SIMULATION_FRAME = 0.25;
+double simulationAccumulator = 0.0;
+double lastSimulationTime = -1.0;
 
 float delta_tractor = 0.0f;
 float delta_tractor_back = 0.0f;
@@ -511,43 +1198,28 @@ float updateDelta(double elapsedSeconds, float movementSpeed, float delta) {
     return newDelta;
 }
 
-double lastTimeStamp = glfwGetTime();
-
-void animation_for_tractor(gps::Shader shader, bool depthPass) {
-    model = glm::mat4(1.0f);
+glm::mat4 animation_for_tractor() {
     delta_tractor += 0.001f;
-    //get current time
-    double currentTimeStamp = glfwGetTime();
-    delta_tractor = updateDelta(currentTimeStamp - lastTimeStamp,movementSpeed_tractor,delta_tractor);
-    lastTimeStamp = currentTimeStamp;
-    model = glm::translate(model, glm::vec3(-delta_tractor, 0, 0));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));   
+    delta_tractor = updateDelta(SIMULATION_STEP, movementSpeed_tractor, delta_tractor);
+    return glm::translate(glm::mat4(1.0f), glm::vec3(-delta_tractor, 0, 0));
 }
 
 float lastDeltaTractor = 0;
 
-void animation_for_tractor_back(gps::Shader shader, bool depthPass) {
-    model = glm::mat4(1.0f);
+glm::mat4 animation_for_tractor_back() {
     delta_tractor_back += 0.001f;
-    //get current time
-    double currentTimeStamp = glfwGetTime();
-    delta_tractor_back = updateDelta(currentTimeStamp - lastTimeStamp, movementSpeed_tractor, delta_tractor_back);
-    lastTimeStamp = currentTimeStamp;
-    model = glm::translate(model, glm::vec3(-lastDeltaTractor + delta_tractor_back, 0, 0));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    delta_tractor_back = updateDelta(SIMULATION_STEP, movementSpeed_tractor, delta_tractor_back);
+    return glm::translate(glm::mat4(1.0f), glm::vec3(-lastDeltaTractor + delta_tractor_back, 0, 0));
 }
 
-void renderTractor(gps::Shader shader, bool depthPass) {
-    // select active shader program
-    shader.useShaderProgram();
-    // draw tractor
+void animateTractor() {
     if (move_tractor < 1250) {
-        animation_for_tractor(shader,depthPass);
+        sceneTransforms.setTransform(tractorObject, animation_for_tractor());
         lastDeltaTractor = delta_tractor;
         move_tractor++;
     }
     else if(move_tractor_back > 0){
-        animation_for_tractor_back(shader,depthPass);
+        sceneTransforms.setTransform(tractorObject, animation_for_tractor_back());
         move_tractor_back--;
     }
     else {
@@ -555,8 +1227,7 @@ void renderTractor(gps::Shader shader, bool depthPass) {
         move_tractor_back = 1300;
         delta_tractor = 0.0f;
         delta_tractor_back = 0.0f;
-    }   
-    tractor.Draw(shader);
+    }
 }
 
 float delta_tractor_onRoad = 0.0f;
@@ -564,112 +1235,606 @@ float movementSpeed_tractor_onRoad = 0.02;
 int move_tractor_onRoad = 0;
 float lastDeltaTractor_onRoad = 0;
 
-void animation_for_tractor_onRoad(gps::Shader shader, bool depthPass) {
-    model = glm::mat4(1.0f);
+glm::mat4 animation_for_tractor_onRoad() {
     delta_tractor_onRoad += 0.001f;
-    //get current time
-    double currentTimeStamp = glfwGetTime();
-    delta_tractor_onRoad = updateDelta(currentTimeStamp - lastTimeStamp, movementSpeed_tractor, delta_tractor_onRoad);
-    lastTimeStamp = currentTimeStamp;
-    model = glm::translate(model, glm::vec3(-delta_tractor_onRoad, 0, (-delta_tractor_onRoad)/2));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    delta_tractor_onRoad = updateDelta(SIMULATION_STEP, movementSpeed_tractor, delta_tractor_onRoad);
+    return glm::translate(glm::mat4(1.0f), glm::vec3(-delta_tractor_onRoad, 0, (-delta_tractor_onRoad)/2));
 }
 
-void renderTractor_onRoad(gps::Shader shader, bool depthPass, bool powerOn) {
-    // select active shader program
-    shader.useShaderProgram();
+void animateTractor_onRoad(bool powerOn) {
+    glm::mat4 tractorModel = glm::mat4(1.0f);
     if (powerOn) {
         if (move_tractor_onRoad < 1700) {
-            animation_for_tractor_onRoad(shader, depthPass);
+            tractorModel = animation_for_tractor_onRoad();
             lastDeltaTractor_onRoad = delta_tractor_onRoad;
             move_tractor_onRoad++;
         }
         else {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(-lastDeltaTractor_onRoad, 0, (-delta_tractor_onRoad) / 2));
-            glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+            tractorModel = glm::translate(tractorModel, glm::vec3(-lastDeltaTractor_onRoad, 0, (-delta_tractor_onRoad) / 2));
         }
     }
-    else {
-        model = glm::mat4(1.0f);
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        if (!depthPass) {
-            glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-        }
-    }
-    // draw tractor
-    tractor_onRoad.Draw(shader);
+    sceneTransforms.setTransform(tractorOnRoadObject, tractorModel);
 }
 
 float delta_boat = 0.0f;
 
-void animation_for_boat(gps::Shader shader, bool depthPass) {
-    model = glm::mat4(1.0f);
+glm::mat4 animation_for_boat() {
     delta_boat += 0.001f;
-    //get current time
-    double currentTimeStamp = glfwGetTime();
-    delta_boat = updateDelta(currentTimeStamp - lastTimeStamp, movementSpeed_tractor, delta_boat);
-    lastTimeStamp = currentTimeStamp;
-    model = glm::translate(model, glm::vec3(delta_boat, 0, 0));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    delta_boat = updateDelta(SIMULATION_STEP, movementSpeed_tractor, delta_boat);
+    return glm::translate(glm::mat4(1.0f), glm::vec3(delta_boat, 0, 0));
 }
 
 int move_boat = 0;
 float lastDeltaBoat = 0.0f;
 
-void renderBoat(gps::Shader shader, bool depthPass) {
-    // select active shader program
-    shader.useShaderProgram();
+void animateBoat() {
+    glm::mat4 boatModel = glm::mat4(1.0f);
     if(powerBoat) {
         if (move_boat < 450) {
-            animation_for_boat(shader, depthPass);
+            boatModel = animation_for_boat();
             lastDeltaBoat = delta_boat;
             move_boat++;
         }
         else {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(lastDeltaBoat, 0, 0));
-            glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+            boatModel = glm::translate(boatModel, glm::vec3(lastDeltaBoat, 0, 0));
         }
     }
+    sceneTransforms.setTransform(boatObject, boatModel);
+}
+
+//runs the fixed steps the elapsed time holds, then interpolates the transforms of the frame between the last two
+//and moves the bvh entries of the models that moved; the shadow and main passes only read the result
+void updateSimulation() {
+    double now = glfwGetTime();
+    if (lastSimulationTime >= 0.0) {
+        simulationAccumulator += std::min(now - lastSimulationTime, MAX_SIMULATION_FRAME);
+    }
+    lastSimulationTime = now;
+    while (simulationAccumulator >= SIMULATION_STEP) {
+        sceneTransforms.BeginStep();
+        animateTractor();
+        animateTractor_onRoad(powerOn);
+        animateBoat();
+        simulationAccumulator -= SIMULATION_STEP;
+    }
+    sceneTransforms.Interpolate((float)(simulationAccumulator / SIMULATION_STEP));
+
+    updateAnimatedDraws(tractor, tractorFirstDraw);
+    updateAnimatedDraws(tractor_onRoad, tractorOnRoadFirstDraw);
+    updateAnimatedDraws(boat, boatFirstDraw);
+    sceneBvh.Refit();
+}
+
+//for shadow we make a draw Objects function where I put the conent from renderScene function
+
+//rasterizes the visible occluders and removes the draws hidden behind them from visibleSceneDraws
+void cullOccludedDraws() {
+    occlusionCuller.BeginFrame(projection * view);
+    occludeeBoxes.clear();
+    occludeeDraws.clear();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < visibleSceneDraws.size(); i++) {
+        uint32_t drawIndex = visibleSceneDraws[i];
+        SceneDraw& draw = sceneDraws[drawIndex];
+        int occluder = sceneDrawOccluders[drawIndex];
+        if (occluder >= 0) {
+            occlusionCuller.AddOccluder(sceneOccluders[occluder], transformOf(draw).model);
+            visibleSceneDraws[kept++] = drawIndex;
+        }
+        else {
+            occludeeBoxes.push_back(gps::TransformBox(draw.mesh->bounds, transformOf(draw).model));
+            occludeeDraws.push_back(drawIndex);
+        }
+    }
+    occlusionCuller.Rasterize();
+    occlusionCuller.TestBoxes(occludeeBoxes, occludeeResults);
+
+    for (size_t i = 0; i < occludeeDraws.size(); i++) {
+        if (occludeeResults[i]) {
+            visibleSceneDraws[kept++] = occludeeDraws[i];
+        }
+    }
+    visibleSceneDraws.resize(kept);
+}
+
+//how far each prop is into its impostor band, by its distance from the camera in radii
+void updateImpostorFades() {
+    glm::vec3 cameraPosition = myCamera.getPosition();
+    for (size_t p = 0; p < propImpostors.size(); p++) {
+        PropImpostor& prop = propImpostors[p];
+        gps::BoundingSphere sphere = impostorAtlas.getSphere(prop.impostor, sceneTransforms.get(prop.object).model);
+        float distance = glm::length(sphere.center - cameraPosition) / std::max(sphere.radius, 1e-4f);
+        prop.fade = useImpostors ? glm::clamp((distance - IMPOSTOR_START_RADII) / IMPOSTOR_FADE_RADII, 0.0f, 1.0f) : 0.0f;
+    }
+}
+
+//drops the meshes of the props that are only drawn as impostors
+void removeImpostorDraws() {
+    size_t kept = 0;
+    for (size_t i = 0; i < visibleSceneDraws.size(); i++) {
+        int prop = sceneDrawImpostors[visibleSceneDraws[i]];
+        if (prop < 0 || propImpostors[prop].fade < 1.0f) {
+            visibleSceneDraws[kept++] = visibleSceneDraws[i];
+        }
+    }
+    visibleSceneDraws.resize(kept);
+}
+
+//submits the meshes the bvh finds inside the camera frustum
+void renderVisibleScene(gps::Shader shader) {
+    visibleSceneDraws.clear();
+    sceneBvh.QueryFrustum(cameraFrustum, visibleSceneDraws);
+    removeImpostorDraws();
+    if (useOcclusionCulling) {
+        cullOccludedDraws();
+    }
+    unsigned int rejected = 0;
+    for (size_t i = 0; i < visibleSceneDraws.size(); i++) {
+        SceneDraw& draw = sceneDraws[visibleSceneDraws[i]];
+        GLuint conditionQuery = 0;
+        int query = sceneDrawQueries[visibleSceneDraws[i]];
+        if (useOcclusionQueries && query >= 0) {
+            bool drawIt = occlusionQueries.shouldDraw(query, conditionQuery);
+            occlusionQueries.requestQuery(query, gps::TransformBox(draw.mesh->bounds, transformOf(draw).model));
+            if (!drawIt) {
+                rejected++;
+                continue;
+            }
+        }
+        renderQueue.Submit(gps::PASS_OPAQUE, shader, *draw.mesh, transformOf(draw), conditionQuery);
+        if (depthPrepass.isActive()) {
+            renderQueue.Submit(gps::PASS_DEPTH, activeDepthMapShader(), *draw.mesh, transformOf(draw), conditionQuery);
+        }
+    }
+    renderQueue.countCulled(gps::PASS_OPAQUE, (unsigned int)(sceneDraws.size() - visibleSceneDraws.size()) + rejected);
+}
+
+void flushPass(gps::RenderPass pass) {
+    if (useIndirectDraws) {
+        renderQueue.FlushIndirect(pass, indirectRenderer);
+    }
     else {
-        model = glm::mat4(1.0f);
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        if (!depthPass) {
-            glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        renderQueue.Flush(pass);
+    }
+}
+
+//lays down the depth of the visible draws with the depth shader, so the opaque pass shades one fragment per pixel
+void renderDepthPrepass() {
+    gps::Shader depthShader = activeDepthMapShader();
+    depthShader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(depthShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE,
+        glm::value_ptr(viewProjection));
+
+    depthPrepass.BeginPrepass();
+    flushPass(gps::PASS_DEPTH);
+    depthPrepass.EndPrepass();
+}
+
+//culls the casters of every cascade into one layer mask per draw, shadowCasterDraws lists the draws with a mask
+//the light frustum of each cascade is tested against the boxes of the meshes inside the camera frustum
+void cullShadowCasters() {
+    shadowReceiverDraws.clear();
+    sceneBvh.QueryFrustum(cameraFrustum, shadowReceiverDraws);
+    //the cascades share the light view, so the light space receiver boxes are the same for all of them
+    shadowCasterCuller.setLight(shadowCascades.getLightView(), shadowCascades.getCascade(0).lightProjection);
+    shadowCasterCuller.setReceivers(sceneBvh, shadowReceiverDraws);
+
+    shadowCasterMasks.assign(sceneDraws.size(), 0);
+    shadowCasterDraws.clear();
+    dynamicShadowCascades = 0;
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        shadowCasterCuller.setLight(shadowCascades.getLightView(), shadowCascades.getCascade(c).lightProjection);
+        cascadeCasterDraws.clear();
+        shadowCasterCuller.Cull(sceneBvh, cascadeCasterDraws);
+        for (size_t i = 0; i < cascadeCasterDraws.size(); i++) {
+            uint32_t drawIndex = cascadeCasterDraws[i];
+            if (sceneDrawDynamic[drawIndex]) {
+                dynamicShadowCascades |= 1u << c;
+            }
+            if (shadowCasterMasks[drawIndex] == 0) {
+                shadowCasterDraws.push_back(drawIndex);
+            }
+            shadowCasterMasks[drawIndex] |= 1u << c;
         }
     }
-    boat.Draw(shader);
 }
 
-//for shadow we make a draw Objects function where I put the conent from renderScene function
+//picks the cascades rendered this frame and marks them rendered with their fitted projection
+//a cascade whose slice left the rectangle it was rendered with is updated right away;
+//one without moving casters, now or in its last update, only then
+void scheduleShadowCascades() {
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        uint32_t bit = 1u << c;
+        if (!shadowCascades.isCovered(c)) {
+            shadowScheduler.Invalidate(c);
+        }
+        shadowScheduler.setStatic(c, ((dynamicShadowCascades | renderedDynamicCascades) & bit) == 0);
+    }
+    shadowScheduler.BeginFrame();
+
+    updatedShadowCascades = 0;
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        if (shadowScheduler.shouldUpdate(c)) {
+            updatedShadowCascades |= 1u << c;
+            shadowCascades.MarkRendered(c);
+        }
+    }
+    renderedDynamicCascades = (renderedDynamicCascades & ~updatedShadowCascades) | (dynamicShadowCascades & updatedShadowCascades);
+}
+
+//renders every static caster inside the light frustum of the cascade into its cache layer
+//unlike the per frame casters they do not depend on what the camera sees, so the cache survives camera moves
+void renderStaticShadowMap(gps::Shader shader, int cascade) {
+    const gps::Cascade& fitted = shadowCascades.getCascade(cascade);
+    shader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE,
+        glm::value_ptr(fitted.lightSpaceTrMatrix));
+    shadowCasterCuller.setLight(shadowCascades.getLightView(), fitted.lightProjection);
+
+    staticShadowDraws.clear();
+    sceneBvh.QueryFrustum(shadowCasterCuller.getFrustum(), staticShadowDraws);
+
+    renderQueue.Clear(gps::PASS_SHADOW);
+    size_t kept = 0;
+    for (size_t i = 0; i < staticShadowDraws.size(); i++) {
+        if (!sceneDrawDynamic[staticShadowDraws[i]]) {
+            SceneDraw& draw = sceneDraws[staticShadowDraws[i]];
+            renderQueue.Submit(gps::PASS_SHADOW, shader, *draw.mesh, transformOf(draw));
+            staticShadowDraws[kept++] = staticShadowDraws[i];
+        }
+    }
+    staticShadowDraws.resize(kept);
+
+    shadowMapCache.BeginUpdate(cascade, fitted.lightSpaceTrMatrix);
+    flushPass(gps::PASS_SHADOW);
+    shadowMapCache.EndUpdate(cascade);
+}
+
+//draws each caster once into all of the updated layers it shadows
+void renderLayeredShadowCascades(gps::Shader shader) {
+    layeredShadowDraws.clear();
+    layeredShadowLayers = 0;
+    for (size_t i = 0; i < shadowCasterDraws.size(); i++) {
+        uint32_t drawIndex = shadowCasterDraws[i];
+        shadowCasterMasks[drawIndex] &= updatedShadowCascades;
+        //the static casters are already in the layers copied from the cache
+        if (shadowCasterMasks[drawIndex] == 0 || (useShadowCache && !sceneDrawDynamic[drawIndex])) {
+            continue;
+        }
+        layeredShadowDraws.push_back(drawIndex);
+        for (uint32_t mask = shadowCasterMasks[drawIndex]; mask != 0; mask &= mask - 1) {
+            layeredShadowLayers++;
+        }
+    }
+
+    int updatedCount = 0;
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        if ((updatedShadowCascades & (1u << c)) == 0) {
+            continue;
+        }
+        if (useShadowCache && shadowMapCache.needsUpdate(c, shadowCascades.getCascade(c).lightSpaceTrMatrix)) {
+            renderStaticShadowMap(shader, c);
+        }
+        updatedCount++;
+    }
+
+    //only the updated layers are reset, the others keep the depth they were rendered with
+    layeredShadowTimer.Begin();
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        if ((updatedShadowCascades & (1u << c)) == 0) {
+            continue;
+        }
+        shadowCascades.BindCascade(c);
+        if (useShadowCache) {
+            shadowMapCache.CopyTo(c, shadowCascades.getFramebuffer());
+        }
+        else {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+    shadowCascades.BindLayered();
+
+    gps::Shader layeredShader = activeLayeredDepthShader();
+    shadowCascades.UploadUniforms(layeredShader);
+    renderQueue.Clear(gps::PASS_SHADOW);
+    for (size_t i = 0; i < layeredShadowDraws.size(); i++) {
+        SceneDraw& draw = sceneDraws[layeredShadowDraws[i]];
+        renderQueue.Submit(gps::PASS_SHADOW, layeredShader, *draw.mesh, transformOf(draw), 0, shadowCasterMasks[layeredShadowDraws[i]]);
+    }
+    renderQueue.countCulled(gps::PASS_SHADOW, (unsigned int)(sceneDraws.size() - layeredShadowDraws.size()));
+    flushPass(gps::PASS_SHADOW);
+    layeredShadowTimer.End();
+
+    //one pass renders all of the layers, so its time is split evenly between them
+    if (layeredShadowTimer.hasResult()) {
+        for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+            if (updatedShadowCascades & (1u << c)) {
+                shadowScheduler.setViewCost(c, layeredShadowTimer.getMilliseconds() / (float)updatedCount);
+            }
+        }
+    }
+}
+
+//renders the layer of every cascade the scheduler picked, starting from the cached static casters when the cache is on
+void renderShadowCascades(gps::Shader shader) {
+    cullShadowCasters();
+    scheduleShadowCascades();
+
+    shadowMapCache.BeginFrame();
+    if (useLayeredShadows) {
+        renderLayeredShadowCascades(shader);
+        return;
+    }
+    for (int c = 0; c < shadowCascades.getCascadeCount(); c++) {
+        if ((updatedShadowCascades & (1u << c)) == 0) {
+            continue;
+        }
+        const gps::Cascade& cascade = shadowCascades.getCascade(c);
+        if (useShadowCache && shadowMapCache.needsUpdate(c, cascade.lightSpaceTrMatrix)) {
+            renderStaticShadowMap(shader, c);
+        }
+
+        shadowCascadeTimers[c].Begin();
+        shadowCascades.BindCascade(c);
+        if (useShadowCache) {
+            shadowMapCache.CopyTo(c, shadowCascades.getFramebuffer());
+        }
+        else {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        shader.useShaderProgram();
+        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE,
+            glm::value_ptr(cascade.lightSpaceTrMatrix));
+        renderQueue.Clear(gps::PASS_SHADOW);
+        unsigned int submitted = 0;
+        for (size_t i = 0; i < shadowCasterDraws.size(); i++) {
+            uint32_t drawIndex = shadowCasterDraws[i];
+            //the static casters are already in the shadow map when it starts from the cache
+            if ((shadowCasterMasks[drawIndex] & (1u << c)) == 0 || (useShadowCache && !sceneDrawDynamic[drawIndex])) {
+                continue;
+            }
+            SceneDraw& draw = sceneDraws[drawIndex];
+            renderQueue.Submit(gps::PASS_SHADOW, shader, *draw.mesh, transformOf(draw));
+            submitted++;
+        }
+        renderQueue.countCulled(gps::PASS_SHADOW, (unsigned int)sceneDraws.size() - submitted);
+        flushPass(gps::PASS_SHADOW);
+        shadowCascadeTimers[c].End();
+
+        if (shadowCascadeTimers[c].hasResult()) {
+            shadowScheduler.setViewCost(c, shadowCascadeTimers[c].getMilliseconds());
+        }
+    }
+}
+
+//light lists of the froxels for this frame, before any shader binds them
+void updateClusteredLights() {
+    if (withLight) {
+        clusteredLights.Update(view, glm::radians(45.0f), renderWidth, renderHeight, SCENE_NEAR_PLANE, SCENE_FAR_PLANE);
+    }
+}
+
+//shadow map, cascade uniforms and point lights of the shader that lights the scene, forward, resolve or impostors
+void bindLightingInputs(gps::Shader shader) {
+    uploadSceneUniforms(shader);
+
+    //bind the shadow map
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascades.getTexture());
+    glUniform1i(glGetUniformLocation(shader.shaderProgram, "shadowMap"), 3);
+
+    shadowCascades.UploadUniforms(shader);
+
+    if (withLight) {
+        clusteredLights.Bind(shader, CLUSTER_TEXTURE_UNIT);
+    }
+}
+
+//the quads are not in the depth prepass, they test and write depth after the opaque pass
+//the forward shader lights them, the g-buffer one leaves that to the resolve
+void renderImpostors() {
+    impostorAtlas.BeginFrame();
+    gps::Shader shader = deferredFrame ? impostorGBufferShader
+        : impostorShaderVariants.getShader(activeShaderFeatures(), shadowCascades.getQuality());
+    shader.useShaderProgram();
+    if (!deferredFrame) {
+        bindLightingInputs(shader);
+    }
+    impostorAtlas.BindTextures(shader, IMPOSTOR_TEXTURE_UNIT);
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+    glm::vec3 cameraPosition = myCamera.getPosition();
+    for (size_t p = 0; p < propImpostors.size(); p++) {
+        PropImpostor& prop = propImpostors[p];
+        if (prop.fade <= 0.0f) {
+            continue;
+        }
+        const glm::mat4& objectModel = sceneTransforms.get(prop.object).model;
+        if (!cameraFrustum.Intersects(impostorAtlas.getSphere(prop.impostor, objectModel))) {
+            continue;
+        }
+        impostorAtlas.Draw(shader, prop.impostor, objectModel, view, cameraPosition, prop.fade);
+    }
+}
 
 void drawObjects(gps::Shader shader, bool depthPass) {
-    renderPrincipalScene(shader, depthPass);
-    renderStreetLight(shader, depthPass);
-    renderTractor(shader, depthPass);
-    renderTractor_onRoad(shader, depthPass,powerOn);
-    renderBoat(shader, depthPass);
-    renderDuck(shader, depthPass);
-    renderGrayDog(shader, depthPass);
-    renderWhiteDog(shader, depthPass);
+    renderQueue.Clear(passFor(depthPass));
+    if (!depthPass) {
+        renderQueue.Clear(gps::PASS_DEPTH);
+    }
+    if (depthPass) {
+        if (withShadows) {
+            renderShadowCascades(shader);
+        }
+        return;
+    }
+    renderVisibleScene(shader);
+    if (depthPrepass.isActive()) {
+        renderDepthPrepass();
+    }
+    depthPrepass.BeginShading();
+    flushPass(gps::PASS_OPAQUE);
+    depthPrepass.EndShading();
+    renderImpostors();
+}
+
+//picks the size of the main pass for this frame and the target it renders into
+void beginSceneTarget() {
+    int windowWidth = myWindow.getWindowDimensions().width;
+    int windowHeight = myWindow.getWindowDimensions().height;
+    if (!useDynamicResolution) {
+        renderWidth = windowWidth;
+        renderHeight = windowHeight;
+        if (sceneTarget != NULL) {
+            renderTargetPool.Release(sceneTarget);
+            sceneTarget = NULL;
+        }
+        return;
+    }
+    dynamicResolution.getRenderSize(windowWidth, windowHeight, renderWidth, renderHeight);
+    if (sceneTarget != NULL && (sceneTarget->desc.width != renderWidth || sceneTarget->desc.height != renderHeight)) {
+        renderTargetPool.Release(sceneTarget);
+        sceneTarget = NULL;
+    }
+    if (sceneTarget == NULL) {
+        //srgb like the window, so the upscale filters in linear color
+        gps::RenderTargetDesc desc;
+        desc.width = renderWidth;
+        desc.height = renderHeight;
+        desc.colorFormats[0] = GL_SRGB8_ALPHA8;
+        desc.colorCount = 1;
+        desc.depthFormat = GL_DEPTH_COMPONENT24;
+        sceneTarget = renderTargetPool.Acquire(desc);
+    }
+}
+
+void bindSceneTarget() {
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget != NULL ? sceneTarget->framebuffer : 0);
+    glViewport(0, 0, renderWidth, renderHeight);
+}
+
+//stretches the scene target over the window
+void upscaleSceneTarget() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+    upscaleShader.useShaderProgram();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneTarget->colorTextures[0]);
+    glUniform1i(glGetUniformLocation(upscaleShader.shaderProgram, "sceneColor"), 0);
+    glm::vec2 outputSize = glm::vec2(myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+    glUniform2fv(glGetUniformLocation(upscaleShader.shaderProgram, "outputSize"), 1, glm::value_ptr(outputSize));
+
+    glDisable(GL_DEPTH_TEST);
+    renderTargetPool.DrawFullscreen();
+    glEnable(GL_DEPTH_TEST);
+}
+
+//gpu time of the frame for the controller, the main pass is the part that follows the render size
+void updateDynamicResolution() {
+    if (!useDynamicResolution) {
+        return;
+    }
+    float scaledMilliseconds = deferredFrame ? geometryPassTimer.getMilliseconds() + resolvePassTimer.getMilliseconds()
+        : forwardPassTimer.getMilliseconds();
+    float frameMilliseconds = scaledMilliseconds + shadowScheduler.getStats().spentMilliseconds;
+    dynamicResolution.Update(frameMilliseconds, scaledMilliseconds);
+}
+
+//the opaque scene through the shader the current framebuffer expects
+void renderOpaquePass(gps::Shader shader) {
+    shader.useShaderProgram();
+    materialLibrary.BindTextures(shader, MATERIAL_TEXTURE_UNIT);
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+    renderQueue.setView(gps::PASS_OPAQUE, view, SCENE_FAR_PLANE);
+    renderQueue.setView(gps::PASS_DEPTH, view, SCENE_FAR_PLANE);
+    depthPrepass.BeginFrame();
+    if (useOcclusionQueries) {
+        occlusionQueries.BeginFrame(myCamera.getPosition());
+    }
+    drawObjects(shader, false);
+}
+
+void renderForwardPass() {
+    forwardPassTimer.Begin();
+    depthPrepass.setFramebufferSize(renderWidth, renderHeight, sceneTarget != NULL ? 1 : windowSamples);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    //render the scene with shadows
+    gps::Shader basicShader = activeBasicShader();
+    updateClusteredLights();
+    bindLightingInputs(basicShader);
+    renderOpaquePass(basicShader);
+    forwardPassTimer.End();
+}
+
+//the shaded fragments of the g-buffer are lit once each, whatever the overdraw of the geometry pass
+//the default framebuffer is multisampled but the g-buffer is not, so this path has no antialiasing
+void renderDeferredPass() {
+    geometryPassTimer.Begin();
+    gBuffer.Resize(renderWidth, renderHeight);
+    gBuffer.BeginGeometryPass();
+    //the g-buffer has one sample per pixel, the window four
+    depthPrepass.setFramebufferSize(renderWidth, renderHeight, 1);
+    renderOpaquePass(activeGBufferShader());
+    gBuffer.EndGeometryPass();
+    geometryPassTimer.End();
+
+    resolvePassTimer.Begin();
+    bindSceneTarget();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    gps::Shader resolveShader = activeResolveShader();
+    updateClusteredLights();
+    bindLightingInputs(resolveShader);
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    glm::mat4 inverseView = glm::inverse(view);
+    glm::vec2 viewportSize = glm::vec2(gBuffer.getWidth(), gBuffer.getHeight());
+    glUniformMatrix4fv(glGetUniformLocation(resolveShader.shaderProgram, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(inverseProjection));
+    glUniformMatrix4fv(glGetUniformLocation(resolveShader.shaderProgram, "inverseView"), 1, GL_FALSE, glm::value_ptr(inverseView));
+    glUniform2fv(glGetUniformLocation(resolveShader.shaderProgram, "viewportSize"), 1, glm::value_ptr(viewportSize));
+    gBuffer.BindTextures(resolveShader, 0);
+
+    //every pixel writes its g-buffer depth, so the skybox and the queries test against the scene
+    glDepthFunc(GL_ALWAYS);
+    renderTargetPool.DrawFullscreen();
+    glDepthFunc(GL_LESS);
+    resolvePassTimer.End();
+}
+
+//adds the newest measurement of a path once, and only while the presentation runs
+void recordPathTiming(PathTiming& timing, unsigned int resultCount, float milliseconds) {
+    if (resultCount == timing.lastResult) {
+        return;
+    }
+    timing.lastResult = resultCount;
+    if (startPres) {
+        timing.totalMilliseconds += milliseconds;
+        timing.frames++;
+    }
 }
 
 //new renderScene function, for the shadow
 
 void renderScene() {
-    depthMapShader.useShaderProgram();
-    glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
-        1,
-        GL_FALSE,
-        glm::value_ptr(computeLightSpaceTrMatrix()));
-
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-
-    //render the scene
-    drawObjects(depthMapShader, true);
+    //the shadow pass already needs the camera frustum to find the receivers
+    view = myCamera.getViewMatrix();
+    viewProjection = projection * view;
+    cameraFrustum.Extract(viewProjection);
+    updateImpostorFades();
+
+    shadowCascades.Update(viewProjection, SCENE_NEAR_PLANE, SCENE_FAR_PLANE, computeLightView(), staticSceneBounds);
+    gps::Shader depthShader = activeDepthMapShader();
+    renderQueue.setView(gps::PASS_SHADOW, computeLightView(), LIGHT_FAR_PLANE);
+
+    //render the scene, casters between the light and its near plane are clamped onto it
+    glEnable(GL_DEPTH_CLAMP);
+    drawObjects(depthShader, true);
+    glDisable(GL_DEPTH_CLAMP);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     if (showDepthMap) {
@@ -679,39 +1844,42 @@ void renderScene() {
 
         screenQuadShader.useShaderProgram();
 
-        //bind the depth map
+        //bind the depth map, the quad shows the first cascade
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascades.getTexture());
         glUniform1i(glGetUniformLocation(screenQuadShader.shaderProgram, "depthMap"), 0);
 
         glDisable(GL_DEPTH_TEST);
         screenQuad.Draw(screenQuadShader);
         glEnable(GL_DEPTH_TEST);
+        mySkyBox.Draw(skyboxShader, view, projection);
     }
     else {
-        //render the scene with shadows
-        glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        myBasicShader.useShaderProgram();
-
-        view = myCamera.getViewMatrix();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-        //bind the shadow map
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "shadowMap"), 3);
+        beginSceneTarget();
+        bindSceneTarget();
 
-        glUniformMatrix4fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightSpaceTrMatrix"),
-            1,
-            GL_FALSE,
-            glm::value_ptr(computeLightSpaceTrMatrix()));
+        deferredFrame = renderPath == RENDER_DEFERRED || (renderPath == RENDER_ALTERNATE && !deferredFrame);
+        if (deferredFrame) {
+            renderDeferredPass();
+        }
+        else {
+            renderForwardPass();
+        }
+        //the boxes are tested against the finished opaque depth, their results drive the next frames
+        if (useOcclusionQueries) {
+            occlusionQueries.IssueQueries(viewProjection);
+        }
+        recordPathTiming(forwardTiming, forwardPassTimer.getResultCount(), forwardPassTimer.getMilliseconds());
+        recordPathTiming(deferredTiming, resolvePassTimer.getResultCount(),
+            geometryPassTimer.getMilliseconds() + resolvePassTimer.getMilliseconds());
+        mySkyBox.Draw(skyboxShader, view, projection);
 
-        drawObjects(myBasicShader, false);
+        if (sceneTarget != NULL) {
+            upscaleSceneTarget();
+        }
+        updateDynamicResolution();
     }
-    mySkyBox.Draw(skyboxShader, view, projection);
+    renderTargetPool.EndFrame(TARGET_POOL_IDLE_FRAMES);
 }
 
 void cleanup() {
@@ -730,6 +1898,32 @@ float go_x2 = 0;
 
 int main(int argc, const char * argv[]) {
 
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        gps::RunBvhBenchmark(10000);
+        gps::RunBvhBenchmark(100000);
+        gps::RunBvhRefitBenchmark(10000, 100);
+        gps::RunBvhRefitBenchmark(100000, 1000);
+        gps::RunOcclusionBenchmark(10000);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--shader-benchmark") {
+        try {
+            myWindow.Create(1920, 1080, "Shader benchmark", false);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        gps::RunShaderBenchmark(1920, 1080);
+        myWindow.Delete();
+        return EXIT_SUCCESS;
+    }
+
+    double frameCap = 0.0;
+    if (argc > 2 && std::string(argv[1]) == "--frame-cap") {
+        frameCap = atof(argv[2]);
+    }
+
     try {
         initOpenGLWindow();
     } catch (const std::exception& e) {
@@ -746,9 +1940,23 @@ int main(int argc, const char * argv[]) {
     faces.push_back("skybox/hills_ft.tga");
 
     initOpenGLState();
+    initFBO();
 	initModels();
+    initMaterials();
+    initStaticBatches();
 	initShaders();
 	initUniforms();
+    initDrawStream();
+    initIndirectDraws();
+    initSceneBvh();
+    initImpostors();
+    initOcclusionCulling();
+    initOcclusionQueries();
+    initDepthPrepass();
+    initClusteredLights();
+    initDeferredRendering();
+    initDynamicResolution();
+    initFramePacing(frameCap);
     setWindowCallbacks();
 
 
@@ -762,11 +1970,15 @@ int main(int argc, const char * argv[]) {
     glUniformMatrix4fv(glGetUniformLocation(skyboxShader.shaderProgram, "view"), 1, GL_FALSE,
         glm::value_ptr(view));
 
-    projection = glm::perspective(glm::radians(45.0f), (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height, 0.1f, 1000.0f);
+    //the skybox shares the scene projection, so culling and drawing use the same frustum
     glUniformMatrix4fv(glGetUniformLocation(skyboxShader.shaderProgram, "projection"), 1, GL_FALSE,
         glm::value_ptr(projection));
 	// application loop
 	while (!glfwWindowShouldClose(myWindow.getWindow())) {
+        //the input is read once the gpu is at most the allowed frames behind, so it is as fresh as the queue allows
+        framePacer.BeginFrame();
+        drawStream.BeginFrame();
+        glfwPollEvents();
         processMovement();
 
         if (startPres == true && go_z<=5.0) {
@@ -803,10 +2015,11 @@ int main(int argc, const char * argv[]) {
             myCamera.changePosition(glm::vec3(-go_x2, 0.0f, -1.0f), 0.001f);
             go_x2 += 0.01f;
         }
+        updateSimulation();
 	    renderScene();
 
-		glfwPollEvents();
-		glfwSwapBuffers(myWindow.getWindow());
+        drawStream.EndFrame();
+        framePacer.Present();
 
 		glCheckError();
 	}
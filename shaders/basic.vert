@@ -4,24 +4,34 @@ layout(location=0) in vec3 vPosition;
 layout(location=1) in vec3 vNormal;
 layout(location=2) in vec2 vTexCoords;
 
-out vec3 fPosition;
-out vec3 fNormal;
+//the lighting runs in eye space, so the position and normal are brought there once per vertex
+out vec3 fPosEye;
+out vec3 fNormalEye;
 out vec2 fTexCoords;
+flat out uint fMaterialId;
+#ifdef SHADOWS
+//the cascades project the world space position into light space
+out vec3 fPosWorld;
+#endif
+
+#include "draw_uniforms.glsl"
 
-uniform mat4 model;
 uniform mat4 view;
-uniform mat4 projection;
+//projection * view from the cpu, the depth prepass sends the same matrix to light.vert
+uniform mat4 viewProjection;
 
-//for shadow
-out vec4 fragPosLightSpace;
-uniform mat4 lightSpaceTrMatrix;
+//the depth prepass output must match bit for bit for the GL_EQUAL depth test
+invariant gl_Position;
 
 void main() 
 {
-	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
-	fPosition = vPosition;
-	fNormal = vNormal;
+	vec4 worldPosition = model * vec4(vPosition, 1.0f);
+	gl_Position = viewProjection * worldPosition;
+	fPosEye = vec3(view * worldPosition);
+	fNormalEye = mat3(normalMatrix) * vNormal;
 	fTexCoords = vTexCoords;
-	//shadow
-	fragPosLightSpace = lightSpaceTrMatrix * model * vec4(vPosition,1.0f);
+	fMaterialId = materialId;
+#ifdef SHADOWS
+	fPosWorld = worldPosition.xyz;
+#endif
 }
@@ -0,0 +1,49 @@
+#version 430 core
+
+layout(location=0) in vec3 vPosition;
+layout(location=1) in vec3 vNormal;
+layout(location=2) in vec2 vTexCoords;
+//index of the draw, fetched through the baseInstance of the indirect command
+layout(location=3) in uint vDrawId;
+
+//same outputs as basic.vert
+out vec3 fPosEye;
+out vec3 fNormalEye;
+out vec2 fTexCoords;
+flat out uint fMaterialId;
+#ifdef SHADOWS
+out vec3 fPosWorld;
+#endif
+
+struct DrawData {
+	mat4 model;
+	mat4 normalMatrix;
+	uint layerMask;
+	uint materialId;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+	DrawData draws[];
+};
+
+uniform mat4 view;
+//brings world space normals into eye space, the draw data has the model part
+uniform mat3 normalMatrix;
+//projection * view from the cpu, the depth prepass sends the same matrix to light_indirect.vert
+uniform mat4 viewProjection;
+
+//the depth prepass output must match bit for bit for the GL_EQUAL depth test
+invariant gl_Position;
+
+void main() 
+{
+	vec4 worldPosition = draws[vDrawId].model * vec4(vPosition, 1.0f);
+	gl_Position = viewProjection * worldPosition;
+	fPosEye = vec3(view * worldPosition);
+	fNormalEye = normalMatrix * (mat3(draws[vDrawId].normalMatrix) * vNormal);
+	fTexCoords = vTexCoords;
+	fMaterialId = draws[vDrawId].materialId;
+#ifdef SHADOWS
+	fPosWorld = worldPosition.xyz;
+#endif
+}
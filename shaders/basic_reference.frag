@@ -0,0 +1,151 @@
+#version 410 core
+
+//the scene shader before the lighting moved to per vertex eye space data, kept as the baseline
+//of the shader benchmark, it recomputes the eye space position and normal in every light function
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec2 fTexCoords;
+
+out vec4 fColor;
+
+//matrices
+uniform mat4 model;
+uniform mat4 view;
+uniform mat3 normalMatrix;
+
+//lighting
+uniform vec3 lightDir;
+uniform vec3 lightColor;
+
+//fog
+uniform vec3 fogDensity;
+
+// textures
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+
+//point light
+uniform vec3 lightPosition;
+
+//components
+vec3 ambient;
+float ambientStrength = 0.2f;
+vec3 diffuse;
+vec3 specular;
+float specularStrength = 0.5f;
+
+vec3 ambient_point;
+vec3 diffuse_point;
+vec3 specular_point;
+
+vec3 color_point = vec3(1.0f,0.0f,0.0f);
+
+vec4 fPosEye;
+void computeDirLight()
+{
+    //compute eye space coordinates
+    fPosEye = view * model * vec4(fPosition, 1.0f);
+    vec3 normalEye = normalize(normalMatrix * fNormal);
+
+    //normalize light direction
+    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
+
+    //compute view direction (in eye coordinates, the viewer is situated at the origin
+    vec3 viewDir = normalize(- fPosEye.xyz);
+
+    //compute ambient light
+    ambient = ambientStrength * lightColor;
+
+    //compute diffuse light
+    diffuse = max(dot(normalEye, lightDirN), 0.0f) * lightColor;
+
+    //compute specular light
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+    specular = specularStrength * specCoeff * lightColor;
+}
+
+float constant = 1.0f;
+float linear = 0.0025f;
+float quadratic = 0.0037f;
+
+void computePointLight()
+{
+    //compute eye space coordinates
+    fPosEye = view * model * vec4(fPosition, 1.0f);
+    vec3 normalEye = normalize(normalMatrix * fNormal);
+
+    //normalize light direction
+    //vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
+    vec3 lightDirN = normalize(lightPosition - fPosEye.xyz);
+    //vec3 lightDirN = vec3(normalize(view * vec4(lightPosition - fPosEye.xyz, 0.0f)));
+
+    //compute view direction (in eye coordinates, the viewer is situated at the origin
+    vec3 viewDir = normalize(- fPosEye.xyz);
+
+    //compute distance to light
+	float dist = length(lightPosition - fPosEye.xyz);
+	//compute attenuation
+	float att = 1.0f / (constant + linear * dist + quadratic * (dist * dist));
+
+    //compute ambient light
+    ambient_point = att * ambientStrength * color_point;
+
+    //compute diffuse light
+    diffuse_point = att * max(dot(normalEye, lightDirN), 0.0f) * color_point;
+
+    //compute specular light
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+    specular_point = att * specularStrength * specCoeff * color_point;
+}
+
+//the variants are compiled with FOG, POINT_LIGHT, SHADOWS and SHADOW_QUALITY defined as needed
+#ifdef SHADOWS
+#include "shadow.glsl"
+#endif
+
+#ifdef FOG
+float computeFog()
+{
+ float fragmentDistance = length(fPosEye);
+ float fogFactor = exp(-pow(fragmentDistance * fogDensity.x, 2));
+ 
+ return clamp(fogFactor, 0.0f, 1.0f);
+}
+#endif
+void main() 
+{
+    computeDirLight();
+
+    //for shadow
+#ifdef SHADOWS
+    float shadow = computeShadow(vec3(model * vec4(fPosition, 1.0f)), -fPosEye.z);
+#else
+    float shadow = 0.0f;
+#endif
+    vec3 color = min((ambient + (1.0f - shadow) *diffuse) * texture(diffuseTexture, fTexCoords).rgb + (1.0f-shadow) * specular * texture(specularTexture, fTexCoords).rgb, 1.0f);
+
+    vec3 combined_color = color;
+#ifdef POINT_LIGHT
+    computePointLight();
+
+    vec3 color_point = min((ambient_point + diffuse_point) * texture(diffuseTexture, fTexCoords).rgb + specular_point * texture(specularTexture, fTexCoords).rgb, 1.0f);
+    combined_color = color + color_point;
+#endif
+    //compute final vertex color
+    //vec3 color = min((ambient + diffuse) * texture(diffuseTexture, fTexCoords).rgb + specular * texture(specularTexture, fTexCoords).rgb, 1.0f);
+
+    vec4 color4= vec4(combined_color,0.0f);
+#ifdef FOG
+    //for fog
+    float fogFactor = computeFog();
+	vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    fColor = mix(fogColor, color4, fogFactor);
+#else
+    fColor = color4;
+#endif
+
+    //fColor = vec4(color, 1.0f);
+}
@@ -0,0 +1,28 @@
+#version 410 core
+
+//vertex shader of basic_reference.frag
+
+layout(location=0) in vec3 vPosition;
+layout(location=1) in vec3 vNormal;
+layout(location=2) in vec2 vTexCoords;
+
+out vec3 fPosition;
+out vec3 fNormal;
+out vec2 fTexCoords;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+//projection * view from the cpu, the depth prepass sends the same matrix to light.vert
+uniform mat4 viewProjection;
+
+//the depth prepass output must match bit for bit for the GL_EQUAL depth test
+invariant gl_Position;
+
+void main() 
+{
+	gl_Position = viewProjection * (model * vec4(vPosition, 1.0f));
+	fPosition = vPosition;
+	fNormal = vNormal;
+	fTexCoords = vTexCoords;
+}
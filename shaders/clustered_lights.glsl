@@ -0,0 +1,54 @@
+//clustered point lights, included by the scene fragment shader when POINT_LIGHT is defined
+//it needs the eye space fPosEye of the fragment
+
+//offset and count of the light list of each froxel
+uniform usamplerBuffer clusterLists;
+uniform usamplerBuffer clusterLightIndices;
+//two texels per light, eye space position and radius, then color
+uniform samplerBuffer pointLights;
+
+//froxels along x, y and depth, the pixel size of a tile, and slice = log(depth) * x + y
+uniform uvec3 clusterGrid;
+uniform vec2 clusterTileSize;
+uniform vec2 clusterDepthScale;
+
+float constant = 1.0f;
+float linear = 0.0025f;
+float quadratic = 0.0037f;
+
+//sum of the lights whose sphere reaches the froxel of the fragment
+vec3 computePointLights(vec3 normalEye, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
+{
+    uvec3 cluster = uvec3(uvec2(gl_FragCoord.xy / clusterTileSize), uint(max(log(-fPosEye.z) * clusterDepthScale.x + clusterDepthScale.y, 0.0f)));
+    cluster = min(cluster, clusterGrid - 1u);
+    int clusterIndex = int((cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x);
+    uvec2 list = texelFetch(clusterLists, clusterIndex).xy;
+
+    vec3 color = vec3(0.0f);
+    for (uint i = 0u; i < list.y; i++) {
+        int light = int(texelFetch(clusterLightIndices, int(list.x + i)).r);
+        vec4 positionRadius = texelFetch(pointLights, 2 * light);
+        vec3 color_point = texelFetch(pointLights, 2 * light + 1).rgb;
+
+        //compute distance to light
+        vec3 toLight = positionRadius.xyz - fPosEye;
+        float dist = length(toLight);
+        if (dist >= positionRadius.w)
+            continue;
+        vec3 lightDirN = toLight / dist;
+        //compute attenuation, faded out to nothing at the radius of the light
+        float att = 1.0f / (constant + linear * dist + quadratic * (dist * dist));
+        float window = clamp(1.0f - pow(dist / positionRadius.w, 4.0f), 0.0f, 1.0f);
+        att *= window * window;
+
+        //compute ambient, diffuse and specular light
+        vec3 ambient_point = att * ambientStrength * color_point;
+        vec3 diffuse_point = att * max(dot(normalEye, lightDirN), 0.0f) * color_point;
+        vec3 reflectDir = reflect(-lightDirN, normalEye);
+        float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+        vec3 specular_point = att * specularStrength * specCoeff * color_point;
+
+        color += min((ambient_point + diffuse_point) * diffuseColor + specular_point * specularColor, 1.0f);
+    }
+    return color;
+}
@@ -0,0 +1,72 @@
+#version 410 core
+
+//lighting pass of the deferred path, one fragment per pixel of the g-buffer
+//it lights, shadows and fogs exactly like basic.frag, from the stored surface instead of the varyings
+out vec4 fColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+//the eye space position is rebuilt from the depth, the cascades take it in world space
+uniform mat4 inverseProjection;
+uniform mat4 inverseView;
+uniform vec2 viewportSize;
+
+//set per pixel before any lighting, the included code reads it like the varying of basic.frag
+vec3 fPosEye;
+
+#include "lighting.glsl"
+#include "normal_packing.glsl"
+
+//the variants are compiled with FOG, POINT_LIGHT, SHADOWS and SHADOW_QUALITY defined as needed
+#ifdef SHADOWS
+#include "shadow.glsl"
+#endif
+
+#ifdef POINT_LIGHT
+#include "clustered_lights.glsl"
+#endif
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    //nothing was drawn here, the skybox fills it
+    if (depth == 1.0f) {
+        discard;
+    }
+    vec4 clipPosition = vec4(gl_FragCoord.xy / viewportSize * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+    vec4 eyePosition = inverseProjection * clipPosition;
+    fPosEye = eyePosition.xyz / eyePosition.w;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 normalEye = decodeNormal(texelFetch(gNormal, pixel, 0).rg);
+    vec3 viewDir = normalize(-fPosEye);
+    vec3 diffuseColor = albedoSpecular.rgb;
+    vec3 specularColor = vec3(albedoSpecular.a);
+
+    computeDirLight(normalEye, viewDir);
+
+#ifdef SHADOWS
+    float shadow = computeShadow(vec3(inverseView * vec4(fPosEye, 1.0f)), -fPosEye.z);
+#else
+    float shadow = 0.0f;
+#endif
+    vec3 color = min((ambient + (1.0f - shadow) * diffuse) * diffuseColor + (1.0f - shadow) * specular * specularColor, 1.0f);
+
+#ifdef POINT_LIGHT
+    color += computePointLights(normalEye, viewDir, diffuseColor, specularColor);
+#endif
+
+    vec4 color4 = vec4(color, 0.0f);
+#ifdef FOG
+    float fogFactor = computeFog();
+    vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    fColor = mix(fogColor, color4, fogFactor);
+#else
+    fColor = color4;
+#endif
+    //the skybox and the occlusion queries test against the scene depth in the default framebuffer
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,11 @@
+//per-draw data, a range of the stream buffer bound for every draw (RenderQueue::Flush)
+//same layout as gps::DrawData, the normal matrix is a mat4 since std140 pads the columns of a mat3 anyway
+layout(std140) uniform DrawUniforms {
+	mat4 model;
+	//eye space for the main pass, world space for the passes that do not light
+	mat4 normalMatrix;
+	//bit i set when the draw can cast a shadow into cascade i
+	uint layerMask;
+	//entry of the Materials block (materials.glsl)
+	uint materialId;
+};
@@ -0,0 +1,23 @@
+#version 410 core
+
+//geometry pass of the deferred path, compiled with basic.vert or basic_indirect.vert
+in vec3 fPosEye;
+in vec3 fNormalEye;
+in vec2 fTexCoords;
+
+//srgb albedo with the specular intensity in alpha, and the octahedral eye space normal
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec2 gNormal;
+
+#include "materials.glsl"
+#include "normal_packing.glsl"
+
+void main()
+{
+    //the specular maps of the scene are grey, one channel of them is kept
+    vec3 diffuseColor;
+    vec3 specularColor;
+    sampleMaterial(fTexCoords, diffuseColor, specularColor);
+    gAlbedoSpecular = vec4(diffuseColor, dot(specularColor, vec3(1.0f / 3.0f)));
+    gNormal = encodeNormal(normalize(fNormalEye));
+}
@@ -0,0 +1,54 @@
+#version 410 core
+
+//forward shading of the impostors, compiled with impostor.vert and the features of basic.frag
+in vec3 fPosEye;
+in vec2 fTexCoords;
+#ifdef SHADOWS
+in vec3 fPosWorld;
+#endif
+
+out vec4 fColor;
+
+#include "impostor.glsl"
+#include "lighting.glsl"
+
+#ifdef SHADOWS
+#include "shadow.glsl"
+#endif
+
+#ifdef POINT_LIGHT
+#include "clustered_lights.glsl"
+#endif
+
+//lit as basic.frag lights the meshes, with the material the atlas kept
+void main()
+{
+    vec3 diffuseColor;
+    vec3 specularColor;
+    vec3 normalEye;
+    sampleImpostor(fTexCoords, diffuseColor, specularColor, normalEye);
+    vec3 viewDir = normalize(-fPosEye);
+
+    computeDirLight(normalEye, viewDir);
+
+#ifdef SHADOWS
+    float shadow = computeShadow(fPosWorld, -fPosEye.z);
+#else
+    float shadow = 0.0f;
+#endif
+    vec3 color = min((ambient + (1.0f - shadow) * diffuse) * diffuseColor + (1.0f - shadow) * specular * specularColor, 1.0f);
+
+    vec3 combined_color = color;
+#ifdef POINT_LIGHT
+    combined_color = color + computePointLights(normalEye, viewDir, diffuseColor, specularColor);
+#endif
+
+    vec4 color4 = vec4(combined_color, 0.0f);
+#ifdef FOG
+    float fogFactor = computeFog();
+    vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    fColor = mix(fogColor, color4, fogFactor);
+#else
+    fColor = color4;
+#endif
+}
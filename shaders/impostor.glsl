@@ -0,0 +1,31 @@
+//layers of gps::ImpostorAtlas, one per prop: srgb albedo with the coverage in alpha,
+//and the object space normal with the specular intensity in alpha
+uniform sampler2DArray impostorAlbedo;
+uniform sampler2DArray impostorNormal;
+uniform float impostorLayer;
+//object space to eye space normals of the prop
+uniform mat3 impostorNormalMatrix;
+//share of the pixels the impostor takes over from the meshes while it fades in, 1 once they are gone
+uniform float impostorFade;
+
+//4x4 ordered dither, the pixels under the fade are kept
+float ditherThreshold(vec2 fragCoord)
+{
+	const float bayer[16] = float[16](0.0f, 8.0f, 2.0f, 10.0f, 12.0f, 4.0f, 14.0f, 6.0f,
+		3.0f, 11.0f, 1.0f, 9.0f, 15.0f, 7.0f, 13.0f, 5.0f);
+	ivec2 cell = ivec2(fragCoord) & 3;
+	return (bayer[cell.y * 4 + cell.x] + 0.5f) / 16.0f;
+}
+
+//the empty texels are zero, so the mipmaps at the edges are divided by their coverage
+void sampleImpostor(vec2 texCoords, out vec3 diffuseColor, out vec3 specularColor, out vec3 normalEye)
+{
+	vec4 albedo = texture(impostorAlbedo, vec3(texCoords, impostorLayer));
+	if (albedo.a < 0.5f || ditherThreshold(gl_FragCoord.xy) >= impostorFade) {
+		discard;
+	}
+	vec4 normal = texture(impostorNormal, vec3(texCoords, impostorLayer));
+	diffuseColor = albedo.rgb / albedo.a;
+	specularColor = vec3(normal.a / albedo.a);
+	normalEye = normalize(impostorNormalMatrix * (normal.xyz * 2.0f - 1.0f));
+}
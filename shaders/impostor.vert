@@ -0,0 +1,34 @@
+#version 410 core
+
+//quad of a prop impostor (gps::ImpostorAtlas::Draw), its corners come from gl_VertexID and no vertex buffer
+//it lies across the frame direction in the object space of the prop, placed by the object transform
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 viewProjection;
+//center of the quad and its half axes
+uniform vec3 quadCenter;
+uniform vec3 quadRight;
+uniform vec3 quadUp;
+//atlas coordinates of the lower left corner of the frame, and the share of the atlas a frame takes
+uniform vec2 frameOrigin;
+uniform float frameSize;
+
+//same outputs as basic.vert, the normal comes from the atlas
+out vec3 fPosEye;
+out vec2 fTexCoords;
+#ifdef SHADOWS
+out vec3 fPosWorld;
+#endif
+
+void main()
+{
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec3 position = quadCenter + (corner.x * 2.0f - 1.0f) * quadRight + (corner.y * 2.0f - 1.0f) * quadUp;
+	vec4 worldPosition = model * vec4(position, 1.0f);
+	gl_Position = viewProjection * worldPosition;
+	fPosEye = vec3(view * worldPosition);
+	fTexCoords = frameOrigin + corner * frameSize;
+#ifdef SHADOWS
+	fPosWorld = worldPosition.xyz;
+#endif
+}
@@ -0,0 +1,19 @@
+#version 410 core
+
+in vec3 fNormal;
+in vec2 fTexCoords;
+
+//the layers of the atlas, read back by impostor.glsl
+layout(location = 0) out vec4 albedoCoverage;
+layout(location = 1) out vec4 normalSpecular;
+
+#include "materials.glsl"
+
+void main()
+{
+    vec3 diffuseColor;
+    vec3 specularColor;
+    sampleMaterial(fTexCoords, diffuseColor, specularColor);
+    albedoCoverage = vec4(diffuseColor, 1.0f);
+    normalSpecular = vec4(normalize(fNormal) * 0.5f + 0.5f, dot(specularColor, vec3(1.0f / 3.0f)));
+}
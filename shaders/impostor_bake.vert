@@ -0,0 +1,21 @@
+#version 410 core
+
+layout(location=0) in vec3 vPosition;
+layout(location=1) in vec3 vNormal;
+layout(location=2) in vec2 vTexCoords;
+
+//the views of gps::ImpostorAtlas, the meshes stay in object space
+out vec3 fNormal;
+out vec2 fTexCoords;
+flat out uint fMaterialId;
+
+uniform mat4 viewProjection;
+uniform uint meshMaterialId;
+
+void main()
+{
+	gl_Position = viewProjection * vec4(vPosition, 1.0f);
+	fNormal = vNormal;
+	fTexCoords = vTexCoords;
+	fMaterialId = meshMaterialId;
+}
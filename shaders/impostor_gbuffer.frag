@@ -0,0 +1,22 @@
+#version 410 core
+
+//geometry pass of the deferred path for the impostors, compiled with impostor.vert
+in vec3 fPosEye;
+in vec2 fTexCoords;
+
+//same targets as gbuffer.frag
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec2 gNormal;
+
+#include "impostor.glsl"
+#include "normal_packing.glsl"
+
+void main()
+{
+    vec3 diffuseColor;
+    vec3 specularColor;
+    vec3 normalEye;
+    sampleImpostor(fTexCoords, diffuseColor, specularColor, normalEye);
+    gAlbedoSpecular = vec4(diffuseColor, specularColor.r);
+    gNormal = encodeNormal(normalEye);
+}
@@ -2,9 +2,12 @@
 layout(location=0) in vec3 vPosition;
 
 uniform mat4 lightSpaceTrMatrix;
-uniform mat4 model;
+#include "draw_uniforms.glsl"
+
+//also used by the depth prepass, with lightSpaceTrMatrix set to the camera viewProjection
+invariant gl_Position;
 
 void main()
 {
- gl_Position = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
+ gl_Position = lightSpaceTrMatrix * (model * vec4(vPosition, 1.0f));
 }
\ No newline at end of file
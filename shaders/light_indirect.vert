@@ -0,0 +1,24 @@
+#version 430 core
+layout(location=0) in vec3 vPosition;
+layout(location=3) in uint vDrawId;
+
+struct DrawData {
+	mat4 model;
+	mat4 normalMatrix;
+	uint layerMask;
+	uint materialId;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+	DrawData draws[];
+};
+
+uniform mat4 lightSpaceTrMatrix;
+
+//also used by the depth prepass, with lightSpaceTrMatrix set to the camera viewProjection
+invariant gl_Position;
+
+void main()
+{
+ gl_Position = lightSpaceTrMatrix * (draws[vDrawId].model * vec4(vPosition, 1.0f));
+}
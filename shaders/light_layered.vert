@@ -0,0 +1,13 @@
+#version 410 core
+layout(location=0) in vec3 vPosition;
+
+#include "draw_uniforms.glsl"
+
+flat out uint gLayerMask;
+
+//world space output, light_layered.geom projects each triangle into the cascades of the mask
+void main()
+{
+ gl_Position = model * vec4(vPosition, 1.0f);
+ gLayerMask = layerMask;
+}
@@ -0,0 +1,23 @@
+#version 430 core
+layout(location=0) in vec3 vPosition;
+layout(location=3) in uint vDrawId;
+
+struct DrawData {
+	mat4 model;
+	mat4 normalMatrix;
+	uint layerMask;
+	uint materialId;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+	DrawData draws[];
+};
+
+flat out uint gLayerMask;
+
+//world space output, light_layered.geom projects each triangle into the cascades of the mask
+void main()
+{
+	gl_Position = draws[vDrawId].model * vec4(vPosition, 1.0f);
+	gLayerMask = draws[vDrawId].layerMask;
+}
@@ -0,0 +1,25 @@
+#version 410 core
+//gl_Layer is writable from the vertex shader with either extension, the application checks for one
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+layout(location=0) in vec3 vPosition;
+
+#include "draw_uniforms.glsl"
+
+uniform mat4 lightSpaceTrMatrices[4];
+
+//drawn with one instance per set bit of the mask, instance i goes to the layer of the i-th set bit
+void main()
+{
+ int layer = 0;
+ int remaining = gl_InstanceID;
+ for (int i = 0; i < 4; i++) {
+  if ((layerMask & (1u << uint(i))) != 0u) {
+   if (remaining == 0)
+    layer = i;
+   remaining--;
+  }
+ }
+ gl_Layer = layer;
+ gl_Position = lightSpaceTrMatrices[layer] * (model * vec4(vPosition, 1.0f));
+}
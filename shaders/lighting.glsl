@@ -0,0 +1,41 @@
+//directional light and fog of the scene, shared by the forward shader and the deferred resolve
+//the fog needs the eye space fPosEye of the fragment
+
+//the direction towards the light is brought into eye space and normalized once per frame
+uniform vec3 lightDirEye;
+uniform vec3 lightColor;
+
+//fog
+uniform vec3 fogDensity;
+
+//components
+vec3 ambient;
+float ambientStrength = 0.2f;
+vec3 diffuse;
+vec3 specular;
+float specularStrength = 0.5f;
+
+void computeDirLight(vec3 normalEye, vec3 viewDir)
+{
+    //compute ambient light
+    ambient = ambientStrength * lightColor;
+
+    //compute diffuse light
+    diffuse = max(dot(normalEye, lightDirEye), 0.0f) * lightColor;
+
+    //compute specular light
+    vec3 reflectDir = reflect(-lightDirEye, normalEye);
+    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+    specular = specularStrength * specCoeff * lightColor;
+}
+
+#ifdef FOG
+float computeFog()
+{
+ //w stays in the distance, as in the reference shader, so both fog the same
+ float fragmentDistance = length(vec4(fPosEye, 1.0f));
+ float fogFactor = exp(-pow(fragmentDistance * fogDensity.x, 2));
+ 
+ return clamp(fogFactor, 0.0f, 1.0f);
+}
+#endif
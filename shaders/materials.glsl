@@ -0,0 +1,35 @@
+//textures of the scene materials (gps::MaterialLibrary), one texture array per size bucket
+//a material holds the bucket and layer of its diffuse texture in xy and of its specular texture in zw,
+//bucket MAX_TEXTURE_BUCKETS when it has none
+#define MAX_TEXTURE_BUCKETS 4
+#define MAX_MATERIALS 1024
+
+uniform sampler2DArray materialTextures[MAX_TEXTURE_BUCKETS];
+
+layout(std140) uniform Materials {
+	uvec4 materials[MAX_MATERIALS];
+};
+
+flat in uint fMaterialId;
+
+//a sampler array may only be indexed by a constant here, so every bucket is compared
+//the branch is not uniform, so the gradients are taken by the caller before it
+vec3 sampleMaterialTexture(uint bucket, uint layer, vec2 texCoords, vec2 dx, vec2 dy)
+{
+	vec3 color = vec3(0.0f);
+	for (int i = 0; i < MAX_TEXTURE_BUCKETS; i++) {
+		if (uint(i) == bucket) {
+			color = textureGrad(materialTextures[i], vec3(texCoords, float(layer)), dx, dy).rgb;
+		}
+	}
+	return color;
+}
+
+void sampleMaterial(vec2 texCoords, out vec3 diffuseColor, out vec3 specularColor)
+{
+	vec2 dx = dFdx(texCoords);
+	vec2 dy = dFdy(texCoords);
+	uvec4 material = materials[fMaterialId];
+	diffuseColor = sampleMaterialTexture(material.x, material.y, texCoords, dx, dy);
+	specularColor = sampleMaterialTexture(material.z, material.w, texCoords, dx, dy);
+}
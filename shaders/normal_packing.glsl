@@ -0,0 +1,23 @@
+//octahedral normal encoding, a unit vector is folded onto the [-1, 1] square and back
+//two snorm16 channels keep it to well under a tenth of a degree
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 encodeNormal(vec3 normal)
+{
+    vec2 folded = normal.xy / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    //the lower half of the octahedron is flipped over the diagonals
+    return normal.z >= 0.0f ? folded : (1.0f - abs(folded.yx)) * signNotZero(folded);
+}
+
+vec3 decodeNormal(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0f) {
+        normal.xy = (1.0f - abs(normal.yx)) * signNotZero(normal.xy);
+    }
+    return normalize(normal);
+}
@@ -0,0 +1,10 @@
+#version 410 core
+layout(location=0) in vec3 vPosition;
+
+//projection * view * the transform of the unit cube onto the queried box
+uniform mat4 boxTransform;
+
+void main()
+{
+ gl_Position = boxTransform * vec4(vPosition, 1.0f);
+}
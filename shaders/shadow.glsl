@@ -0,0 +1,67 @@
+//cascaded shadow map lookup, included by the scene fragment shaders when SHADOWS is defined
+
+//shadow computation, one light space matrix per cascade of the shadow map array
+const int MAX_CASCADES = 4;
+uniform mat4 lightSpaceTrMatrices[MAX_CASCADES];
+//view distance where each cascade ends
+uniform float cascadeFarPlanes[MAX_CASCADES];
+uniform float cascadeBiases[MAX_CASCADES];
+uniform int cascadeCount;
+
+uniform sampler2DArray shadowMap;
+
+#ifndef SHADOW_QUALITY
+#define SHADOW_QUALITY 0
+#endif
+
+//viewDistance is the eye space depth of the fragment, positive in front of the camera
+float computeShadow(vec3 worldPosition, float viewDistance){
+    //first cascade that reaches the fragment, nothing is shadowed past the last one
+    int cascade = 0;
+    while (cascade < cascadeCount && viewDistance > cascadeFarPlanes[cascade])
+        cascade++;
+
+    //a cascade rendered a few frames ago may not reach the fragment yet, the next one covers more
+    vec3 normalizedCoords;
+    for (; cascade < cascadeCount; cascade++) {
+        vec4 fragPosLightSpace = lightSpaceTrMatrices[cascade] * vec4(worldPosition, 1.0f);
+        //perform perspective divide
+        normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+        // Transform to [0,1] range
+        normalizedCoords = normalizedCoords * 0.5 + 0.5;
+        if (all(greaterThanEqual(normalizedCoords.xy, vec2(0.0f))) && all(lessThanEqual(normalizedCoords.xy, vec2(1.0f))))
+            break;
+    }
+    if (cascade == cascadeCount)
+        return 0.0f;
+    if (normalizedCoords.z > 1.0f)
+        return 0.0f;
+
+    // Get depth of current fragment from light's perspective
+    float currentDepth = normalizedCoords.z;
+    float bias = cascadeBiases[cascade];
+
+#if SHADOW_QUALITY == 0
+    // Get closest depth value from light's perspective
+    float closestDepth = texture(shadowMap, vec3(normalizedCoords.xy, cascade)).r;
+    // Check whether current frag pos is in shadow
+    return currentDepth - bias > closestDepth ? 1.0 : 0.0;
+#else
+    //percentage closer filtering, the fraction of the taps around the fragment that are in shadow
+#if SHADOW_QUALITY == 1
+    const int taps = 2;
+#else
+    const int taps = 3;
+#endif
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowMap, 0).xy);
+    vec2 firstTap = normalizedCoords.xy - 0.5f * float(taps - 1) * texelSize;
+    float shadow = 0.0f;
+    for (int y = 0; y < taps; y++) {
+        for (int x = 0; x < taps; x++) {
+            float closestDepth = texture(shadowMap, vec3(firstTap + vec2(x, y) * texelSize, cascade)).r;
+            shadow += currentDepth - bias > closestDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadow / float(taps * taps);
+#endif
+}
@@ -0,0 +1,13 @@
+#version 410 core
+
+//stretches the scaled render of the scene over the window, bilinear in linear color
+//the target is srgb, so the samples are decoded before the filter and encoded again on the write
+out vec4 fColor;
+
+uniform sampler2D sceneColor;
+uniform vec2 outputSize;
+
+void main()
+{
+    fColor = texture(sceneColor, gl_FragCoord.xy / outputSize);
+}